@@ -0,0 +1,85 @@
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include "bankFormat.h"
+#include "formatDescriptor.h"
+#include "csvInput.h"
+
+// Longer than any signature
+#define SIGNATURE_MAX   96
+
+char *strcasestr_simple(const char *hay, const char *needle) {
+    size_t nlen = strlen(needle);
+    if (nlen == 0) return (char *)hay;
+    for (; *hay; hay++) {
+        if (tolower((unsigned char)*hay) == tolower((unsigned char)*needle)) {
+            if (strncasecmp(hay, needle, nlen) == 0) return (char *)hay;
+        }
+    }
+    return NULL;
+}
+
+bankFormat_t string2bankFormat(const char *s)
+{
+    for (const formatDescriptor_t &fd : formatDescriptors)
+    {
+        if (strcasestr_simple(s, fd.nameMatch))
+        {
+            return fd.bankFormat;
+        }
+    }
+    return UNKNOWN_BANK_FORMAT;
+}
+
+const char *bankFormat2string(bankFormat_t bankFormat)
+{
+    int i = formatDescriptorIndex(bankFormat);
+    return (i >= 0) ? formatDescriptors[i].name : "Unknown";
+}
+
+bankFormat_t sniffBankFormat(const char *data, size_t len)
+{
+    const char  *p = data;
+    const char  *end = data + ((len < SNIFF_SIZE) ? len : SNIFF_SIZE);
+    char        line[SIGNATURE_MAX];
+
+    // One pass over the lines.  Each line start is copied without
+    // quotes, only as far as the longest signature, and compared
+    // with every signature.
+    while (p < end)
+    {
+        size_t n = 0;
+
+        for (; (p < end) && (*p != '\n'); p++)
+        {
+            if ((*p != '"') && (n < sizeof(line))) line[n++] = *p;
+        }
+        p++;    // Past the newline
+
+        for (const formatDescriptor_t &fd : formatDescriptors)
+        {
+            size_t sigLen = strlen(fd.signature);
+            if ((n >= sigLen) && (strncasecmp(line, fd.signature, sigLen) == 0))
+            {
+                return fd.bankFormat;
+            }
+        }
+    }
+
+    return UNKNOWN_BANK_FORMAT;
+}
+
+bool sniffBankFormatFile(const char *fileName, bankFormat_t *bankFormat)
+{
+    CsvInput    csvIn;
+    const char  *data;
+    size_t      len;
+
+    *bankFormat = UNKNOWN_BANK_FORMAT;
+    if (false == csvIn.open(fileName)) return false;
+
+    // Through CsvInput so compressed files are looked at decompressed
+    csvIn.peek(&data, &len, SNIFF_SIZE);
+    *bankFormat = sniffBankFormat(data, len);
+    return true;
+}
@@ -0,0 +1,36 @@
+#ifndef __BANKFORMAT_H__
+#define __BANKFORMAT_H__
+
+#include <stddef.h>
+
+// How much of the start of a file is looked at to find its format
+#define SNIFF_SIZE  (8 * 1024)
+
+typedef enum
+{
+    UNKNOWN_BANK_FORMAT
+    , BOA_FORMAT
+    , CITI_FORMAT
+    , FIDELITY_FORMAT
+    , SCHWAB_BANK_FORMAT
+    , SCHWAB_BROKERAGE_FORMAT
+}   bankFormat_t;
+
+char *strcasestr_simple(const char *hay, const char *needle);
+
+bankFormat_t string2bankFormat(const char *s);
+
+// Name of a format as given to -f ("BoA", "Citi", ...)
+const char *bankFormat2string(bankFormat_t bankFormat);
+
+// Find the format of an export from its column header line.  Only the
+// first SNIFF_SIZE bytes of data are looked at.  Returns
+// UNKNOWN_BANK_FORMAT if no line there is a known column header.
+bankFormat_t sniffBankFormat(const char *data, size_t len);
+
+// sniffBankFormat() on the first SNIFF_SIZE bytes of a file,
+// decompressed if it is compressed.
+// Returns false if the file can not be read.
+bool sniffBankFormatFile(const char *fileName, bankFormat_t *bankFormat);
+
+#endif
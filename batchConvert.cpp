@@ -0,0 +1,301 @@
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <strings.h>
+#include <dirent.h>
+#include <algorithm>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include "batchConvert.h"
+#include "qifConverter.h"
+#include "checkpoint.h"
+
+// Outcome of one file of the batch
+typedef struct
+{
+    int                 ret;
+    char                outFileName[MAX_LINE];
+    convertResult_t     result;
+}   batchResult_t;
+
+bool hasCsvExtension(const char *name)
+{
+    size_t len = strlen(name);
+
+    if ((len > 3) && (strcasecmp(name + len - 3, ".gz") == 0)) len -= 3;
+    else if ((len > 4) && (strcasecmp(name + len - 4, ".zst") == 0)) len -= 4;
+    return (len > 4) && (strncasecmp(name + len - 4, ".csv", 4) == 0);
+}
+
+// Exactly the name of a format, as -f takes it
+static bool isFormatName(const char *s)
+{
+    for (const formatDescriptor_t &fd : formatDescriptors)
+    {
+        if (strcasecmp(s, fd.name) == 0) return true;
+    }
+    return false;
+}
+
+bankFormat_t batchFormatForFile(const std::string &inFileName)
+{
+    bankFormat_t bankFormat;
+
+    if  (   sniffBankFormatFile(inFileName.c_str(), &bankFormat)
+         && (UNKNOWN_BANK_FORMAT != bankFormat)
+        )
+    {
+        return bankFormat;
+    }
+
+    const char *name = strrchr(inFileName.c_str(), '/');
+    return string2bankFormat(name ? name + 1 : inFileName.c_str());
+}
+
+bool batchCollect(const char *spec
+                  , bankFormat_t defaultFormat
+                  , std::vector<batchItem_t> &items
+                  , std::string &errMsg
+                 )
+{
+    if ('@' == spec[0])
+    {
+        // File list: one "filename[,format[,account]]" per line
+        FILE *fp = fopen(spec + 1, "r");
+        char line[MAX_LINE];
+
+        if ((FILE *)(NULL) == fp)
+        {
+            errMsg = std::string("Error opening file list ") + (spec + 1);
+            return false;
+        }
+
+        while (fgets(line, sizeof(line), fp))
+        {
+            line[strcspn(line, "\r\n")] = '\0';
+            if ((line[0] == '\0') || (line[0] == '#')) continue;
+
+            batchItem_t item;
+            char *comma = strrchr(line, ',');
+            if (comma)
+            {
+                // The file name may have commas, so the fields are found
+                // from the end.  There is an account if the field before
+                // the last is a format's name, or empty.
+                *comma = '\0';
+                char *prev = strrchr(line, ',');
+                if (prev && (('\0' == prev[1]) || isFormatName(prev + 1)))
+                {
+                    item.account = comma + 1;
+                    *prev = '\0';
+                    comma = prev;
+                }
+                item.bankFormat = string2bankFormat(comma + 1);
+            }
+            else
+            {
+                item.bankFormat = UNKNOWN_BANK_FORMAT;
+            }
+            item.inFileName = line;
+            if (UNKNOWN_BANK_FORMAT == item.bankFormat)
+            {
+                item.bankFormat = defaultFormat;
+            }
+            items.push_back(item);
+        }
+        fclose(fp);
+    }
+    else
+    {
+        // Directory: every .csv file in it, compressed or not
+        DIR *dir = opendir(spec);
+        struct dirent *de;
+        std::string path(spec);
+
+        if ((DIR *)(NULL) == dir)
+        {
+            errMsg = std::string("Error opening directory ") + spec;
+            return false;
+        }
+        if (path.size() && (path.back() != '/')) path += '/';
+
+        while ((de = readdir(dir)) != NULL)
+        {
+            if (false == hasCsvExtension(de->d_name)) continue;
+
+            batchItem_t item;
+            item.inFileName = path + de->d_name;
+            item.bankFormat = defaultFormat;
+            items.push_back(item);
+        }
+        closedir(dir);
+
+        // Directory order is arbitrary.  Sort so reports are repeatable.
+        std::sort(items.begin(), items.end()
+                  , [](const batchItem_t &a, const batchItem_t &b) { return a.inFileName < b.inFileName; });
+    }
+
+    // x.csv and x.csv.gz both convert to x.qif.  Two workers must not
+    // write the same file, so that is an error before anything is written.
+    std::map<std::string, const std::string *> outNames;
+    for (const batchItem_t &item : items)
+    {
+        char outFileName[MAX_LINE];
+
+        if (false == qifFileNameFromInput(item.inFileName.c_str(), outFileName, sizeof(outFileName))) continue;
+
+        auto ins = outNames.emplace(outFileName, &item.inFileName);
+        if (false == ins.second)
+        {
+            errMsg = *ins.first->second + " and " + item.inFileName + " both convert to " + outFileName;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int batchConvert(const std::vector<batchItem_t> &items
+                 , int numJobs
+                 , int verbosity
+                 , bool incremental
+                 , DedupIndex *dedup
+                 , const MoneyMarketSymbols &mmSymbols
+                 , const CUSIPBankMap &cusip2bank
+                 , const DescriptionRules &rules
+                 , dateFormat_t dateFormat
+                )
+{
+    std::vector<batchResult_t>  results(items.size());
+    std::vector<std::thread>    workers;
+    std::atomic<size_t>         nextItem(0);
+    auto                        start = std::chrono::steady_clock::now();
+    int                         ret = 0;
+
+    if ((numJobs < 1) || dedup) numJobs = 1;
+    if ((size_t)numJobs > items.size()) numJobs = (int)items.size();
+
+    for (int i = 0; i < numJobs; i++)
+    {
+        workers.emplace_back([&]()
+        {
+            size_t n;
+            while ((n = nextItem++) < items.size())
+            {
+                const batchItem_t &item = items[n];
+                batchResult_t &r = results[n];
+                bankFormat_t bankFormat = item.bankFormat;
+
+                memset(&r.result, 0, sizeof(r.result));
+                if (UNKNOWN_BANK_FORMAT == bankFormat)
+                {
+                    // Done here, in parallel, rather than while collecting
+                    bankFormat = batchFormatForFile(item.inFileName);
+                }
+                if (UNKNOWN_BANK_FORMAT == bankFormat)
+                {
+                    r.ret = -6;
+                    r.outFileName[0] = '\0';
+                    continue;
+                }
+                if (false == qifFileNameFromInput(item.inFileName.c_str(), r.outFileName, sizeof(r.outFileName)))
+                {
+                    r.ret = -3;
+                    continue;
+                }
+
+                // Verbose listing is not printed in batch mode.
+                // Lines from concurrent files would be interleaved.
+                QifConverter converter(bankFormat, verbosity, mmSymbols, cusip2bank);
+                converter.useRules(&rules);
+                converter.useDateFormat(dateFormat);
+                converter.useDedup(dedup);
+                if (incremental)
+                {
+                    incrementalResult_t incResult;
+                    r.ret = convertIncremental(converter, item.inFileName.c_str(), r.outFileName, (FILE *)(NULL), &r.result, &incResult);
+                }
+                else
+                {
+                    r.ret = convertFile(converter, item.inFileName.c_str(), r.outFileName, 1, (FILE *)(NULL), &r.result);
+                }
+            }
+        });
+    }
+
+    for (auto &w : workers)
+    {
+        w.join();
+    }
+
+    double  seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    long    totalTransactions = 0;
+    size_t  totalBytes = 0;
+    int     numFailed = 0;
+
+    for (size_t n = 0; n < items.size(); n++)
+    {
+        const batchResult_t &r = results[n];
+        const char *msg = (const char *)(NULL);
+
+        switch (r.ret)
+        {
+            case 0:                                                 break;
+            case -3:    msg = "Internal error with file names";     break;
+            case -4:    msg = "Error opening input file";           break;
+            case -5:    msg = "Error opening output file";          break;
+            case -6:    msg = "Unknown Bank Format";                break;
+            case -7:    msg = "Error writing output file";          break;
+            case -10:   msg = "Error reading input file";           break;
+            case -11:   msg = "Error writing checkpoint file";      break;
+            default:    msg = "Conversion failed";                  break;
+        }
+
+        if (msg)
+        {
+            fprintf(stderr, "%s: %s\n", items[n].inFileName.c_str(), msg);
+            ++numFailed;
+            ret = -8;
+            continue;
+        }
+
+        totalTransactions += r.result.numTransactions;
+        totalBytes += r.result.bytesIn;
+        if (verbosity >= 1)
+        {
+            double fileSeconds = (r.result.seconds > 0.0) ? r.result.seconds : 1e-9;
+
+            printf("%-40s -> %s: %d transactions, %.1f KB, %.1f ms, %.0f transactions/s, %.2f MB/s\n"
+                   , items[n].inFileName.c_str()
+                   , r.outFileName
+                   , r.result.numTransactions
+                   , r.result.bytesIn / 1024.0
+                   , r.result.seconds * 1000.0
+                   , r.result.numTransactions / fileSeconds
+                   , r.result.bytesIn / (1024.0 * 1024.0) / fileSeconds
+                  );
+        }
+    }
+
+    if (verbosity >= 1)
+    {
+        printf("Number of Files       : %zu (%d failed)\n", items.size(), numFailed);
+        printf("Number of Transactions: %ld\n", totalTransactions);
+        if (dedup)
+        {
+            printf("Duplicates Removed    : %" PRIu64 "\n", dedup->numDuplicates());
+        }
+        printf("Elapsed Time          : %.3f s\n", seconds);
+        if (seconds > 0.0)
+        {
+            printf("Throughput            : %.0f transactions/s, %.2f MB/s\n"
+                   , totalTransactions / seconds
+                   , totalBytes / (1024.0 * 1024.0) / seconds
+                  );
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,62 @@
+#ifndef __BATCHCONVERT_H__
+#define __BATCHCONVERT_H__
+
+#include <string>
+#include <vector>
+#include "bankFormat.h"
+#include "mmSymbols.h"
+#include "cusipBankMap.h"
+#include "descRules.h"
+#include "dateParse.h"
+#include "dedupIndex.h"
+
+// One input file of a batch run
+typedef struct
+{
+    std::string     inFileName;
+    bankFormat_t    bankFormat;
+    std::string     account;        // For mergeConvert(), empty for the file's name
+}   batchItem_t;
+
+// Collect the input files for a batch run.
+// spec is either a directory (every .csv file in it is converted)
+// or @filelist, a text file with one "filename[,format[,account]]" per
+// line.  Files without a format use defaultFormat.  If that is unknown too,
+// batchConvert() finds the format from the file's column header line,
+// or failing that guesses it from the file name.
+// Returns false and sets errMsg if spec can not be read, or if two files
+// would convert to the same .qif (x.csv and x.csv.gz).
+bool batchCollect(const char *spec
+                  , bankFormat_t defaultFormat
+                  , std::vector<batchItem_t> &items
+                  , std::string &errMsg
+                 );
+
+// True for a .csv file name, or .csv.gz / .csv.zst
+bool hasCsvExtension(const char *name);
+
+// The format of a file that did not name one: from its column header
+// line, or failing that from its name
+bankFormat_t batchFormatForFile(const std::string &inFileName);
+
+// Convert every file of the batch, numJobs files at a time.
+// Each .qif is written next to its input, with convertIncremental()
+// if incremental.  With a dedup index, transactions already in it
+// (or in an earlier file) are left out; the files are then converted
+// one at a time, in order, so which file keeps a transaction does not
+// depend on timing.  The lookup tables and description rules are
+// shared by all workers; dates are written in dateFormat.  Prints a
+// per file and total report when verbosity >= 1.  Returns 0 if every
+// file converted, -8 otherwise.
+int batchConvert(const std::vector<batchItem_t> &items
+                 , int numJobs
+                 , int verbosity
+                 , bool incremental
+                 , DedupIndex *dedup
+                 , const MoneyMarketSymbols &mmSymbols
+                 , const CUSIPBankMap &cusip2bank
+                 , const DescriptionRules &rules
+                 , dateFormat_t dateFormat
+                );
+
+#endif
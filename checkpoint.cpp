@@ -0,0 +1,559 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <string>
+#include <chrono>
+#include "checkpoint.h"
+#include "csvInput.h"
+
+uint64_t checkpointRowHash(const char *line, size_t len)
+{
+    // FNV-1a
+    uint64_t h = 14695981039346656037ull;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        h ^= (uint8_t)line[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+bool checkpointLoad(const char *fileName, checkpoint_t *ckpt)
+{
+    FILE    *fp = fopen(fileName, "r");
+    char    line[MAX_LINE];
+    char    name[64];
+    int     version = 0;
+    int     numFound = 0;
+
+    if ((FILE *)(NULL) == fp) return false;
+
+    memset(ckpt, 0, sizeof(*ckpt));
+    if  (   (NULL == fgets(line, sizeof(line), fp))
+         || (sscanf(line, "csv2qifBLS checkpoint %d", &version) != 1)
+         || (CHECKPOINT_VERSION != version)
+        )
+    {
+        fclose(fp);
+        return false;
+    }
+
+    while (fgets(line, sizeof(line), fp))
+    {
+        if (sscanf(line, "format %63s", name) == 1)
+        {
+            ckpt->bankFormat = string2bankFormat(name);
+            ++numFound;
+        }
+        else if (sscanf(line, "offset %" SCNu64, &ckpt->offset) == 1)
+        {
+            ++numFound;
+        }
+        else if (sscanf(line, "transactions %" SCNu64, &ckpt->numTransactions) == 1)
+        {
+            ++numFound;
+        }
+        else if (sscanf(line, "qifSize %" SCNu64, &ckpt->qifSize) == 1)
+        {
+            ++numFound;
+        }
+        else if (strncmp(line, "rows ", 5) == 0)
+        {
+            char *cp = line + 5;
+            char *end;
+
+            ckpt->numRows = (int)strtol(cp, &end, 10);
+            if ((end == cp) || (ckpt->numRows < 0) || (ckpt->numRows > CHECKPOINT_ROWS)) break;
+            for (int i = 0; i < ckpt->numRows; i++)
+            {
+                cp = end;
+                ckpt->rowHashes[i] = strtoull(cp, &end, 16);
+                if (end == cp) break;
+            }
+            if (end == cp) break;
+            ++numFound;
+        }
+    }
+    fclose(fp);
+
+    return (5 == numFound) && (UNKNOWN_BANK_FORMAT != ckpt->bankFormat);
+}
+
+bool checkpointSave(const char *fileName, const checkpoint_t &ckpt)
+{
+    // Write a new file and rename it over the old one, so a run that
+    // stops part way leaves the old checkpoint
+    std::string tmpName = std::string(fileName) + ".tmp";
+    FILE *fp = fopen(tmpName.c_str(), "w");
+
+    if ((FILE *)(NULL) == fp) return false;
+
+    fprintf(fp, "csv2qifBLS checkpoint %d\n", CHECKPOINT_VERSION);
+    fprintf(fp, "format %s\n", bankFormat2string(ckpt.bankFormat));
+    fprintf(fp, "offset %" PRIu64 "\n", ckpt.offset);
+    fprintf(fp, "transactions %" PRIu64 "\n", ckpt.numTransactions);
+    fprintf(fp, "qifSize %" PRIu64 "\n", ckpt.qifSize);
+    fprintf(fp, "rows %d", ckpt.numRows);
+    for (int i = 0; i < ckpt.numRows; i++)
+    {
+        fprintf(fp, " %016" PRIx64, ckpt.rowHashes[i]);
+    }
+    fprintf(fp, "\n");
+
+    bool ok = (0 == ferror(fp));
+    ok = (0 == fclose(fp)) && ok;
+    if  (   (false == ok)
+         || (rename(tmpName.c_str(), fileName) != 0)
+        )
+    {
+        unlink(tmpName.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Oldest first: skip to the last row the checkpoint converted and check
+// it is the same.  On success the next line is the first new row.
+static bool resumeOldestFirst(CsvInput &csvIn, const checkpoint_t &old)
+{
+    char    *line;
+    size_t  lineLen;
+
+    if (old.offset < csvIn.bytesRead()) return false;
+
+    // Nothing was converted last time.  The new rows follow the header.
+    if (0 == old.numRows) return (old.offset == csvIn.bytesRead());
+
+    if  (   (false == csvIn.skip(old.offset - csvIn.bytesRead()))
+         || (false == csvIn.nextLine(&line, &lineLen))
+        )
+    {
+        return false;
+    }
+    return (checkpointRowHash(line, lineLen) == old.rowHashes[0]);
+}
+
+// Oldest first: convert the rows after the checkpoint, or every row if
+// there is no usable one.  Sets *append if the rows are to be appended.
+// Returns 0, or -4 if the input can not be opened again to start over.
+static int convertOldestFirst(QifConverter &converter
+                              , CsvInput &csvIn
+                              , const char *inFileName
+                              , const checkpoint_t *old
+                              , QifOutput &out
+                              , checkpoint_t *ckpt
+                              , bool *append
+                             )
+{
+    char    *line;
+    size_t  lineLen;
+    bool    resumed = false;
+
+    if (old)
+    {
+        resumed = resumeOldestFirst(csvIn, *old);
+        if (false == resumed)
+        {
+            // Start again from the top
+            csvIn.close();
+            if (false == csvIn.open(inFileName))
+            {
+                return -4;
+            }
+            findColumnHeader(converter, csvIn);
+        }
+    }
+
+    if (resumed)
+    {
+        ckpt->offset = old->offset;
+        ckpt->numRows = old->numRows;
+        ckpt->rowHashes[0] = old->rowHashes[0];
+    }
+    else
+    {
+        ckpt->offset = csvIn.bytesRead();
+        ckpt->numRows = 0;
+    }
+
+    for (;;)
+    {
+        uint64_t start = csvIn.bytesRead();
+
+        if (false == csvIn.nextLine(&line, &lineLen)) break;
+
+        uint64_t h = checkpointRowHash(line, lineLen);
+        if (converter.convertLine(line, lineLen, out))
+        {
+            ckpt->offset = start;
+            ckpt->numRows = 1;
+            ckpt->rowHashes[0] = h;
+        }
+    }
+
+    *append = resumed;
+    return 0;
+}
+
+// Newest first: convert rows until the newest rows of the checkpoint
+// are found.  Returns true if they were, and out holds only the rows
+// before them.
+//
+// The rows are found with a KMP failure table, so a partial match that
+// fails can still end in a match that overlaps it: checkpoint rows
+// A,A,B,C are found in A,A,A,B,C, as same-day, same-amount purchases
+// make.
+static bool convertNewestFirst(QifConverter &converter
+                               , CsvInput &csvIn
+                               , const checkpoint_t *old
+                               , QifOutput &out
+                               , checkpoint_t *ckpt
+                              )
+{
+    // Where out stood before each of the last CHECKPOINT_ROWS rows
+    typedef struct
+    {
+        size_t  qif;
+        size_t  log;
+        int     numTransactions;
+    }   rowStart_t;
+
+    char        *line;
+    size_t      lineLen;
+    int         fail[CHECKPOINT_ROWS];
+    rowStart_t  starts[CHECKPOINT_ROWS];
+    int         matched = 0;
+    uint64_t    numConverted = 0;
+
+    ckpt->offset = 0;
+    ckpt->numRows = 0;
+
+    bool search = old && (old->numRows > 0);
+    if (search)
+    {
+        // fail[i]: the longest proper prefix of rowHashes[0..i] that is
+        // also a suffix of it
+        fail[0] = 0;
+        for (int i = 1, k = 0; i < old->numRows; i++)
+        {
+            while (k && (old->rowHashes[i] != old->rowHashes[k])) k = fail[k - 1];
+            if (old->rowHashes[i] == old->rowHashes[k]) ++k;
+            fail[i] = k;
+        }
+    }
+
+    while (csvIn.nextLine(&line, &lineLen))
+    {
+        uint64_t    h = checkpointRowHash(line, lineLen);
+        rowStart_t  start = {out.qif.size(), out.log.size(), out.numTransactions};
+
+        if (false == converter.convertLine(line, lineLen, out)) continue;
+
+        if (ckpt->numRows < CHECKPOINT_ROWS)
+        {
+            ckpt->rowHashes[ckpt->numRows++] = h;
+        }
+
+        if (false == search) continue;
+
+        starts[numConverted++ % CHECKPOINT_ROWS] = start;
+        while (matched && (h != old->rowHashes[matched])) matched = fail[matched - 1];
+        if (h == old->rowHashes[matched]) ++matched;
+        if (matched == old->numRows)
+        {
+            // Everything from the first matched row on was converted
+            // last time
+            const rowStart_t &first = starts[(numConverted - matched) % CHECKPOINT_ROWS];
+
+            out.qif.truncate(first.qif);
+            out.log.resize(first.log);
+            out.numTransactions = first.numTransactions;
+            while (out.marks.size() && (out.marks.back().qif >= first.qif)) out.marks.pop_back();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int convertIncremental(QifConverter &converter
+                       , const char *inFileName
+                       , const char *outFileName
+                       , FILE *fpLog
+                       , convertResult_t *result
+                       , incrementalResult_t *incResult
+                      )
+{
+    const formatDescriptor_t    *format = converter.getFormat();
+    std::string                 ckptName = std::string(outFileName) + CHECKPOINT_EXTENSION;
+    checkpoint_t                old;
+    checkpoint_t                ckpt;
+    struct stat                 st;
+    CsvInput                    csvIn;
+    QifOutput                   out;
+    QifWriter                   qifOut;
+    auto                        start = std::chrono::steady_clock::now();
+
+    result->numTransactions = 0;
+    result->bytesIn = 0;
+    result->seconds = 0.0;
+    incResult->appended = false;
+    incResult->totalTransactions = 0;
+
+    if ((const formatDescriptor_t *)(NULL) == format) return -6;
+
+    // The checkpoint is only any use with the .qif it was written with
+    bool haveOld =  checkpointLoad(ckptName.c_str(), &old)
+                 && (old.bankFormat == format->bankFormat)
+                 && (stat(outFileName, &st) == 0)
+                 && ((uint64_t)st.st_size == old.qifSize);
+
+    if (false == csvIn.open(inFileName))
+    {
+        return -4;
+    }
+    findColumnHeader(converter, csvIn);
+
+    memset(&ckpt, 0, sizeof(ckpt));
+    ckpt.bankFormat = format->bankFormat;
+
+    bool append;
+    if (format->newestFirst)
+    {
+        append = convertNewestFirst(converter, csvIn, haveOld ? &old : (const checkpoint_t *)(NULL), out, &ckpt);
+    }
+    else
+    {
+        int ret = convertOldestFirst(converter, csvIn, inFileName, haveOld ? &old : (const checkpoint_t *)(NULL), out, &ckpt, &append);
+        if (ret != 0)
+        {
+            // Leave the .qif and its checkpoint as they were
+            return ret;
+        }
+    }
+    result->bytesIn = csvIn.bytesRead();
+    if (csvIn.failed())
+    {
+        return -10;
+    }
+    csvIn.close();
+
+    converter.dedupe(out);
+    if (fpLog) fputs(out.log.c_str(), fpLog);
+
+    if (false == qifOut.open(outFileName, append))
+    {
+        return -5;
+    }
+    if (false == append)
+    {
+        qifOut.write("!Type:Bank\n", 11);
+    }
+    qifOut.write(out.qif);
+    if (false == qifOut.close())
+    {
+        return -7;
+    }
+
+    result->numTransactions = out.numTransactions;
+    ckpt.numTransactions = (append ? old.numTransactions : 0) + out.numTransactions;
+    ckpt.qifSize = (stat(outFileName, &st) == 0) ? st.st_size : 0;
+    if (false == checkpointSave(ckptName.c_str(), ckpt))
+    {
+        return -11;
+    }
+
+    incResult->appended = append;
+    incResult->totalTransactions = ckpt.numTransactions;
+    result->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return 0;
+}
+
+#ifdef CHECKPOINT_TEST
+
+// Known answers for resuming from a checkpoint, oldest first and newest
+// first: the rows a second run converts, whether it appends them, and
+// the .qif it leaves, which is the first run's .qif and then the new
+// rows (or, if it could not resume, the whole file converted afresh).
+// Build with:
+//   g++ -O2 -DCHECKPOINT_TEST checkpoint.cpp qifConverter.cpp csvInput.cpp csvParse.cpp
+//       bankFormat.cpp qifWriter.cpp decompressor.cpp dedupIndex.cpp transaction.cpp
+//       descRules.cpp stats.cpp dateParse.cpp rowFilter.cpp mmSymbols.cpp
+//       cusipBankMap.cpp refDb.cpp -lz -lpthread -o checkpointTest
+
+#define BOA_HEAD    "Date,Description,Amount,Running Bal.\n"
+#define BOA_R1      "01/02/2025,PAYROLL ACME,2500.00,3500.00\n"
+#define BOA_R2      "01/03/2025,GROCERY STORE,-123.45,3376.55\n"
+#define BOA_R3      "01/04/2025,ATM WITHDRAWAL,-60.00,3316.55\n"
+#define BOA_R3X     "01/04/2025,ATM WITHDRAWAL,-80.00,3296.55\n"
+#define BOA_R4      "01/05/2025,UTILITY CO,-75.10,3241.45\n"
+#define BOA_R5      "01/06/2025,REFUND,10.00,3251.45\n"
+
+#define FID_HEAD    "Run Date,Action,Symbol,Description,Type,Exchange Quantity,Exchange Currency,Quantity,Currency,Price,Exchange Rate,Commission,Fees,Accrued Interest,Amount,Cash Balance,Settlement Date\n"
+#define FID_ROW(d, a)   d ",\"DIVIDEND RECEIVED ACME CORP (Cash)\",ACME,\"ACME CORP\",Cash,0,,0.000,USD,,0,,,," a ",1000.00,\n"
+#define FID_R1      FID_ROW("01/06/2025", "1.01")
+#define FID_R2      FID_ROW("01/07/2025", "2.02")
+#define FID_R3      FID_ROW("01/08/2025", "3.03")
+#define FID_R4      FID_ROW("01/09/2025", "4.04")
+#define FID_R5      FID_ROW("01/10/2025", "5.05")
+#define FID_R8      FID_ROW("02/08/2025", "8.08")
+#define FID_R9      FID_ROW("02/09/2025", "9.09")
+
+static bool writeText(const std::string &fileName, const char *text)
+{
+    FILE *fp = fopen(fileName.c_str(), "w");
+
+    if ((FILE *)(NULL) == fp) return false;
+    fputs(text, fp);
+    return (0 == fclose(fp));
+}
+
+static std::string readText(const std::string &fileName)
+{
+    FILE        *fp = fopen(fileName.c_str(), "r");
+    std::string s;
+    char        buf[4096];
+    size_t      n;
+
+    if ((FILE *)(NULL) == fp) return s;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) s.append(buf, n);
+    fclose(fp);
+    return s;
+}
+
+// The .qif convertFile() writes for text
+static std::string convertText(bankFormat_t bankFormat, const std::string &dir, const char *text)
+{
+    MoneyMarketSymbols  mmSymbols;
+    CUSIPBankMap        cusip2bank;
+    QifConverter        converter(bankFormat, 0, mmSymbols, cusip2bank);
+    convertResult_t     result;
+    std::string         csvName = dir + "/full.csv";
+    std::string         qifName = dir + "/full.qif";
+
+    if  (   (false == writeText(csvName, text))
+         || (convertFile(converter, csvName.c_str(), qifName.c_str(), 1, (FILE *)(NULL), &result) != 0)
+        )
+    {
+        return "";
+    }
+    return readText(qifName);
+}
+
+int main()
+{
+    const struct {
+        const char      *name;
+        bankFormat_t    bankFormat;
+        const char      *first;         // The export at the first run
+        const char      *second;        // ... and at the second
+        const char      *added;         // The rows the second run adds, as an export
+        bool            appended;
+        int             numNew;
+        int             total;
+    } cases[] = {
+        { "oldest first, rows added",   BOA_FORMAT, BOA_HEAD BOA_R1 BOA_R2 BOA_R3, BOA_HEAD BOA_R1 BOA_R2 BOA_R3 BOA_R4 BOA_R5
+                                            , BOA_HEAD BOA_R4 BOA_R5, true, 2, 5 },
+        { "oldest first, no change",    BOA_FORMAT, BOA_HEAD BOA_R1 BOA_R2 BOA_R3, BOA_HEAD BOA_R1 BOA_R2 BOA_R3
+                                            , BOA_HEAD, true, 0, 3 },
+        { "oldest first, last changed", BOA_FORMAT, BOA_HEAD BOA_R1 BOA_R2 BOA_R3, BOA_HEAD BOA_R1 BOA_R2 BOA_R3X BOA_R4
+                                            , NULL, false, 4, 4 },
+        { "newest first, rows added",   FIDELITY_FORMAT, FID_HEAD FID_R3 FID_R2 FID_R1, FID_HEAD FID_R5 FID_R4 FID_R3 FID_R2 FID_R1
+                                            , FID_HEAD FID_R5 FID_R4, true, 2, 5 },
+        { "newest first, no change",    FIDELITY_FORMAT, FID_HEAD FID_R3 FID_R2 FID_R1, FID_HEAD FID_R3 FID_R2 FID_R1
+                                            , FID_HEAD, true, 0, 3 },
+        { "newest first, oldest gone",  FIDELITY_FORMAT, FID_HEAD FID_R3 FID_R2 FID_R1, FID_HEAD FID_R4 FID_R3 FID_R2
+                                            , NULL, false, 3, 3 },
+        { "newest first, replaced",     FIDELITY_FORMAT, FID_HEAD FID_R3 FID_R2 FID_R1, FID_HEAD FID_R9 FID_R8
+                                            , NULL, false, 2, 2 },
+        { "newest first, same rows",    FIDELITY_FORMAT, FID_HEAD FID_R4 FID_R4 FID_R3 FID_R2, FID_HEAD FID_R4 FID_R4 FID_R4 FID_R3 FID_R2
+                                            , FID_HEAD FID_R4, true, 1, 5 },
+    };
+    char    dirTemplate[] = "/tmp/checkpointTestXXXXXX";
+    char    *dir = mkdtemp(dirTemplate);
+    int     failures = 0;
+
+    if ((char *)(NULL) == dir) {
+        printf("Can not make a directory in /tmp\n");
+        return EXIT_FAILURE;
+    }
+
+    std::string csvName = std::string(dir) + "/in.csv";
+    std::string qifName = std::string(dir) + "/in.qif";
+    std::string ckptName = qifName + CHECKPOINT_EXTENSION;
+
+    for (const auto &c : cases) {
+        MoneyMarketSymbols      mmSymbols;
+        CUSIPBankMap            cusip2bank;
+        convertResult_t         result;
+        incrementalResult_t     incResult;
+        std::string             firstQif;
+        std::string             expected;
+
+        unlink(qifName.c_str());
+        unlink(ckptName.c_str());
+
+        // First run: no checkpoint, so the whole file
+        QifConverter first(c.bankFormat, 0, mmSymbols, cusip2bank);
+        if  (   (false == writeText(csvName, c.first))
+             || (convertIncremental(first, csvName.c_str(), qifName.c_str(), (FILE *)(NULL), &result, &incResult) != 0)
+             || incResult.appended
+            )
+        {
+            printf("%s: first run failed\n", c.name);
+            ++failures;
+            continue;
+        }
+        firstQif = readText(qifName);
+
+        QifConverter second(c.bankFormat, 0, mmSymbols, cusip2bank);
+        if  (   (false == writeText(csvName, c.second))
+             || (convertIncremental(second, csvName.c_str(), qifName.c_str(), (FILE *)(NULL), &result, &incResult) != 0)
+            )
+        {
+            printf("%s: second run failed\n", c.name);
+            ++failures;
+            continue;
+        }
+        if  (   (incResult.appended != c.appended)
+             || (result.numTransactions != c.numNew)
+             || (incResult.totalTransactions != (uint64_t)c.total)
+            )
+        {
+            printf("%s: appended %d, %d new, %" PRIu64 " in all, expected %d, %d, %d\n"
+                   , c.name, incResult.appended, result.numTransactions, incResult.totalTransactions
+                   , c.appended, c.numNew, c.total);
+            ++failures;
+        }
+
+        if (c.appended) {
+            // The new rows' QIF without its "!Type:Bank" line
+            std::string added = convertText(c.bankFormat, dir, c.added);
+            expected = firstQif + added.substr(added.find('\n') + 1);
+        }
+        else {
+            expected = convertText(c.bankFormat, dir, c.second);
+        }
+        if (readText(qifName) != expected) {
+            printf("%s: .qif is\n%s\nexpected\n%s\n", c.name, readText(qifName).c_str(), expected.c_str());
+            ++failures;
+        }
+    }
+
+    unlink(qifName.c_str());
+    unlink(ckptName.c_str());
+    unlink(csvName.c_str());
+    unlink((std::string(dir) + "/full.csv").c_str());
+    unlink((std::string(dir) + "/full.qif").c_str());
+    rmdir(dir);
+
+    printf("%d failures\n", failures);
+    return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif /* CHECKPOINT_TEST */
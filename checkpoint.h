@@ -0,0 +1,79 @@
+#ifndef __CHECKPOINT_H__
+#define __CHECKPOINT_H__
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "qifConverter.h"
+
+// Incremental conversion.  After converting, a small sidecar file next
+// to the .qif (CHECKPOINT_EXTENSION added to its name) records where the
+// conversion got to.  The next run converts only the rows added since
+// and appends them to the .qif.
+//
+// Exports listed oldest first grow at the end.  The checkpoint has the
+// offset of the last converted row and its hash; the next run skips
+// straight to that offset, checks the row is still the same and
+// converts what follows.
+//
+// Exports listed newest first (formatDescriptor_t newestFirst) grow at
+// the top.  The checkpoint has the hashes of the first (newest)
+// CHECKPOINT_ROWS transactions; the next run converts rows until it
+// finds those rows one after the other, which is where the rows it has
+// already converted start, and stops there.
+//
+// If the checkpoint does not fit the file (a different format, a row
+// that changed, a .qif that was edited or removed) the whole file is
+// converted and the .qif written afresh, as without a checkpoint.
+//
+// Sidecar format, one "name value" per line:
+//      csv2qifBLS checkpoint 1
+//      format Fidelity
+//      offset 12345
+//      transactions 532
+//      qifSize 40960
+//      rows 4 9f3a... 12ab... ...
+
+#define CHECKPOINT_EXTENSION    ".ckpt"
+#define CHECKPOINT_VERSION      1
+#define CHECKPOINT_ROWS         4
+
+typedef struct
+{
+    bankFormat_t    bankFormat;
+    uint64_t        offset;             // Oldest first: start of the last converted row
+    uint64_t        numTransactions;    // In the .qif
+    uint64_t        qifSize;            // Size of the .qif when written
+    int             numRows;
+    uint64_t        rowHashes[CHECKPOINT_ROWS]; // Oldest first: the last converted row.
+                                                // Newest first: the newest rows, newest first.
+}   checkpoint_t;
+
+// Hash of a CSV row as read, before it is converted
+uint64_t checkpointRowHash(const char *line, size_t len);
+
+// Read a checkpoint.  Returns false if there is none or it can not be used.
+bool checkpointLoad(const char *fileName, checkpoint_t *ckpt);
+
+// Write a checkpoint, replacing the old one in one step
+bool checkpointSave(const char *fileName, const checkpoint_t &ckpt);
+
+// How an incremental conversion went
+typedef struct
+{
+    bool        appended;           // Rows were added to the .qif from the checkpoint
+    uint64_t    totalTransactions;  // Now in the .qif
+}   incrementalResult_t;
+
+// Convert one CSV file to a QIF file incrementally, as described above.
+// result counts the transactions converted by this run only.  Returns
+// the same as convertFile(), or -11 if the checkpoint can not be written.
+int convertIncremental(QifConverter &converter
+                       , const char *inFileName
+                       , const char *outFileName
+                       , FILE *fpLog
+                       , convertResult_t *result
+                       , incrementalResult_t *incResult
+                      );
+
+#endif
@@ -1,171 +1,38 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <stdbool.h>
 #include <stdarg.h>
 #include <string.h>
+#include <strings.h>
 #include <ctype.h>
 #include <getopt.h>
+#include <unistd.h>
+#include <chrono>
 #include "mmSymbols.h"
 #include "cusipBankMap.h"
-
-#define MAX_LINE 4096
-#define MAX_FIELDS  32
-
-const char *SW_VERSION =    "1.04";
-const char *SW_DATE =       "2025-12-06";
+#include "refDb.h"
+#include "bankFormat.h"
+#include "csvInput.h"
+#include "qifConverter.h"
+#include "batchConvert.h"
+#include "mergeConvert.h"
+#include "checkpoint.h"
+#include "dedupIndex.h"
+#include "stats.h"
+#include "jobServer.h"
+#include "watchConvert.h"
+#include "transactionWriter.h"
+#include "transactionCache.h"
+
+const char *SW_VERSION =    "1.20";
+const char *SW_DATE =       "2026-10-16";
 
 const char *DELIMITER_STRING =  ",";
 
 #define COLLAPSE_FLAG   (0)
 
-typedef enum
-{
-    UNKNOWN_BANK_FORMAT
-    , BOA_FORMAT
-    , CITI_FORMAT
-    , FIDELITY_FORMAT
-    , SCHWAB_BANK_FORMAT
-    , SCHWAB_BROKERAGE_FORMAT
-}   bankFormat_t;
-
-// Remove surrounding quotes from a field, if present
-void strip_quotes(char *s) {
-    size_t len = strlen(s);
-    if (len >= 2 && s[0] == '"' && s[len-1] == '"') {
-        memmove(s, s+1, len-2);
-        s[len-2] = '\0';
-    }
-}
-
-// Remove all quotes from a line.
-// This will remove quotes from within a field
-// so only do this when trying to find the
-// column header line 
-void remove_all_quotes(char *s) {
-    char *dst = s, *src = s;
-    while (*src) {
-        if  (*src != '"')
-        {
-            *dst++ = *src;
-        }
-        src++;
-    }
-    *dst = '\0';
-}
-
-// Remove all commas from a number field
-void remove_commas_and_dollars(char *s) {
-    char *dst = s, *src = s;
-    while (*src) {
-        if  (   (*src != ',')
-             && (*src != '$')
-            )
-        {
-            *dst++ = *src;
-        }
-        src++;
-    }
-    *dst = '\0';
-}
-
-char *strcasestr_simple(const char *hay, const char *needle) {
-    size_t nlen = strlen(needle);
-    if (nlen == 0) return (char *)hay;
-    for (; *hay; hay++) {
-        if (tolower((unsigned char)*hay) == tolower((unsigned char)*needle)) {
-            if (strncasecmp(hay, needle, nlen) == 0) return (char *)hay;
-        }
-    }
-    return NULL;
-}
-
-// Parse a CSV line into fields handling quoted fields and empty fields.
-// Returns number of fields parsed (up to max_fields).
-int parse_csv_line(const char *line, char fields[][MAX_LINE], int max_fields) {
-    int fi = 0;
-    const char *p = line;
-
-    while (*p != '\0' && fi < max_fields) {
-        char *out = fields[fi];
-        int o = 0;
-
-        if (*p == '"') {
-            // Quoted field
-            p++; // skip opening quote
-            while (*p != '\0') {
-                if (*p == '"') {
-                    // Handle escaped double quotes
-                    if (*(p+1) == '"') {
-                        out[o++] = '"';
-                        p += 2;
-                        continue;
-                    }
-                    p++; // closing quote
-                    break;
-                }
-                out[o++] = *p++;
-            }
-            // Skip until comma or end
-            while (*p != '\0' && *p != ',') p++;
-            if (*p == ',') p++;
-        } else {
-            // Unquoted field
-            while (*p != '\0' && *p != ',') {
-                out[o++] = *p++;
-            }
-            if (*p == ',') p++;
-        }
-
-        out[o] = '\0';
-        fi++;
-    }
-
-    // Handle trailing commas meaning empty fields
-    int len = strlen(line);
-    for (int i = len - 1; i >= 0; i--) {
-        if (line[i] == ',') {
-            if (fi < max_fields) {
-                fields[fi][0] = '\0';
-                fi++;
-            }
-        } else break;
-    }
-
-    return fi;
-}
-
-bankFormat_t string2bankFormat(const char *s)
-{
-    bankFormat_t    ret = UNKNOWN_BANK_FORMAT;
-
-    if (strcasestr_simple(s, "boa"))
-    {
-        ret = BOA_FORMAT;
-    }
-    else if (strcasestr_simple(s, "citi"))
-    {
-        ret = CITI_FORMAT;
-    }
-    else if (strcasestr_simple(s, "fid"))
-    {
-        ret = FIDELITY_FORMAT;
-    }
-    else if (strcasestr_simple(s, "schwabbank"))
-    {
-        ret = SCHWAB_BANK_FORMAT;
-    }
-    else if (strcasestr_simple(s, "schwabbrok"))
-    {
-        ret = SCHWAB_BROKERAGE_FORMAT;
-    }
-    else
-    {
-        ret = UNKNOWN_BANK_FORMAT;
-    }
-    return ret;
-}
-
 void usage(const char *prog, const char *extraLine = (const char *)(NULL));
 
 void usage(const char *prog, const char *extraLine)
@@ -174,9 +41,20 @@ void usage(const char *prog, const char *extraLine)
     fprintf(stderr, "usage: %s <options>\n", prog);
     fprintf(stderr, "-i --input filename       input .csv file.\n");
     fprintf(stderr, "                          Extension will be added if not provided.\n");
+    fprintf(stderr, "                          - reads standard input.  gzip (and zstd, if\n");
+    fprintf(stderr, "                          built with it) compressed input is\n");
+    fprintf(stderr, "                          decompressed on a thread of its own.\n");
     fprintf(stderr, "-o --output filename      output .qif file.\n");
     fprintf(stderr, "                          Filename will be generated from input filename\n");
-    fprintf(stderr, "                          if not provided.\n");
+    fprintf(stderr, "                          if not provided.  - (or no -o with -i -) writes\n");
+    fprintf(stderr, "                          standard output, and everything else goes to\n");
+    fprintf(stderr, "                          standard error.  May be given more than once\n");
+    fprintf(stderr, "                          to write several files from one parse.  The\n");
+    fprintf(stderr, "                          extension picks the format: .ofx (OFX bank\n");
+    fprintf(stderr, "                          statement, investment statement for Fidelity\n");
+    fprintf(stderr, "                          and SchwabBrokerage), .tsv or .csv (date,\n");
+    fprintf(stderr, "                          description, amount, symbol), anything else\n");
+    fprintf(stderr, "                          QIF.\n");
     fprintf(stderr, "-f --format Bank          Different banks format CSV files differently.\n");
     fprintf(stderr, "                          Possible selections are as follows:\n");
     fprintf(stderr, "                             BoA\n");
@@ -184,63 +62,98 @@ void usage(const char *prog, const char *extraLine)
     fprintf(stderr, "                             Fidelity\n");
     fprintf(stderr, "                             SchwabBank\n");
     fprintf(stderr, "                             SchwabBrokerage\n");
+    fprintf(stderr, "                             auto (the default)\n");
+    fprintf(stderr, "                          auto finds the format from the column header\n");
+    fprintf(stderr, "                          line near the start of the file.\n");
     fprintf(stderr, "-q --quiet                Quiet running (or decrease verbosity).\n");
     fprintf(stderr, "-v --verbose              Increase verbosity\n");
+    fprintf(stderr, "-j --jobs N               Convert using N threads.\n");
+    fprintf(stderr, "                          Only used for regular files.\n");
+    fprintf(stderr, "-b --batch dir|@filelist  Convert every .csv file in dir, or every file\n");
+    fprintf(stderr, "                          listed in filelist (one\n");
+    fprintf(stderr, "                          \"filename[,Bank[,Account]]\" per line).  -f is\n");
+    fprintf(stderr, "                          the default Bank.  Without it the\n");
+    fprintf(stderr, "                          Bank is found from the file's header line, or\n");
+    fprintf(stderr, "                          guessed from the file name.  Each .qif is\n");
+    fprintf(stderr, "                          written next to its input.  -j sets how many files\n");
+    fprintf(stderr, "                          are converted at once.\n");
+    fprintf(stderr, "-M --merge filename       With -b, write every account to the one QIF\n");
+    fprintf(stderr, "                          filename, an !Account block each, the\n");
+    fprintf(stderr, "                          transactions of an account's files merged in\n");
+    fprintf(stderr, "                          date order.  A file's account is the one in the\n");
+    fprintf(stderr, "                          filelist, or its name without the extension.\n");
+    fprintf(stderr, "-A --accounts dir         Like -M, but each account to dir/Account.qif.\n");
+    fprintf(stderr, "-u --incremental          Convert only the rows added since the last run\n");
+    fprintf(stderr, "                          and append them to the .qif.  Where the last\n");
+    fprintf(stderr, "                          run got to is kept in the .qif%s file.\n", CHECKPOINT_EXTENSION);
+    fprintf(stderr, "                          Not for standard input or output.\n");
+    fprintf(stderr, "-d --dedup                In batch mode, leave out transactions already\n");
+    fprintf(stderr, "                          converted from an earlier file: the same date,\n");
+    fprintf(stderr, "                          description and amount.  Identical rows within\n");
+    fprintf(stderr, "                          one file are all kept.\n");
+    fprintf(stderr, "-D --dedup-index filename Like -d, and also leave out the transactions\n");
+    fprintf(stderr, "                          remembered in filename by earlier runs, then\n");
+    fprintf(stderr, "                          remember this run's there too.\n");
+    fprintf(stderr, "-r --refdb filename       CD CUSIP and money market symbol reference\n");
+    fprintf(stderr, "                          database built by csv2qifRefDb.  Replaces the\n");
+    fprintf(stderr, "                          built-in tables.\n");
+    fprintf(stderr, "-R --rules filename       More description rewriting rules, one\n");
+    fprintf(stderr, "                          \"class,prefix,replacement\" per line: a money\n");
+    fprintf(stderr, "                          market (mm), T-Bill (tbill) or CD (cd)\n");
+    fprintf(stderr, "                          description starting with prefix (any case)\n");
+    fprintf(stderr, "                          becomes replacement, where {symbol} is the\n");
+    fprintf(stderr, "                          symbol and {bank} the CD's bank.  They are\n");
+    fprintf(stderr, "                          tried before the built-in rules.\n");
+    fprintf(stderr, "   --date-format format   Write dates as mdy (MM/DD/YYYY), dmy\n");
+    fprintf(stderr, "                          (DD/MM/YYYY) or iso (YYYY-MM-DD) whatever the\n");
+    fprintf(stderr, "                          bank's style, or asis (the default) as the\n");
+    fprintf(stderr, "                          export has them.\n");
+    fprintf(stderr, "   --serve socket         Stay running as a conversion server, taking\n");
+    fprintf(stderr, "                          jobs from csv2qifClient over the local socket,\n");
+    fprintf(stderr, "                          -j at a time, with the tables, rules and date\n");
+    fprintf(stderr, "                          format loaded once for all of them.  Stops on\n");
+    fprintf(stderr, "                          SIGINT or SIGTERM.\n");
+    fprintf(stderr, "   --watch dir            Stay running and convert each .csv file\n");
+    fprintf(stderr, "                          written to (or moved into) dir, -j at a time,\n");
+    fprintf(stderr, "                          once it has been left alone for %d ms.  The\n", WATCH_SETTLE_MS);
+    fprintf(stderr, "                          .qif is written next to it, whole or not at\n");
+    fprintf(stderr, "                          all.  Files already in dir are converted\n");
+    fprintf(stderr, "                          first.  Converted files are remembered in\n");
+    fprintf(stderr, "                          dir/%s and not converted again\n", WATCH_STATE_FILE);
+    fprintf(stderr, "                          unless they change.  Stops on SIGINT or\n");
+    fprintf(stderr, "                          SIGTERM.\n");
+    fprintf(stderr, "   --from date            Only the transactions dated date (M/D/YYYY or\n");
+    fprintf(stderr, "                          YYYY-MM-DD) or later.\n");
+    fprintf(stderr, "   --to date              Only the transactions dated date or earlier.\n");
+    fprintf(stderr, "                          Rows outside the dates are dropped as soon as\n");
+    fprintf(stderr, "                          their date is read.  An export in date order\n");
+    fprintf(stderr, "                          (newest or oldest first) read a line at a time\n");
+    fprintf(stderr, "                          (-j 1, or standard or compressed input) is\n");
+    fprintf(stderr, "                          only read until past the dates.\n");
+    fprintf(stderr, "   --symbol SYM[,SYM...]  Only the transactions of these symbols.\n");
+    fprintf(stderr, "   --desc text            Only the transactions whose description, as\n");
+    fprintf(stderr, "                          in the export, contains text (any case).  May\n");
+    fprintf(stderr, "                          be given more than once, for any of them.\n");
+    fprintf(stderr, "   --cache                Keep the converted transactions in a columnar\n");
+    fprintf(stderr, "                          cache next to the input (input%s) and read\n", TXN_CACHE_EXTENSION);
+    fprintf(stderr, "                          them from there, without parsing the CSV, while\n");
+    fprintf(stderr, "                          the input, -f, -r and -R stay the same.  With\n");
+    fprintf(stderr, "                          --from and --to only the part of the cache\n");
+    fprintf(stderr, "                          with those dates is read.\n");
+    fprintf(stderr, "   --stats[=json]         Report where the time went: each stage's time,\n");
+    fprintf(stderr, "                          rows/s and MB/s, rows skipped and why, lookup\n");
+    fprintf(stderr, "                          hits and peak memory.  json prints it as one\n");
+    fprintf(stderr, "                          JSON object.\n");
     if (extraLine) fprintf(stderr, "\n%s\n", extraLine);
 }
 
-void modifyCDDescription(char *desc, const char *bankName)
+// The --stats report of everything since start
+static void printStats(FILE *fp, std::chrono::steady_clock::time_point start, bool json)
 {
-    if (strncasecmp(desc, "INTEREST", 8) == 0)
-    {
-        strcpy(desc, bankName);
-        strcat(desc, " - Interest");
-    }
-    else if ((strncasecmp(desc, "REDEMPTION", 10) == 0))
-    {
-        strcpy(desc, bankName);
-        strcat(desc, " - Redemption");
-    }
-}
-
-void modifyMMDescription(char *desc, char *symbol)
-{
-    if  (   (strncasecmp(desc, "DIVIDEND", 8) == 0)
-         || (strncasecmp(desc, "Reinvest Dividend", 17) == 0)
-         || (strncasecmp(desc, "Cash Dividend", 13) == 0)
-        )
-    {
-        strcpy(desc, symbol);
-        strcat(desc, " Dividend");
-    }
-    else if (   (strncasecmp(desc, "REINVESTMENT", 12) == 0)
-             || (strncasecmp(desc, "YOU BOUGHT", 10) == 0)
-             || (strncasecmp(desc, "Reinvest Shares", 15) == 0)
-             || (strncasecmp(desc, "Buy", 3) == 0)
-            )
-    {
-        strcpy(desc, symbol);
-        strcat(desc, " Purchase");
-    }
-    else if (   (strncasecmp(desc, "YOU SOLD", 8) == 0)
-             || (strncasecmp(desc, "Sell", 4) == 0)
-            )
-    {
-        strcpy(desc, symbol);
-        strcat(desc, " Sale");
-    }
-}
+    stats_t total;
 
-void modifyTBillDescription(char *desc)
-{
-    if (strncasecmp(desc, "YOU BOUGHT", 10) == 0)
-    {
-        strcpy(desc, "T-Bill Purchase");
-    }
-    else if ((strncasecmp(desc, "REDEMPTION", 10) == 0))
-    {
-        strcpy(desc, "T-Bill Redemption");
-    }
+    statsTotal(&total);
+    statsPrint(fp, total, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), json);
 }
 
 int main(int argc, char *argv[])
@@ -248,24 +161,38 @@ int main(int argc, char *argv[])
     int                 opt;
     char                inFileName[MAX_LINE];
     char                outFileName[MAX_LINE];
+    std::vector<std::string> moreOutFileNames;     // -o after the first
+    char                *batchSpec = (char *)(NULL);
+    char                *refDbFileName = (char *)(NULL);
+    char                *rulesFileName = (char *)(NULL);
+    char                *mergedFileName = (char *)(NULL);
+    char                *accountDir = (char *)(NULL);
+    char                *socketPath = (char *)(NULL);
+    char                *watchDir = (char *)(NULL);
+    bool                statsJson = false;
+    bool                useCache = false;
+    dateRange_t         dateRange = {0, 0};
+    RowFilter           rowFilter;
+    dateFormat_t        dateFormat = DATE_AS_IS;
     bool                usageError = false;
+    bool                formatGiven = false;
+    bool                incremental = false;
+    bool                dedupGiven = false;
+    char                *dedupFileName = (char *)(NULL);
+    DedupIndex          dedupIndex;
+    DedupIndex          *dedup = (DedupIndex *)(NULL);
     char                *cp;
-    FILE                *fpIn;
-    FILE                *fpOut;
-    bool                inTransactionSection = false;
-    char                line[MAX_LINE];
-    char                date[MAX_LINE];
-    char                amt[MAX_LINE];
-    char                desc[MAX_LINE];
-    char                symbol[MAX_LINE];
-    char                cashBal[MAX_LINE];
-    char                fields[MAX_FIELDS][MAX_LINE];
+    int                 ret;
+    convertResult_t     result;
     int                 numTransactions = 0;
-    double              withdrawModifier = 1.0;
+    int                 numJobs = 1;
     int                 verbosity = 1;
     bankFormat_t        bankFormat = UNKNOWN_BANK_FORMAT;
     MoneyMarketSymbols  mmSymbols;
     CUSIPBankMap        cusip2bank;
+    RefDb               refDb;
+    DescriptionRules    rules;
+    auto                start = std::chrono::steady_clock::now();
 
     inFileName[0] = '\0';
     outFileName[0] = '\0';
@@ -277,13 +204,31 @@ int main(int argc, char *argv[])
         ,{"format",     required_argument,  0,      'f'}
         ,{"quiet",      no_argument,        0,      'q'}
         ,{"verbose",    no_argument,        0,      'v'}
+        ,{"jobs",       required_argument,  0,      'j'}
+        ,{"batch",      required_argument,  0,      'b'}
+        ,{"refdb",      required_argument,  0,      'r'}
+        ,{"incremental",no_argument,        0,      'u'}
+        ,{"dedup",      no_argument,        0,      'd'}
+        ,{"dedup-index",required_argument,  0,      'D'}
+        ,{"rules",      required_argument,  0,      'R'}
+        ,{"merge",      required_argument,  0,      'M'}
+        ,{"accounts",   required_argument,  0,      'A'}
+        ,{"stats",      optional_argument,  0,      'S'}
+        ,{"date-format",required_argument,  0,      'F'}
+        ,{"serve",      required_argument,  0,      'L'}
+        ,{"watch",      required_argument,  0,      'W'}
+        ,{"from",       required_argument,  0,      'B'}
+        ,{"to",         required_argument,  0,      'E'}
+        ,{"cache",      no_argument,        0,      'C'}
+        ,{"symbol",     required_argument,  0,      'Y'}
+        ,{"desc",       required_argument,  0,      'K'}
         ,{0,0,0,0}
     };
 
     while (1)
     {
         int optionIndex = 0;
-        opt = getopt_long(argc, argv, "i:o:f:qv", longOptions, &optionIndex);
+        opt = getopt_long(argc, argv, "i:o:f:qvj:b:r:udD:R:M:A:", longOptions, &optionIndex);
 
         if (-1 == opt) break;
 
@@ -293,10 +238,20 @@ int main(int argc, char *argv[])
             strcpy(inFileName, optarg);
             break;
         case 'o':
-            strcpy(outFileName, optarg);
+            if (outFileName[0]) moreOutFileNames.push_back(optarg);
+            else strcpy(outFileName, optarg);
             break;
         case 'f':
-            bankFormat = string2bankFormat(optarg);
+            if (strcasecmp(optarg, "auto") == 0)
+            {
+                bankFormat = UNKNOWN_BANK_FORMAT;
+                formatGiven = false;
+            }
+            else
+            {
+                bankFormat = string2bankFormat(optarg);
+                formatGiven = true;
+            }
             break;
         case 'q':
             --verbosity;
@@ -304,6 +259,66 @@ int main(int argc, char *argv[])
         case 'v':
             ++verbosity;
             break;
+        case 'j':
+            numJobs = atoi(optarg);
+            if (numJobs < 1) usageError = true;
+            break;
+        case 'b':
+            batchSpec = optarg;
+            break;
+        case 'r':
+            refDbFileName = optarg;
+            break;
+        case 'u':
+            incremental = true;
+            break;
+        case 'd':
+            dedupGiven = true;
+            break;
+        case 'D':
+            dedupGiven = true;
+            dedupFileName = optarg;
+            break;
+        case 'R':
+            rulesFileName = optarg;
+            break;
+        case 'M':
+            mergedFileName = optarg;
+            break;
+        case 'A':
+            accountDir = optarg;
+            break;
+        case 'L':
+            socketPath = optarg;
+            break;
+        case 'W':
+            watchDir = optarg;
+            break;
+        case 'B':
+            dateRange.from = parseDate(optarg, strlen(optarg), (size_t *)(NULL));
+            if (0 == dateRange.from) usageError = true;
+            break;
+        case 'E':
+            dateRange.to = parseDate(optarg, strlen(optarg), (size_t *)(NULL));
+            if (0 == dateRange.to) usageError = true;
+            break;
+        case 'C':
+            useCache = true;
+            break;
+        case 'Y':
+            if (false == rowFilter.addSymbols(optarg)) usageError = true;
+            break;
+        case 'K':
+            rowFilter.addDesc(optarg);
+            break;
+        case 'F':
+            if (false == string2dateFormat(optarg, &dateFormat)) usageError = true;
+            break;
+        case 'S':
+            statsEnabled = true;
+            if (optarg && (strcmp(optarg, "json") == 0)) statsJson = true;
+            else if (optarg) usageError = true;
+            break;
         default:
             usageError = true;
             break;
@@ -316,14 +331,137 @@ int main(int argc, char *argv[])
         return -1;
     }
 
-    if (UNKNOWN_BANK_FORMAT == bankFormat)
+    if (mergedFileName || accountDir)
+    {
+        const char *msg = (const char *)(NULL);
+
+        if ((char *)(NULL) == batchSpec)        msg = "-M and -A need -b";
+        else if (mergedFileName && accountDir)  msg = "-M and -A can not be used together";
+        else if (incremental || dedupGiven)     msg = "-M and -A do not work with -u, -d or -D";
+        if (msg)
+        {
+            usage(basename(argv[0]), msg);
+            return -2;
+        }
+    }
+
+    if (socketPath && (inFileName[0] || outFileName[0] || batchSpec || incremental || dedupGiven || formatGiven || watchDir))
+    {
+        usage(basename(argv[0]), "--serve takes its input, output and format from each job");
+        return -2;
+    }
+
+    if (watchDir && (inFileName[0] || outFileName[0] || batchSpec || incremental || dedupGiven || mergedFileName || accountDir))
+    {
+        usage(basename(argv[0]), "--watch converts the files in its directory, with -f, -j, -r, -R and --date-format");
+        return -2;
+    }
+
+    rowFilter.setDateRange(dateRange);
+    if ((useCache || rowFilter.active()) && (socketPath || watchDir || batchSpec))
+    {
+        usage(basename(argv[0]), "--cache, --from, --to, --symbol and --desc are for one input file (-i)");
+        return -2;
+    }
+
+    if (dateRange.from && dateRange.to && (dateRange.from > dateRange.to))
+    {
+        usage(basename(argv[0]), "--from is after --to");
+        return -2;
+    }
+
+    if (useCache && rowFilter.hasDescs())
+    {
+        usage(basename(argv[0]), "--desc tests the export's descriptions, which --cache does not keep");
+        return -2;
+    }
+
+    if (formatGiven && (UNKNOWN_BANK_FORMAT == bankFormat))
     {
         usage(basename(argv[0]), "Unknown Bank Format");
         return -6;
     }
-    else
+
+    if (refDbFileName)
+    {
+        std::string errMsg;
+
+        if (false == refDb.open(refDbFileName, errMsg))
+        {
+            usage(basename(argv[0]), errMsg.c_str());
+            return -9;
+        }
+        mmSymbols.use(&refDb);
+        cusip2bank.use(&refDb);
+    }
+
+    if (rulesFileName)
     {
-        printf("Bank Format: %d\n", (int)bankFormat);
+        std::string errMsg;
+
+        if (false == rules.load(rulesFileName, errMsg))
+        {
+            usage(basename(argv[0]), errMsg.c_str());
+            return -9;
+        }
+    }
+
+    if (dedupGiven)
+    {
+        std::string errMsg;
+
+        if (dedupFileName && (false == dedupIndex.open(dedupFileName, errMsg)))
+        {
+            usage(basename(argv[0]), errMsg.c_str());
+            return -9;
+        }
+        dedup = &dedupIndex;
+    }
+
+    if (socketPath)
+    {
+        ret = serverRun(socketPath, numJobs, verbosity, mmSymbols, cusip2bank, rules, dateFormat);
+        if (statsEnabled) printStats(stdout, start, statsJson);
+        return ret;
+    }
+
+    if (watchDir)
+    {
+        ret = watchRun(watchDir, bankFormat, numJobs, verbosity, mmSymbols, cusip2bank, rules, dateFormat);
+        if (statsEnabled) printStats(stdout, start, statsJson);
+        return ret;
+    }
+
+    if (batchSpec)
+    {
+        std::vector<batchItem_t>    items;
+        std::string                 errMsg;
+
+        if (false == batchCollect(batchSpec, bankFormat, items, errMsg))
+        {
+            usage(basename(argv[0]), errMsg.c_str());
+            return -2;
+        }
+        if (mergedFileName || accountDir)
+        {
+            ret = mergeConvert(items, numJobs, verbosity, mergedFileName, accountDir, mmSymbols, cusip2bank, rules, dateFormat);
+        }
+        else
+        {
+            ret = batchConvert(items, numJobs, verbosity, incremental, dedup, mmSymbols, cusip2bank, rules, dateFormat);
+        }
+        if (dedup)
+        {
+            std::string errMsg;
+
+            if (false == dedup->save(errMsg))
+            {
+                usage(basename(argv[0]), errMsg.c_str());
+                return -12;
+            }
+        }
+        if (statsEnabled) printStats(stdout, start, statsJson);
+        return ret;
     }
 
     // strcpy(inFileName, "/home/bruno/Downloads/schwab.csv");
@@ -333,30 +471,68 @@ int main(int argc, char *argv[])
         return -2;
     }
 
-    cp = strchr(inFileName, '.');
-    if ((char *)(NULL) == cp)
+    // - is standard input or output.  QIF on standard output is
+    // written as it is converted, so the summary goes to stderr.
+    bool    inStdin = (strcmp(inFileName, "-") == 0);
+    bool    outStdout = (strcmp(outFileName, "-") == 0) || (inStdin && ('\0' == outFileName[0]));
+    int     numStdout = outStdout ? 1 : 0;
+
+    for (std::string &name : moreOutFileNames)
+    {
+        if (name == "-")
+        {
+            name = "(stdout)";
+            ++numStdout;
+        }
+        else if (std::string::npos == name.find('.'))
+        {
+            name += ".qif";
+        }
+    }
+    if (numStdout > 1)
+    {
+        usage(basename(argv[0]), "Only one output can be standard output");
+        return -2;
+    }
+
+    FILE    *fpInfo = numStdout ? stderr : stdout;
+
+    if (incremental && (inStdin || numStdout))
+    {
+        usage(basename(argv[0]), "-u needs an input and an output file");
+        return -2;
+    }
+
+    if (useCache && inStdin)
+    {
+        usage(basename(argv[0]), "--cache needs an input file");
+        return -2;
+    }
+
+    if (inStdin)
+    {
+        strcpy(inFileName, "(stdin)");
+    }
+    else if ((char *)(NULL) == strchr(inFileName, '.'))
     {
         // No extension provided.  Add .csv
         strcat(inFileName, ".csv");
     }
 
-    if ('\0' == outFileName[0])
+    if (outStdout)
+    {
+        strcpy(outFileName, "(stdout)");
+    }
+    else if ('\0' == outFileName[0])
     {
         // Create output file name from input file name
-        strcpy(outFileName, inFileName);
-        cp = strrchr(outFileName, '.');
-        if ((char *)(NULL) == cp)
+        if (false == qifFileNameFromInput(inFileName, outFileName, sizeof(outFileName)))
         {
             // Something went wrong because there should
             // definately be a '.' in the filename
             usage(basename(argv[0]), "Internal error with file names");
             return -3;
         }
-        else
-        {
-            *cp = '\0';
-            strcat(outFileName, ".qif");
-        }
     }
     else
     {
@@ -370,209 +546,265 @@ int main(int argc, char *argv[])
         }
     }
 
-    fpIn = fopen(inFileName, "r");
-    if ((FILE *)(NULL) == fpIn)
+    // Anything but one QIF is written from one parse (or the cache) by
+    // TransactionWriters
+    bool multiOutput =  moreOutFileNames.size()
+                     || (OUTPUT_QIF != outputFormatForFile(outFileName))
+                     || useCache;
+
+    if (multiOutput && incremental)
     {
-        usage(basename(argv[0]), "Error opening input file");
-        return -4;
+        usage(basename(argv[0]), "-u writes a single .qif, without --cache");
+        return -2;
     }
 
-    fpOut = fopen(outFileName, "w");
-    if ((FILE *)(NULL) == fpOut)
+    if (incremental && rowFilter.active())
     {
-        usage(basename(argv[0]), "Error opening output file");
-        fclose(fpIn);
-        return -5;
+        usage(basename(argv[0]), "-u converts every new row; it can not be used with --from, --to, --symbol or --desc");
+        return -2;
     }
 
-    fprintf(fpOut, "!Type:Bank\n");
+    CsvInput    csvIn;
+    QifWriter   qifOut;
+    const char  *head;
+    size_t      headLen;
 
-    while (fgets(line, sizeof(line), fpIn))
+    if (false == (inStdin ? csvIn.open(stdin) : csvIn.open(inFileName)))
     {
-        // Remove newline
-        line[strcspn(line, "\r\n")] = '\0';
+        if (false == compressionSupported(csvIn.getCompression()))
+        {
+            usage(basename(argv[0]), "zstd input needs a build with HAVE_ZSTD (make ZSTD=1)");
+        }
+        else
+        {
+            usage(basename(argv[0]), "Error opening input file");
+        }
+        return -4;
+    }
 
-        if (line[0] == '\0') continue;
+    // Check the format against the file's column header line.
+    // With the wrong format no header line is found and nothing
+    // would be converted.
+    csvIn.peek(&head, &headLen, SNIFF_SIZE);
+    bankFormat_t sniffedFormat = sniffBankFormat(head, headLen);
+    if (UNKNOWN_BANK_FORMAT == bankFormat)
+    {
+        bankFormat = sniffedFormat;
+        if (UNKNOWN_BANK_FORMAT == bankFormat)
+        {
+            usage(basename(argv[0]), "Unknown Bank Format.  Use -f to give it.");
+            return -6;
+        }
+    }
+    else if (   (UNKNOWN_BANK_FORMAT != sniffedFormat)
+             && (sniffedFormat != bankFormat)
+            )
+    {
+        fprintf(stderr, "Warning: %s looks like a %s export, not %s\n"
+                , inFileName, bankFormat2string(sniffedFormat), bankFormat2string(bankFormat));
+    }
+    fprintf(fpInfo, "Bank Format: %d\n", (int)bankFormat);
+
+    QifConverter converter(bankFormat, verbosity, mmSymbols, cusip2bank);
+    incrementalResult_t incResult;
+    TransactionCache    cache;
+    std::string         cacheFileName;
+    std::string         cacheState;
+
+    converter.useRules(&rules);
+    converter.useDateFormat(dateFormat);
+    converter.useDedup(dedup);
+    converter.useFilter(&rowFilter);
 
-        if (false == inTransactionSection)
+    if (incremental)
+    {
+        csvIn.close();
+        ret = convertIncremental(converter, inFileName, outFileName, fpInfo, &result, &incResult);
+    }
+    else if (multiOutput)
+    {
+        std::vector<std::unique_ptr<TransactionWriter>> writers;
+        std::vector<TransactionWriter *>                writerList;
+        std::vector<std::string>                        names(1, outFileName);
+        std::string                                     account = basename(inFileName);
+
+        // The account OFX names is the input file's name
+        if (std::string::npos != account.find('.')) account.resize(account.find('.'));
+        names.insert(names.end(), moreOutFileNames.begin(), moreOutFileNames.end());
+        for (const std::string &name : names)
         {
-            remove_all_quotes(line);
-            switch (bankFormat)
+            writers.push_back(newTransactionWriter(outputFormatForFile(name.c_str()), converter, account));
+            writerList.push_back(writers.back().get());
+            if (name == "(stdout)")
+            {
+                writers.back()->attach(STDOUT_FILENO);
+            }
+            else if (false == writers.back()->open(name.c_str()))
             {
-                case BOA_FORMAT:
-                case SCHWAB_BANK_FORMAT:
-                case SCHWAB_BROKERAGE_FORMAT:
-                    if (strncmp(line, "Date,", 5) == 0) {
-                        inTransactionSection = true;
-                    }
-                    break;
-                case FIDELITY_FORMAT:
-                    if (strncmp(line, "Run Date,", 9) == 0) {
-                        inTransactionSection = true;
-                    }
-                    break;
-                case CITI_FORMAT:
-                    if (strncmp(line, "Status,", 6) == 0) {
-                        inTransactionSection = true;
-                    }
-                    break;
-                default:
-                    usage(basename(argv[0]), "Internal error with bank format");
-                    fclose(fpIn);
-                    fclose(fpOut);
-                    return -7;
-                    break;
+                usage(basename(argv[0]), (std::string("Error opening output file ") + name).c_str());
+                return -5;
             }
-            continue;
         }
 
-        parse_csv_line(line, fields, MAX_FIELDS);
+        // The cache is read if it is good for the input as it is now,
+        // or written from this run's parse if not
+        txnCacheKey_t   cacheKey;
+        uint64_t        configHash;
+        bool            cacheKeyed = false;
+        bool            cacheRead = false;
 
-        //
-        // Use the parse_csv_line results
-        //
-        if (BOA_FORMAT == bankFormat)
+        if (useCache)
         {
-            strcpy(date, fields[0]);
-            strip_quotes(date);
-            strcpy(desc, fields[1]);
-            strip_quotes(desc);
-            strcpy(amt, fields[2]);
+            cacheFileName = txnCacheFileName(inFileName);
+            cacheKeyed =    txnCacheConfigHash(refDbFileName, rulesFileName, &configHash)
+                         && txnCacheKey(inFileName, bankFormat, configHash, &cacheKey);
+            if (false == cacheKeyed) cacheState = "not used, the input can not be hashed";
         }
-        else if (FIDELITY_FORMAT == bankFormat)
+        if (cacheKeyed && cache.open(cacheFileName.c_str(), cacheKey))
         {
-            strcpy(cashBal, fields[15]);
-            strip_quotes(cashBal);
-            if (strncasecmp(cashBal, "Processing", 10) == 0) {
-                // Skip transactions that are still in process
-                continue;
-            }
-            strcpy(date, fields[0]);
-            strip_quotes(date);
-            if (isdigit(date[0]) == 0) {
-                // Skip lines without a valid date
-                continue;
-            }
-            strcpy(desc, fields[1]);
-            strcpy(symbol, fields[2]);
-            strcpy(amt, fields[14]);
-
-            // Determine if the description needs to be modified
-            strip_quotes(desc);
-            strip_quotes(symbol);
-            if (mmSymbols.contains(symbol)) {
-                modifyMMDescription(desc, symbol);
-            }
-            else if (strncasecmp(symbol, "912797", 6) == 0) {
-                modifyTBillDescription(desc);
-            }
-            else if (cusip2bank.contains(symbol)) {
-                modifyCDDescription(desc, cusip2bank.getBankNameC(symbol));
-            }
-        }
-        else if (CITI_FORMAT == bankFormat)
-        {
-            strcpy(date, fields[1]);
-            strip_quotes(date);
+            batchList_t     cached;
+            size_t          numZonesRead;
+            size_t          n;
+            auto            cacheStart = std::chrono::steady_clock::now();
 
-            strcpy(desc, fields[2]);
-            strip_quotes(desc);
-
-            // This is the debit field in Citi.  It might be blank
-            strcpy(amt, fields[3]);
-            if (amt[0] == '\0')
+            cached.emplace_back(new TransactionBatch());
             {
-                strcpy(amt, fields[4]);     // Try the Credit field instead
-                withdrawModifier = 1.0;
+                STATS_SCOPE(STAT_READ);
+                cacheRead = cache.load(dateRange, *cached[0], &numZonesRead);
             }
-            else
+            if (cacheRead)
             {
-                // Withdraw field had an entry.
-                // Citi lists this as a positive number, but
-                // QIF needs it to be negative.
-                withdrawModifier = -1.0;
+                ret = writeTransactions(cached, writerList, &rowFilter, dedup, fpInfo, &n);
+                result.numTransactions = (int)n;
+                result.bytesIn = cache.fileSize();
+                result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - cacheStart).count();
+
+                char    zonesText[64];
+                snprintf(zonesText, sizeof(zonesText), "read, %zu of %zu zones", numZonesRead
+                         , (size_t)((cache.numRows() + TXN_CACHE_ZONE_ROWS - 1) / TXN_CACHE_ZONE_ROWS));
+                cacheState = zonesText;
             }
-
         }
-        else if (SCHWAB_BANK_FORMAT == bankFormat)
+        if (false == cacheRead)
         {
-            strcpy(date, fields[0]);
-            strip_quotes(date);
-
-            strcpy(desc, fields[4]);
-            strip_quotes(desc);
+            batchList_t parsed;
 
-            // This is the Withdraw filed in Schwab.  It might be blank
-            strcpy(amt, fields[5]);
-            if (amt[0] == '\0')
+            // The cache has every transaction, with its fingerprint for
+            // a later -d, so the filter is applied after parsing, not in
+            // the parser
+            if (cacheKeyed)
             {
-                strcpy(amt, fields[6]);     // Try the Deposit field instead
-                withdrawModifier = 1.0;
+                converter.useFilter((const RowFilter *)(NULL));
+                converter.keepFingerprints(true);
+                ret = convertMulti(converter, csvIn, writerList, &rowFilter, numJobs, fpInfo, &result, &parsed);
             }
             else
             {
-                // Withdraw field had an entry.
-                // Schwab lists this as a positive number, but
-                // QIF needs it to be negative.
-                withdrawModifier = -1.0;
+                ret = convertMulti(converter, csvIn, writerList, (const RowFilter *)(NULL), numJobs, fpInfo, &result);
             }
+            if ((0 == ret) && cacheKeyed)
+            {
+                std::string errMsg;
 
+                if (txnCacheWrite(cacheFileName.c_str(), cacheKey, parsed, errMsg))
+                {
+                    cacheState = "written";
+                }
+                else
+                {
+                    fprintf(stderr, "Warning: %s\n", errMsg.c_str());
+                    cacheState = "not written";
+                }
+            }
         }
-        else if (SCHWAB_BROKERAGE_FORMAT == bankFormat)
+        csvIn.close();
+        for (auto &w : writers)
         {
-            strcpy(date, fields[0]);
-            strip_quotes(date);
-            // Remove any "as of ..." portion of this field
-            cp = strstr(date, " as of");
-            if (cp) *cp = '\0';
-
-            strcpy(desc, fields[3]);
-            strcpy(symbol, fields[2]);
-            strcpy(amt, fields[7]);
-
-            // Determine if the description needs to be modified
-            strip_quotes(desc);
-            strip_quotes(symbol);
-            if (mmSymbols.contains(symbol)) {
-                // Replace the description with the action
-                strcpy(desc, fields[1]);
-                strip_quotes(desc);
-                modifyMMDescription(desc, symbol);
-            }
-
+            if ((false == w->close()) && (0 == ret)) ret = -7;
+        }
+    }
+    else
+    {
+        if (outStdout)
+        {
+            qifOut.attach(STDOUT_FILENO);
+        }
+        else if (false == qifOut.open(outFileName))
+        {
+            usage(basename(argv[0]), "Error opening output file");
+            return -5;
         }
 
-        strip_quotes(amt);
-        remove_commas_and_dollars(amt);
-
-        if (amt[0] == '\0') continue;
+        ret = convertStream(converter, csvIn, qifOut, numJobs, fpInfo, &result);
+        csvIn.close();
+        if ((false == qifOut.close()) && (0 == ret))
+        {
+            ret = -7;
+        }
+    }
+    if (-4 == ret)
+    {
+        usage(basename(argv[0]), "Error opening input file");
+        return ret;
+    }
+    else if (-5 == ret)
+    {
+        usage(basename(argv[0]), "Error opening output file");
+        return ret;
+    }
+    else if (-7 == ret)
+    {
+        usage(basename(argv[0]), "Error writing output file");
+        return ret;
+    }
+    else if (-10 == ret)
+    {
+        usage(basename(argv[0]), "Error reading input file");
+        return ret;
+    }
+    else if (-11 == ret)
+    {
+        usage(basename(argv[0]), "Error writing checkpoint file");
+        return ret;
+    }
+    numTransactions = result.numTransactions;
 
-        double amtd = strtod(amt, NULL) * withdrawModifier;
+    if (dedup)
+    {
+        std::string errMsg;
 
-        if  (   (verbosity >= 2)
-             && (amt[0] != '\0')    // Wouldn't be here if amt was null, but check anyway
-            )
+        if (false == dedup->save(errMsg))
         {
-            printf("%s\t%.16s\t$%.2lf\n", date, desc, amtd);
+            usage(basename(argv[0]), errMsg.c_str());
+            return -12;
         }
-
-        fprintf(fpOut, "D%s\n", date);
-        fprintf(fpOut, "P%s\n", desc);
-        fprintf(fpOut, "T%.2lf\n", amtd);
-        fprintf(fpOut, "C*\n");
-        fprintf(fpOut, "^\n");
-        ++numTransactions;
     }
 
-    fclose(fpIn);
-    fclose(fpOut);
-
     if (verbosity >= 1)
     {
-        printf("Input File            : %s\n", inFileName);
-        printf("Output File           : %s\n", outFileName);
-        printf("Number of Transactions: %d\n", numTransactions);
+        fprintf(fpInfo, "Input File            : %s\n", inFileName);
+        fprintf(fpInfo, "Output File           : %s\n", outFileName);
+        for (const std::string &name : moreOutFileNames)
+        {
+            fprintf(fpInfo, "Output File           : %s\n", name.c_str());
+        }
+        fprintf(fpInfo, "Number of Transactions: %d\n", numTransactions);
+        if (useCache)
+        {
+            fprintf(fpInfo, "Transaction Cache     : %s, %s\n", cacheFileName.c_str(), cacheState.c_str());
+        }
+        if (dedup)
+        {
+            fprintf(fpInfo, "Duplicates Removed    : %" PRIu64 "\n", dedup->numDuplicates());
+        }
+        if (incremental)
+        {
+            fprintf(fpInfo, "Incremental           : %s, %" PRIu64 " transactions in all\n"
+                    , incResult.appended ? "appended" : "converted in full"
+                    , incResult.totalTransactions);
+        }
     }
+    if (statsEnabled) printStats(fpInfo, start, statsJson);
 
 
     return 0;
@@ -0,0 +1,428 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <chrono>
+#include <vector>
+#include "mmSymbols.h"
+#include "cusipBankMap.h"
+#include "bankFormat.h"
+#include "csvParse.h"
+#include "csvInput.h"
+#include "csvGenerator.h"
+#include "qifConverter.h"
+#include "transaction.h"
+
+//
+// Benchmark for the conversion.  Synthetic exports are generated for
+// each bank format and converted with the steps of the conversion
+// added one at a time:
+//      read        map the file and split it into lines
+//      parse       split lines into fields
+//      map         pick the format's fields out of the line, parse the amount
+//      rewrite     rewrite money market, T-Bill and CD descriptions
+//      write       format and write the QIF records
+// The time of a step is the difference between the run that ends with
+// it and the run before.  Each run is repeated and the best time kept.
+//
+// The same file is then converted through a TransactionBatch (all rows
+// parsed into transactions, then the batch written as QIF), which must
+// give the same QIF.
+//
+
+typedef enum
+{
+    STAGE_READ
+    , STAGE_PARSE
+    , STAGE_MAP
+    , STAGE_REWRITE
+    , STAGE_WRITE
+    , NUM_STAGES
+}   stage_t;
+
+static const char *stageNames[NUM_STAGES] = {"read", "parse", "map", "rewrite", "write"};
+
+static const struct
+{
+    bankFormat_t    bankFormat;
+    const char      *name;
+}   formats[] =
+{
+    {BOA_FORMAT,                "BoA"}
+    ,{CITI_FORMAT,              "Citi"}
+    ,{FIDELITY_FORMAT,          "Fidelity"}
+    ,{SCHWAB_BANK_FORMAT,       "SchwabBank"}
+    ,{SCHWAB_BROKERAGE_FORMAT,  "SchwabBrokerage"}
+};
+
+#define NUM_FORMATS (sizeof(formats) / sizeof(formats[0]))
+
+void usage(const char *prog, const char *extraLine = (const char *)(NULL));
+
+void usage(const char *prog, const char *extraLine)
+{
+    fprintf(stderr, "usage: %s <options>\n", prog);
+    fprintf(stderr, "-f --format Bank          Bank format to benchmark (default all)\n");
+    fprintf(stderr, "-s --size N[K|M|G]        Size of the generated export (default 16M)\n");
+    fprintf(stderr, "-r --repeat N             Runs per step, best is kept (default 3)\n");
+    fprintf(stderr, "-g --generate filename    Only write a generated export to filename.\n");
+    fprintf(stderr, "                          Needs a single -f format.\n");
+    fprintf(stderr, "-S --seed N               Random seed (default 1)\n");
+    if (extraLine) fprintf(stderr, "\n%s\n", extraLine);
+}
+
+// "64K", "16M", "1G" or plain bytes
+static size_t parseSize(const char *s)
+{
+    char *end;
+    double v = strtod(s, &end);
+
+    switch (toupper((unsigned char)*end))
+    {
+        case 'K':   v *= 1024.0;                    break;
+        case 'M':   v *= 1024.0 * 1024.0;           break;
+        case 'G':   v *= 1024.0 * 1024.0 * 1024.0;  break;
+        default:                                    break;
+    }
+    return (v > 0.0) ? (size_t)v : 0;
+}
+
+// Run the conversion up to and including lastStage.
+// Returns the time taken.  Counts rows and bytes.
+static double runStages(QifConverter &converter
+                        , const char *csvFileName
+                        , const char *qifFileName
+                        , stage_t lastStage
+                        , long *numRows
+                        , size_t *numBytes
+                       )
+{
+    CsvInput    csvIn;
+    QifWriter   qifOut;
+    char        *line;
+    size_t      lineLen;
+    bool        inTransactionSection = false;
+    csvField_t  fields[MAX_FIELDS];
+    rowFields_t row;
+    char        descBuf[MAX_LINE];
+    QifOutput   out;
+    long        rows = 0;
+    size_t      check = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    // A fresh private mapping each run, because parsing
+    // unescapes quotes in place
+    if (false == csvIn.open(csvFileName)) return -1.0;
+    if (STAGE_WRITE == lastStage)
+    {
+        if (false == qifOut.open(qifFileName)) return -1.0;
+        qifOut.write("!Type:Bank\n", 11);
+    }
+
+    while (csvIn.nextLine(&line, &lineLen))
+    {
+        if (0 == lineLen) continue;
+        if (STAGE_READ == lastStage)
+        {
+            // Touch the line so the read is not optimized away
+            check += (unsigned char)line[0];
+            ++rows;
+            continue;
+        }
+        if (false == inTransactionSection)
+        {
+            inTransactionSection = converter.isHeaderLine(line, lineLen);
+            if (inTransactionSection) converter.resolveColumns(line, lineLen);
+            continue;
+        }
+
+        ++rows;
+        check += parse_csv_line(line, lineLen, fields, MAX_FIELDS);
+        if (STAGE_PARSE == lastStage) continue;
+
+        if (false == converter.mapFields(fields, &row)) continue;
+        if (STAGE_MAP == lastStage) continue;
+
+        converter.rewriteDescription(&row, descBuf);
+        check += row.desc.len;
+        if (STAGE_REWRITE == lastStage) continue;
+
+        converter.writeRow(row, out);
+        if (out.qif.size() >= QIF_WRITE_SIZE)
+        {
+            qifOut.write(out.qif);
+            out.qif.clear();
+        }
+    }
+
+    qifOut.write(out.qif);
+    qifOut.close();
+    *numBytes = csvIn.bytesRead();
+    csvIn.close();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Keep the compiler from dropping the work
+    if (check == 1) fprintf(stderr, " ");
+
+    *numRows = rows;
+    return seconds;
+}
+
+// Parse the whole file into a TransactionBatch, then write it to
+// batchQifFileName.  Sets the time of each.  Returns false if the QIF
+// differs from qifFileName's.
+static bool runBatch(QifConverter &converter
+                     , const char *csvFileName
+                     , const char *qifFileName
+                     , const char *batchQifFileName
+                     , double *parseSeconds
+                     , double *writeSeconds
+                     , size_t *batchBytes
+                    )
+{
+    CsvInput            csvIn;
+    QifWriter           qifOut;
+    TransactionBatch    batch;
+    QifOutput           out;
+    char                *line;
+    size_t              lineLen;
+    bool                inTransactionSection = false;
+
+    auto start = std::chrono::steady_clock::now();
+
+    if (false == csvIn.open(csvFileName)) return false;
+    while (csvIn.nextLine(&line, &lineLen))
+    {
+        if (0 == lineLen) continue;
+        if (false == inTransactionSection)
+        {
+            inTransactionSection = converter.isHeaderLine(line, lineLen);
+            if (inTransactionSection) converter.resolveColumns(line, lineLen);
+            continue;
+        }
+        converter.parseLine(line, lineLen, batch);
+    }
+    csvIn.close();
+
+    auto parsed = std::chrono::steady_clock::now();
+
+    if (false == qifOut.open(batchQifFileName)) return false;
+    qifOut.write("!Type:Bank\n", 11);
+    for (const transaction_t &t : batch)
+    {
+        converter.writeTransaction(batch, t, out);
+        if (out.qif.size() >= QIF_WRITE_SIZE)
+        {
+            qifOut.write(out.qif);
+            out.qif.clear();
+        }
+    }
+    qifOut.write(out.qif);
+    qifOut.close();
+
+    auto written = std::chrono::steady_clock::now();
+
+    *parseSeconds = std::chrono::duration<double>(parsed - start).count();
+    *writeSeconds = std::chrono::duration<double>(written - parsed).count();
+    *batchBytes = batch.size() * sizeof(transaction_t);
+
+    // Compare with the QIF of the line at a time conversion
+    std::vector<char>   qif[2];
+    const char          *names[2] = {qifFileName, batchQifFileName};
+    for (int i = 0; i < 2; i++)
+    {
+        FILE *fp = fopen(names[i], "rb");
+        if ((FILE *)(NULL) == fp) return false;
+        char buf[64 * 1024];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) qif[i].insert(qif[i].end(), buf, buf + n);
+        fclose(fp);
+    }
+    return (qif[0] == qif[1]);
+}
+
+static void benchFormat(int fi
+                        , size_t size
+                        , int repeat
+                        , unsigned seed
+                        , const MoneyMarketSymbols &mmSymbols
+                        , const CUSIPBankMap &cusip2bank
+                       )
+{
+    char        csvFileName[] = "/tmp/csv2qifBenchXXXXXX";
+    char        qifFileName[sizeof(csvFileName) + 4];
+    double      best[NUM_STAGES];
+    long        numRows = 0;
+    long        txnRows = 0;
+    size_t      numBytes = 0;
+
+    int fd = mkstemp(csvFileName);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Error creating temporary file\n");
+        return;
+    }
+    FILE *fp = fdopen(fd, "w");
+    long generated = generateCsv(formats[fi].bankFormat, size, seed, fp);
+    fclose(fp);
+    snprintf(qifFileName, sizeof(qifFileName), "%s.qif", csvFileName);
+
+    QifConverter converter(formats[fi].bankFormat, 0, mmSymbols, cusip2bank);
+
+    for (int s = 0; s < NUM_STAGES; s++)
+    {
+        best[s] = 1e30;
+        for (int r = 0; r < repeat; r++)
+        {
+            double t = runStages(converter, csvFileName, qifFileName, (stage_t)s, &numRows, &numBytes);
+            if (t >= 0.0 && t < best[s]) best[s] = t;
+        }
+        if (STAGE_PARSE == s) txnRows = numRows;
+    }
+
+    printf("\n%s: %.1f MB, %ld rows (%ld transaction rows), parser %s\n"
+           , formats[fi].name, numBytes / (1024.0 * 1024.0), generated, txnRows, csv_parser_name());
+    printf("  %-10s %10s %14s %10s\n", "stage", "ms", "rows/s", "MB/s");
+    for (int s = 0; s < NUM_STAGES; s++)
+    {
+        // Each stage is the difference of two best runs, so noise
+        // can leave a cheap stage with no time of its own
+        double t = best[s] - ((s > 0) ? best[s-1] : 0.0);
+        if (t <= 0.0)
+        {
+            printf("  %-10s %10s %14s %10s\n", stageNames[s], "n/a", "n/a", "n/a");
+            continue;
+        }
+        printf("  %-10s %10.2f %14.0f %10.1f\n"
+               , stageNames[s], t * 1000.0, txnRows / t, numBytes / (1024.0 * 1024.0) / t);
+    }
+    printf("  %-10s %10.2f %14.0f %10.1f\n"
+           , "total", best[STAGE_WRITE] * 1000.0
+           , txnRows / best[STAGE_WRITE], numBytes / (1024.0 * 1024.0) / best[STAGE_WRITE]);
+
+    // The last run left the QIF to compare with
+    double  parseBest = 1e30;
+    double  writeBest = 1e30;
+    size_t  batchBytes = 0;
+    bool    same = true;
+    char    batchQifFileName[sizeof(qifFileName) + 6];
+    snprintf(batchQifFileName, sizeof(batchQifFileName), "%s.batch", qifFileName);
+    for (int r = 0; (r < repeat) && same; r++)
+    {
+        double parseSeconds, writeSeconds;
+        same = runBatch(converter, csvFileName, qifFileName, batchQifFileName, &parseSeconds, &writeSeconds, &batchBytes);
+        if (parseSeconds < parseBest) parseBest = parseSeconds;
+        if (writeSeconds < writeBest) writeBest = writeSeconds;
+    }
+    printf("  through a TransactionBatch (%.1f MB of transactions)%s\n"
+           , batchBytes / (1024.0 * 1024.0), same ? "" : ": QIF DIFFERS");
+    printf("  %-10s %10.2f %14.0f %10.1f\n"
+           , "to batch", parseBest * 1000.0, txnRows / parseBest, numBytes / (1024.0 * 1024.0) / parseBest);
+    printf("  %-10s %10.2f %14.0f %10.1f\n"
+           , "from batch", writeBest * 1000.0, txnRows / writeBest, numBytes / (1024.0 * 1024.0) / writeBest);
+    unlink(batchQifFileName);
+
+    unlink(csvFileName);
+    unlink(qifFileName);
+}
+
+int main(int argc, char *argv[])
+{
+    int                 opt;
+    bool                usageError = false;
+    bankFormat_t        bankFormat = UNKNOWN_BANK_FORMAT;
+    size_t              size = 16 * 1024 * 1024;
+    int                 repeat = 3;
+    unsigned            seed = 1;
+    const char          *genFileName = (const char *)(NULL);
+    MoneyMarketSymbols  mmSymbols;
+    CUSIPBankMap        cusip2bank;
+
+    struct option longOptions[] =
+    {
+        {"format",      required_argument,  0,      'f'}
+        ,{"size",       required_argument,  0,      's'}
+        ,{"repeat",     required_argument,  0,      'r'}
+        ,{"generate",   required_argument,  0,      'g'}
+        ,{"seed",       required_argument,  0,      'S'}
+        ,{0,0,0,0}
+    };
+
+    while (1)
+    {
+        int optionIndex = 0;
+        opt = getopt_long(argc, argv, "f:s:r:g:S:", longOptions, &optionIndex);
+
+        if (-1 == opt) break;
+
+        switch (opt)
+        {
+        case 'f':
+            if (strcasecmp(optarg, "all") != 0)
+            {
+                bankFormat = string2bankFormat(optarg);
+                if (UNKNOWN_BANK_FORMAT == bankFormat) usageError = true;
+            }
+            break;
+        case 's':
+            size = parseSize(optarg);
+            if (0 == size) usageError = true;
+            break;
+        case 'r':
+            repeat = atoi(optarg);
+            if (repeat < 1) usageError = true;
+            break;
+        case 'g':
+            genFileName = optarg;
+            break;
+        case 'S':
+            seed = (unsigned)strtoul(optarg, NULL, 0);
+            break;
+        default:
+            usageError = true;
+            break;
+        }
+    }
+
+    if (usageError)
+    {
+        usage(basename(argv[0]));
+        return -1;
+    }
+
+    if (genFileName)
+    {
+        if (UNKNOWN_BANK_FORMAT == bankFormat)
+        {
+            usage(basename(argv[0]), "--generate needs a single format");
+            return -6;
+        }
+        FILE *fp = fopen(genFileName, "w");
+        if ((FILE *)(NULL) == fp)
+        {
+            usage(basename(argv[0]), "Error opening output file");
+            return -5;
+        }
+        long rows = generateCsv(bankFormat, size, seed, fp);
+        fclose(fp);
+        printf("%s: %ld rows\n", genFileName, rows);
+        return 0;
+    }
+
+    for (size_t fi = 0; fi < NUM_FORMATS; fi++)
+    {
+        if  (   (UNKNOWN_BANK_FORMAT != bankFormat)
+             && (formats[fi].bankFormat != bankFormat)
+            )
+        {
+            continue;
+        }
+        benchFormat((int)fi, size, repeat, seed, mmSymbols, cusip2bank);
+    }
+
+    return 0;
+}
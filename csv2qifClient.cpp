@@ -0,0 +1,364 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include "jobProtocol.h"
+#include "bankFormat.h"
+
+//
+// Sends conversion jobs to a csv2qifBLS --serve server, and load tests
+// it: many jobs from many connections at once, with the latency of
+// each job measured from sending the request to having the whole reply.
+//
+
+void usage(const char *prog, const char *extraLine = (const char *)(NULL));
+
+void usage(const char *prog, const char *extraLine)
+{
+    fprintf(stderr, "usage: %s <options>\n", prog);
+    fprintf(stderr, "-s --socket path          The server's socket (csv2qifBLS --serve path)\n");
+    fprintf(stderr, "-i --input filename       CSV file to convert\n");
+    fprintf(stderr, "-o --output filename      Have the server write the QIF to filename.\n");
+    fprintf(stderr, "                          Without it (or with -) the QIF comes back\n");
+    fprintf(stderr, "                          and is written to standard output.\n");
+    fprintf(stderr, "-f --format Bank          Bank format, as csv2qifBLS -f.  The server\n");
+    fprintf(stderr, "                          finds it from the header line if not given.\n");
+    fprintf(stderr, "-n --inline               Send the CSV itself rather than its file\n");
+    fprintf(stderr, "                          name, for a server that can not read the\n");
+    fprintf(stderr, "                          file.  Not for compressed files.\n");
+    fprintf(stderr, "-l --load N               Load test: convert the input N times, the\n");
+    fprintf(stderr, "                          QIF coming back and thrown away, and report\n");
+    fprintf(stderr, "                          the latencies and throughput.\n");
+    fprintf(stderr, "-c --clients N            Connections sending -l jobs at once (1).\n");
+    fprintf(stderr, "-q --quiet                No report for a single job.\n");
+    if (extraLine) fprintf(stderr, "\n%s\n", extraLine);
+}
+
+// One job, as sent for every conversion
+typedef struct
+{
+    jobRequest_t        req;
+    std::vector<char>   body;       // Input then output name
+}   clientJob_t;
+
+static int connectTo(const char *socketPath)
+{
+    struct sockaddr_un  addr;
+    int                 fd;
+
+    if (strlen(socketPath) >= sizeof(addr.sun_path)) return -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socketPath);
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// The server may run in another directory
+static std::string absolutePath(const char *path)
+{
+    char cwd[4096];
+
+    if (('/' == path[0]) || ((char *)(NULL) == getcwd(cwd, sizeof(cwd)))) return path;
+    return std::string(cwd) + "/" + path;
+}
+
+static bool readFile(const char *fileName, std::vector<char> &data)
+{
+    char    buf[64 * 1024];
+    ssize_t n;
+    int     fd = open(fileName, O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) return false;
+    while ((n = read(fd, buf, sizeof(buf))) != 0)
+    {
+        if (n < 0)
+        {
+            if (EINTR == errno) continue;
+            close(fd);
+            return false;
+        }
+        data.insert(data.end(), buf, buf + n);
+    }
+    close(fd);
+    return true;
+}
+
+// Send a job and read its reply, the QIF into qif.  Returns false if
+// the connection failed.
+static bool runJob(int fd, const clientJob_t &job, jobReply_t *reply, std::vector<char> &qif)
+{
+    if  (   (false == writeFull(fd, &job.req, sizeof(job.req)))
+         || (false == writeFull(fd, job.body.data(), job.body.size()))
+         || (false == readFull(fd, reply, sizeof(*reply)))
+         || (memcmp(reply->magic, JOB_REPLY_MAGIC, sizeof(reply->magic)) != 0)
+        )
+    {
+        return false;
+    }
+    qif.resize(reply->qifLen);
+    return readFull(fd, qif.data(), reply->qifLen);
+}
+
+// Latency at fraction p of the sorted latencies (nearest rank)
+static double percentile(const std::vector<double> &sorted, double p)
+{
+    size_t rank = (size_t)(p * sorted.size() + 0.999999);
+
+    if (rank < 1) rank = 1;
+    if (rank > sorted.size()) rank = sorted.size();
+    return sorted[rank - 1];
+}
+
+static int loadTest(const char *socketPath, const clientJob_t &job, long numJobs, int numClients)
+{
+    std::vector<std::thread>            clients;
+    std::vector<std::vector<double>>    latencies(numClients);
+    std::atomic<long>                   next(0);
+    std::atomic<long>                   numFailed(0);
+    std::atomic<uint64_t>               bytesIn(0);
+    std::atomic<uint64_t>               numTransactions(0);
+    std::atomic<bool>                   connectionFailed(false);
+    auto                                start = std::chrono::steady_clock::now();
+
+    for (int c = 0; c < numClients; c++)
+    {
+        clients.emplace_back([&, c]()
+        {
+            std::vector<char>   qif;
+            jobReply_t          reply;
+            int                 fd = connectTo(socketPath);
+
+            if (fd < 0)
+            {
+                connectionFailed = true;
+                return;
+            }
+            while (next++ < numJobs)
+            {
+                auto sent = std::chrono::steady_clock::now();
+
+                if (false == runJob(fd, job, &reply, qif))
+                {
+                    connectionFailed = true;
+                    break;
+                }
+                latencies[c].push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sent).count());
+                if (reply.status) ++numFailed;
+                bytesIn += reply.bytesIn;
+                numTransactions += reply.numTransactions;
+            }
+            close(fd);
+        });
+    }
+    for (auto &c : clients)
+    {
+        c.join();
+    }
+
+    double              seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::vector<double> all;
+
+    for (const auto &l : latencies)
+    {
+        all.insert(all.end(), l.begin(), l.end());
+    }
+    std::sort(all.begin(), all.end());
+
+    if (connectionFailed) fprintf(stderr, "%s: Connection to the server failed\n", socketPath);
+    if (all.empty()) return -13;
+
+    printf("Jobs                  : %zu (%ld failed), %d client%s\n"
+           , all.size(), numFailed.load(), numClients, (1 == numClients) ? "" : "s");
+    printf("Latency ms            : p50 %.2f  p90 %.2f  p99 %.2f  max %.2f\n"
+           , percentile(all, 0.50), percentile(all, 0.90), percentile(all, 0.99), all.back());
+    printf("Elapsed Time          : %.3f s\n", seconds);
+    if (seconds > 0.0)
+    {
+        printf("Throughput            : %.0f jobs/s, %.0f transactions/s, %.2f MB/s\n"
+               , all.size() / seconds
+               , numTransactions.load() / seconds
+               , bytesIn.load() / (1024.0 * 1024.0) / seconds
+              );
+    }
+    return (connectionFailed || numFailed) ? -8 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int                 opt;
+    bool                usageError = false;
+    const char          *socketPath = (const char *)(NULL);
+    const char          *inFileName = (const char *)(NULL);
+    const char          *outFileName = (const char *)(NULL);
+    bankFormat_t        bankFormat = UNKNOWN_BANK_FORMAT;
+    bool                inlineCsv = false;
+    long                numLoadJobs = 0;
+    int                 numClients = 1;
+    int                 verbosity = 1;
+    clientJob_t         job;
+
+    struct option longOptions[] =
+    {
+        {"socket",      required_argument,  0,      's'}
+        ,{"input",      required_argument,  0,      'i'}
+        ,{"output",     required_argument,  0,      'o'}
+        ,{"format",     required_argument,  0,      'f'}
+        ,{"inline",     no_argument,        0,      'n'}
+        ,{"load",       required_argument,  0,      'l'}
+        ,{"clients",    required_argument,  0,      'c'}
+        ,{"quiet",      no_argument,        0,      'q'}
+        ,{0,0,0,0}
+    };
+
+    while (1)
+    {
+        int optionIndex = 0;
+        opt = getopt_long(argc, argv, "s:i:o:f:nl:c:q", longOptions, &optionIndex);
+
+        if (-1 == opt) break;
+
+        switch (opt)
+        {
+        case 's':
+            socketPath = optarg;
+            break;
+        case 'i':
+            inFileName = optarg;
+            break;
+        case 'o':
+            outFileName = optarg;
+            break;
+        case 'f':
+            if (strcasecmp(optarg, "auto") != 0)
+            {
+                bankFormat = string2bankFormat(optarg);
+                if (UNKNOWN_BANK_FORMAT == bankFormat) usageError = true;
+            }
+            break;
+        case 'n':
+            inlineCsv = true;
+            break;
+        case 'l':
+            numLoadJobs = atol(optarg);
+            if (numLoadJobs < 1) usageError = true;
+            break;
+        case 'c':
+            numClients = atoi(optarg);
+            if (numClients < 1) usageError = true;
+            break;
+        case 'q':
+            --verbosity;
+            break;
+        default:
+            usageError = true;
+            break;
+        }
+    }
+
+    if (usageError || ((const char *)(NULL) == socketPath) || ((const char *)(NULL) == inFileName))
+    {
+        usage(basename(argv[0]), usageError ? (const char *)(NULL) : "-s and -i are required");
+        return -2;
+    }
+    if (outFileName && (strcmp(outFileName, "-") == 0)) outFileName = (const char *)(NULL);
+    if (numLoadJobs && outFileName)
+    {
+        usage(basename(argv[0]), "-l returns the QIF; it can not be used with -o");
+        return -2;
+    }
+
+    // The request, sent as it is for every job
+    std::string outName = outFileName ? absolutePath(outFileName) : std::string();
+
+    if (inlineCsv)
+    {
+        if (false == readFile(inFileName, job.body))
+        {
+            usage(basename(argv[0]), "Error reading input file");
+            return -4;
+        }
+    }
+    else
+    {
+        std::string inName = absolutePath(inFileName);
+        job.body.assign(inName.begin(), inName.end());
+    }
+    if ((job.body.size() > JOB_MAX_INPUT) || (outName.size() > JOB_MAX_NAME))
+    {
+        usage(basename(argv[0]), "Input or output too large for the server");
+        return -2;
+    }
+
+    memcpy(job.req.magic, JOB_REQUEST_MAGIC, sizeof(job.req.magic));
+    job.req.version = JOB_VERSION;
+    job.req.bankFormat = (uint32_t)bankFormat;
+    job.req.flags = inlineCsv ? JOB_INLINE_CSV : 0;
+    job.req.inputLen = (uint32_t)job.body.size();
+    job.req.outputLen = (uint32_t)outName.size();
+    job.body.insert(job.body.end(), outName.begin(), outName.end());
+
+    // A server that goes away is reported, not a signal
+    signal(SIGPIPE, SIG_IGN);
+
+    if (numLoadJobs)
+    {
+        return loadTest(socketPath, job, numLoadJobs, numClients);
+    }
+
+    std::vector<char>   qif;
+    jobReply_t          reply;
+    int                 fd = connectTo(socketPath);
+
+    if (fd < 0)
+    {
+        fprintf(stderr, "%s: Error connecting to the server: %s\n", socketPath, strerror(errno));
+        return -13;
+    }
+    if (false == runJob(fd, job, &reply, qif))
+    {
+        fprintf(stderr, "%s: Connection to the server failed\n", socketPath);
+        close(fd);
+        return -13;
+    }
+    close(fd);
+
+    if (reply.status)
+    {
+        fprintf(stderr, "%s: %s\n", inFileName, jobStatus2string(reply.status));
+        return reply.status;
+    }
+    if ((const char *)(NULL) == outFileName)
+    {
+        if (false == writeFull(STDOUT_FILENO, qif.data(), qif.size()))
+        {
+            fprintf(stderr, "Error writing output\n");
+            return -7;
+        }
+    }
+    if (verbosity >= 1)
+    {
+        fprintf(stderr, "%s: %u transactions, %.1f KB\n", inFileName, reply.numTransactions, reply.bytesIn / 1024.0);
+    }
+    return 0;
+}
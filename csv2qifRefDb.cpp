@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <string>
+#include "refDb.h"
+
+//
+// Builds the reference database that csv2qifBLS -r reads from a CSV
+// of CD CUSIPs and money market symbols (format in refDb.h), and
+// looks keys up in a built database.
+//
+
+void usage(const char *prog, const char *extraLine = (const char *)(NULL));
+
+void usage(const char *prog, const char *extraLine)
+{
+    fprintf(stderr, "usage: %s <options>\n", prog);
+    fprintf(stderr, "-i --input filename       Reference .csv file.  Lines are\n");
+    fprintf(stderr, "                             CD,CUSIP,Bank Name\n");
+    fprintf(stderr, "                             MM,Symbol\n");
+    fprintf(stderr, "-o --output filename      Database to build\n");
+    fprintf(stderr, "-l --lookup key           Look key up in the database given with -o\n");
+    fprintf(stderr, "                          instead of building it.  May be repeated.\n");
+    if (extraLine) fprintf(stderr, "\n%s\n", extraLine);
+}
+
+int main(int argc, char *argv[])
+{
+    int                 opt;
+    bool                usageError = false;
+    const char          *inFileName = (const char *)(NULL);
+    const char          *outFileName = (const char *)(NULL);
+    std::string         errMsg;
+    int                 numLookups = 0;
+
+    struct option longOptions[] =
+    {
+        {"input",       required_argument,  0,      'i'}
+        ,{"output",     required_argument,  0,      'o'}
+        ,{"lookup",     required_argument,  0,      'l'}
+        ,{0,0,0,0}
+    };
+
+    while (1)
+    {
+        int optionIndex = 0;
+        opt = getopt_long(argc, argv, "i:o:l:", longOptions, &optionIndex);
+
+        if (-1 == opt) break;
+
+        switch (opt)
+        {
+        case 'i':
+            inFileName = optarg;
+            break;
+        case 'o':
+            outFileName = optarg;
+            break;
+        case 'l':
+            ++numLookups;
+            break;
+        default:
+            usageError = true;
+            break;
+        }
+    }
+
+    if  (   usageError
+         || ((const char *)(NULL) == outFileName)
+         || ((0 == numLookups) && ((const char *)(NULL) == inFileName))
+        )
+    {
+        usage(basename(argv[0]));
+        return -1;
+    }
+
+    if (numLookups)
+    {
+        RefDb   refDb;
+        int     notFound = 0;
+
+        if (false == refDb.open(outFileName, errMsg))
+        {
+            usage(basename(argv[0]), errMsg.c_str());
+            return -9;
+        }
+
+        // Go through the options again for the keys
+        optind = 1;
+        while ((opt = getopt_long(argc, argv, "i:o:l:", longOptions, NULL)) != -1)
+        {
+            if ('l' != opt) continue;
+
+            const char *bankName = refDb.lookupCusip(optarg);
+            if (bankName)
+            {
+                printf("%s: CD %s\n", optarg, bankName);
+            }
+            else if (refDb.lookupSymbol(optarg))
+            {
+                printf("%s: money market\n", optarg);
+            }
+            else
+            {
+                printf("%s: not found\n", optarg);
+                ++notFound;
+            }
+        }
+        return notFound ? 1 : 0;
+    }
+
+    uint32_t numCusips = 0;
+    uint32_t numSymbols = 0;
+
+    if (false == refDbCompile(inFileName, outFileName, &numCusips, &numSymbols, errMsg))
+    {
+        fprintf(stderr, "%s\n", errMsg.c_str());
+        return -5;
+    }
+    printf("%s: %u CUSIPs, %u money market symbols\n", outFileName, numCusips, numSymbols);
+
+    return 0;
+}
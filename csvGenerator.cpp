@@ -0,0 +1,340 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "csvGenerator.h"
+
+// Small, fast and the same on every platform, unlike rand()
+class GenRandom {
+private:
+    uint64_t    state;
+
+public:
+    GenRandom(unsigned seed) : state(0x9E3779B97F4A7C15ull ^ seed) { next(); }
+
+    uint64_t next() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    // 0 .. n-1
+    unsigned below(unsigned n) { return (unsigned)(next() % n); }
+};
+
+static const char *mmSymbolList[] = {"SPAXX", "FDRXX", "FZFXX", "SNVXX", "SNSXX"};
+static const char *cdCusipList[] = {"38150VQ44", "46593LW96", "06051XBM3", "949764FB5", "2546736D3", "61690U3Y4"};
+static const char *stockList[] = {"VTI", "AAPL", "MSFT", "VXUS", "BND", "SCHD"};
+static const char *payeeList[] =
+{
+    "AMAZON MKTPLACE PMTS"
+    , "GROCERY OUTLET #1234"
+    , "SHELL OIL 57442"
+    , "PAYROLL ACME CORP DIR DEP"
+    , "CITY WATER UTILITY"
+    , "ONLINE TRANSFER TO SAV"
+    , "RESTAURANT, THE \"GOOD\" ONE"
+    , "ATM WITHDRAWAL"
+};
+
+#define NUM(a)  (sizeof(a) / sizeof((a)[0]))
+
+// Days since 01/01/2015 as MM/DD/YYYY
+static void formatDate(char *buf, size_t size, int day)
+{
+    static const int monthDays[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    int year = 2015;
+    int month = 0;
+
+    for (;;)
+    {
+        int yearDays = ((year % 4 == 0) && ((year % 100 != 0) || (year % 400 == 0))) ? 366 : 365;
+        if (day < yearDays) break;
+        day -= yearDays;
+        ++year;
+    }
+    for (;;)
+    {
+        int md = monthDays[month] + ((month == 1) && (year % 4 == 0) && ((year % 100 != 0) || (year % 400 == 0)));
+        if (day < md) break;
+        day -= md;
+        ++month;
+    }
+    snprintf(buf, size, "%02d/%02d/%04d", month + 1, day + 1, year);
+}
+
+// Cents as [-][$]1,234.56
+static void formatAmount(char *buf, size_t size, long cents, bool dollar, bool commas)
+{
+    char digits[32];
+    char grouped[32];
+    bool negative = cents < 0;
+    long whole = (negative ? -cents : cents) / 100;
+    int frac = (int)((negative ? -cents : cents) % 100);
+    int n = snprintf(digits, sizeof(digits), "%ld", whole);
+    int g = 0;
+
+    for (int i = 0; i < n; i++)
+    {
+        if (commas && i && ((n - i) % 3 == 0)) grouped[g++] = ',';
+        grouped[g++] = digits[i];
+    }
+    grouped[g] = '\0';
+    snprintf(buf, size, "%s%s%s.%02d", negative ? "-" : "", dollar ? "$" : "", grouped, frac);
+}
+
+// Payee as a quoted CSV field, its quotes doubled
+static void formatPayee(char *buf, size_t size, const char *payee)
+{
+    size_t n = 0;
+
+    buf[n++] = '"';
+    for (const char *p = payee; *p && (n + 3 < size); p++)
+    {
+        if ('"' == *p) buf[n++] = '"';
+        buf[n++] = *p;
+    }
+    buf[n++] = '"';
+    buf[n] = '\0';
+}
+
+static long randomCents(GenRandom &rnd)
+{
+    // Mostly small amounts, some large ones
+    switch (rnd.below(4))
+    {
+        case 0:     return 1 + rnd.below(10000);
+        case 1:     return 1 + rnd.below(100000);
+        case 2:     return 1 + rnd.below(1000000);
+        default:    return 1 + rnd.below(100000000);
+    }
+}
+
+static void writeHeader(bankFormat_t bankFormat, FILE *fp, size_t *bytes)
+{
+    const char *header = "";
+
+    switch (bankFormat)
+    {
+        case BOA_FORMAT:
+            header = "Description,,Summary Amt.\n"
+                     "Beginning balance as of 01/01/2015,,\"1,000.00\"\n"
+                     "Total credits,,\"0.00\"\n"
+                     "Total debits,,\"0.00\"\n"
+                     "Ending balance as of 01/01/2015,,\"1,000.00\"\n"
+                     "\n"
+                     "Date,Description,Amount,Running Bal.\n"
+                     "01/01/2015,Beginning balance as of 01/01/2015,,\"1,000.00\"\n";
+            break;
+        case CITI_FORMAT:
+            header = "Status,Date,Description,Debit,Credit\n";
+            break;
+        case FIDELITY_FORMAT:
+            header = "\n\nRun Date,Action,Symbol,Description,Type,Exchange Quantity,Exchange Currency,"
+                     "Quantity,Currency,Price,Exchange Rate,Commission,Fees,Accrued Interest,"
+                     "Amount,Cash Balance,Settlement Date\n";
+            break;
+        case SCHWAB_BANK_FORMAT:
+            header = "\"Date\",\"Status\",\"Type\",\"CheckNumber\",\"Description\",\"Withdrawal\",\"Deposit\",\"RunningBalance\"\n";
+            break;
+        case SCHWAB_BROKERAGE_FORMAT:
+            header = "\"Date\",\"Action\",\"Symbol\",\"Description\",\"Quantity\",\"Price\",\"Fees & Comm\",\"Amount\"\n";
+            break;
+        default:
+            break;
+    }
+    fputs(header, fp);
+    *bytes += strlen(header);
+}
+
+static void writeFooter(bankFormat_t bankFormat, FILE *fp)
+{
+    if (FIDELITY_FORMAT == bankFormat)
+    {
+        fputs("\n\"The data and information in this spreadsheet is provided to you solely for your use\"\n"
+              "\"Date downloaded 01/01/2026 12:00 am\"\n", fp);
+    }
+    else if (SCHWAB_BROKERAGE_FORMAT == bankFormat)
+    {
+        fputs("Transactions Total,\"\",\"\",\"\",\"\",\"\",\"\",\"$0.00\"\n", fp);
+    }
+}
+
+// One transaction row.  Returns its length.
+static int writeRow(bankFormat_t bankFormat, GenRandom &rnd, int day, long *balance, FILE *fp)
+{
+    char    date[16];
+    char    amt[48];
+    char    bal[48];
+    char    payee[80];
+    long    cents = randomCents(rnd);
+    bool    credit = rnd.below(3) == 0;
+    int     n = 0;
+
+    formatDate(date, sizeof(date), day);
+    *balance += credit ? cents : -cents;
+
+    switch (bankFormat)
+    {
+        case BOA_FORMAT:
+        {
+            formatPayee(payee, sizeof(payee), payeeList[rnd.below(NUM(payeeList))]);
+            formatAmount(amt, sizeof(amt), credit ? cents : -cents, false, true);
+            formatAmount(bal, sizeof(bal), *balance, false, true);
+            n = fprintf(fp, "%s,%s,\"%s\",\"%s\"\n", date, payee, amt, bal);
+            break;
+        }
+        case CITI_FORMAT:
+        {
+            formatPayee(payee, sizeof(payee), payeeList[rnd.below(NUM(payeeList))]);
+            formatAmount(amt, sizeof(amt), cents, false, true);
+            if (credit)
+            {
+                n = fprintf(fp, "Cleared,%s,%s,,\"%s\"\n", date, payee, amt);
+            }
+            else
+            {
+                n = fprintf(fp, "Cleared,%s,%s,\"%s\",\n", date, payee, amt);
+            }
+            break;
+        }
+        case FIDELITY_FORMAT:
+        {
+            const char *mm = mmSymbolList[rnd.below(NUM(mmSymbolList))];
+            const char *cusip = cdCusipList[rnd.below(NUM(cdCusipList))];
+            const char *stock = stockList[rnd.below(NUM(stockList))];
+            const char *status = (rnd.below(50) == 0) ? "Processing" : "";
+            char cashBal[48];
+
+            formatAmount(cashBal, sizeof(cashBal), *balance, false, true);
+            if (status[0]) strcpy(cashBal, status);
+
+            switch (rnd.below(7))
+            {
+                case 0:
+                    formatAmount(amt, sizeof(amt), cents % 10000, false, false);
+                    n = fprintf(fp, "%s,\"DIVIDEND RECEIVED FIDELITY MONEY MARKET (%s) (Cash)\",%s,\"MONEY MARKET\",Cash,0,,0.000,USD,,0,,,,%s,\"%s\",\n"
+                                , date, mm, mm, amt, cashBal);
+                    break;
+                case 1:
+                    formatAmount(amt, sizeof(amt), -(cents % 10000), false, false);
+                    n = fprintf(fp, "%s,\"REINVESTMENT FIDELITY MONEY MARKET (%s) (Cash)\",%s,\"MONEY MARKET\",Cash,0,,1.000,USD,1,0,,,,%s,\"%s\",\n"
+                                , date, mm, mm, amt, cashBal);
+                    break;
+                case 2:
+                    formatAmount(amt, sizeof(amt), -cents, false, true);
+                    n = fprintf(fp, "%s,\"YOU BOUGHT UNITED STATES TREAS BILLS ZERO CPN 0.00000%% (Cash)\",912797%03u,\"UNITED STATES TREAS BILLS\",Cash,0,,10000,USD,98.9,0,,,,\"%s\",\"%s\",%s\n"
+                                , date, rnd.below(1000), amt, cashBal, date);
+                    break;
+                case 3:
+                    formatAmount(amt, sizeof(amt), cents, false, true);
+                    n = fprintf(fp, "%s,\"REDEMPTION PAYOUT UNITED STATES TREAS BILLS\",912797%03u,\"UNITED STATES TREAS BILLS\",Cash,0,,-10000,USD,,0,,,,\"%s\",\"%s\",\n"
+                                , date, rnd.below(1000), amt, cashBal);
+                    break;
+                case 4:
+                    formatAmount(amt, sizeof(amt), cents % 100000, true, true);
+                    n = fprintf(fp, "%s,\"INTEREST EARNED CD\",%s,\"CD\",Cash,0,,0,USD,,0,,,,\"%s\",\"%s\",\n"
+                                , date, cusip, amt, cashBal);
+                    break;
+                case 5:
+                    formatAmount(amt, sizeof(amt), -cents, false, true);
+                    n = fprintf(fp, "%s,\"YOU BOUGHT %s (Cash)\",%s,\"%s\",Cash,0,,10,USD,250,0,,,,\"%s\",\"%s\",%s\n"
+                                , date, stock, stock, stock, amt, cashBal, date);
+                    break;
+                default:
+                    formatAmount(amt, sizeof(amt), cents, false, true);
+                    n = fprintf(fp, "%s,\"Electronic Funds Transfer Received (Cash)\", ,\"No Description\",Cash,0,,0.000,USD,,0,,,,\"%s\",\"%s\",\n"
+                                , date, amt, cashBal);
+                    break;
+            }
+            break;
+        }
+        case SCHWAB_BANK_FORMAT:
+        {
+            formatPayee(payee, sizeof(payee), payeeList[rnd.below(NUM(payeeList))]);
+            formatAmount(amt, sizeof(amt), cents, true, true);
+            formatAmount(bal, sizeof(bal), *balance, true, true);
+            if (credit)
+            {
+                n = fprintf(fp, "\"%s\",\"Posted\",\"ACH\",\"\",%s,\"\",\"%s\",\"%s\"\n", date, payee, amt, bal);
+            }
+            else
+            {
+                n = fprintf(fp, "\"%s\",\"Posted\",\"ACH\",\"\",%s,\"%s\",\"\",\"%s\"\n", date, payee, amt, bal);
+            }
+            break;
+        }
+        case SCHWAB_BROKERAGE_FORMAT:
+        {
+            const char *mm = mmSymbolList[3 + rnd.below(2)];
+            const char *stock = stockList[rnd.below(NUM(stockList))];
+            char asOf[32] = "";
+
+            if (rnd.below(10) == 0)
+            {
+                strcpy(asOf, " as of ");
+                formatDate(asOf + 7, sizeof(asOf) - 7, day > 3 ? day - 3 : 0);
+            }
+            switch (rnd.below(4))
+            {
+                case 0:
+                    formatAmount(amt, sizeof(amt), cents % 10000, true, true);
+                    n = fprintf(fp, "\"%s%s\",\"Reinvest Dividend\",\"%s\",\"SCHWAB MONEY FUND\",\"\",\"\",\"\",\"%s\"\n"
+                                , date, asOf, mm, amt);
+                    break;
+                case 1:
+                    formatAmount(amt, sizeof(amt), -(cents % 10000), true, true);
+                    n = fprintf(fp, "\"%s\",\"Reinvest Shares\",\"%s\",\"SCHWAB MONEY FUND\",\"1\",\"$1.00\",\"\",\"%s\"\n"
+                                , date, mm, amt);
+                    break;
+                case 2:
+                    formatAmount(amt, sizeof(amt), -cents, true, true);
+                    n = fprintf(fp, "\"%s\",\"Buy\",\"%s\",\"%s ETF\",\"10\",\"$250.00\",\"\",\"%s\"\n"
+                                , date, stock, stock, amt);
+                    break;
+                default:
+                    formatAmount(amt, sizeof(amt), cents, true, true);
+                    n = fprintf(fp, "\"%s\",\"Sell\",\"%s\",\"SCHWAB MONEY FUND\",\"100\",\"$1.00\",\"\",\"%s\"\n"
+                                , date, mm, amt);
+                    break;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+
+    return n;
+}
+
+long generateCsv(bankFormat_t bankFormat, size_t targetBytes, unsigned seed, FILE *fp)
+{
+    GenRandom   rnd(seed);
+    size_t      bytes = 0;
+    long        rows = 0;
+    long        balance = 100000;
+    int         n;
+
+    writeHeader(bankFormat, fp, &bytes);
+
+    // Fidelity and Schwab list the newest transaction first.
+    // Estimate the row count so their dates still count down.
+    bool newestFirst =  (FIDELITY_FORMAT == bankFormat)
+                     || (SCHWAB_BANK_FORMAT == bankFormat)
+                     || (SCHWAB_BROKERAGE_FORMAT == bankFormat);
+    long estRows = (long)(targetBytes / 100) + 1;
+
+    while (bytes < targetBytes)
+    {
+        // About five transactions a day
+        int day = (int)((newestFirst ? (estRows - rows) : rows) / 5);
+        if (day < 0) day = 0;
+        n = writeRow(bankFormat, rnd, day, &balance, fp);
+        if (n <= 0) break;
+        bytes += n;
+        ++rows;
+    }
+
+    writeFooter(bankFormat, fp);
+    return rows;
+}
@@ -0,0 +1,16 @@
+#ifndef __CSVGENERATOR_H__
+#define __CSVGENERATOR_H__
+
+#include <stdio.h>
+#include <stddef.h>
+#include "bankFormat.h"
+
+// Write a synthetic export in the given bank format to fp.
+// It has the same layout as the real thing: preamble and footer lines,
+// the column header line, quoted fields, "$" and "," in amounts, money
+// market symbols, T-Bills and CD CUSIPs.  Rows are added until about
+// targetBytes have been written.  The same seed gives the same file.
+// Returns the number of transaction rows written.
+long generateCsv(bankFormat_t bankFormat, size_t targetBytes, unsigned seed, FILE *fp);
+
+#endif
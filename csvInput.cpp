@@ -0,0 +1,313 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "csvInput.h"
+#include "stats.h"
+
+CsvInput::CsvInput()
+    : fd(-1)
+    , ownFd(false)
+    , map((char *)(NULL))
+    , ownMap(false)
+    , mapLen(0)
+    , pos(0)
+    , buf((char *)(NULL))
+    , bufSize(0)
+    , bufStart(0)
+    , bufEnd(0)
+    , eof(false)
+    , streamBytes(0)
+    , compression(NO_COMPRESSION)
+    , decompressor((Decompressor *)(NULL))
+    , readError(false)
+{
+}
+
+CsvInput::~CsvInput()
+{
+    close();
+    free(buf);
+}
+
+bool CsvInput::open(const char *fileName)
+{
+    struct stat st;
+
+    close();
+    compression = NO_COMPRESSION;
+
+    fd = ::open(fileName, O_RDONLY);
+    if (fd < 0) return false;
+    ownFd = true;
+
+    // Compressed files are streamed through a Decompressor
+    char magic[COMPRESSION_MAGIC_SIZE];
+    ssize_t magicLen = pread(fd, magic, sizeof(magic), 0);
+
+    if  (   (fstat(fd, &st) == 0)
+         && S_ISREG(st.st_mode)
+         && (st.st_size > 0)
+         && (NO_COMPRESSION == detectCompression(magic, (magicLen > 0) ? magicLen : 0))
+        )
+    {
+        // Private, writable mapping so lines can be modified in place
+        // without touching the file.  Pages are only copied if written.
+        void *p = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (MAP_FAILED != p)
+        {
+            map = (char *)p;
+            ownMap = true;
+            mapLen = st.st_size;
+            pos = 0;
+            madvise(map, mapLen, MADV_SEQUENTIAL);
+            return true;
+        }
+    }
+
+    // Not mappable.  Stream it instead.
+    if (false == startStream())
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool CsvInput::open(FILE *stream)
+{
+    close();
+    if ((FILE *)(NULL) == stream) return false;
+
+    fd = fileno(stream);
+    ownFd = false;
+    if ((fd < 0) || (false == startStream()))
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool CsvInput::open(char *data, size_t len)
+{
+    close();
+    compression = NO_COMPRESSION;
+    readError = false;
+    if ((char *)(NULL) == data) return false;
+
+    map = data;
+    ownMap = false;
+    mapLen = len;
+    pos = 0;
+    return true;
+}
+
+bool CsvInput::startStream()
+{
+    bufStart = bufEnd = 0;
+    eof = false;
+    streamBytes = 0;
+    readError = false;
+    compression = NO_COMPRESSION;
+
+    // Look at the first bytes.  For a pipe they can only be read, so
+    // they are handed to the decompressor rather than read again.
+    while ((bufEnd < COMPRESSION_MAGIC_SIZE) && fill())
+    {
+    }
+    compression = detectCompression(buf, bufEnd);
+    if (NO_COMPRESSION == compression) return true;
+
+    decompressor = new Decompressor;
+    if (false == decompressor->start(fd, compression, buf, bufEnd))
+    {
+        return false;
+    }
+    bufEnd = 0;
+    eof = false;
+    return true;
+}
+
+void CsvInput::close()
+{
+    if (map || (fd >= 0)) STATS_ADD(STAT_BYTES_IN, bytesRead());
+
+    if (decompressor)
+    {
+        // Before fd is closed, as the thread reads it
+        decompressor->stop();
+        delete decompressor;
+        decompressor = (Decompressor *)(NULL);
+    }
+    if (map)
+    {
+        if (ownMap) munmap(map, mapLen);
+        map = (char *)(NULL);
+        ownMap = false;
+        mapLen = 0;
+        pos = 0;
+    }
+    if ((fd >= 0) && ownFd)
+    {
+        ::close(fd);
+    }
+    fd = -1;
+    ownFd = false;
+    bufStart = bufEnd = 0;
+    eof = true;
+}
+
+bool CsvInput::fill()
+{
+    if (eof || (fd < 0)) return false;
+
+    // Move what is left to the front, and grow only when a single
+    // line fills the whole buffer
+    if (bufStart)
+    {
+        memmove(buf, buf + bufStart, bufEnd - bufStart);
+        bufEnd -= bufStart;
+        bufStart = 0;
+    }
+    if (bufEnd == bufSize)
+    {
+        size_t newSize = bufSize ? bufSize * 2 : STREAM_BUFFER_SIZE;
+        char *p = (char *)realloc(buf, newSize);
+        if ((char *)(NULL) == p)
+        {
+            eof = true;
+            return false;
+        }
+        buf = p;
+        bufSize = newSize;
+    }
+
+    if (decompressor)
+    {
+        size_t r = decompressor->read(buf + bufEnd, bufSize - bufEnd);
+        if (r > 0)
+        {
+            bufEnd += r;
+            return true;
+        }
+        readError = decompressor->failed();
+        eof = true;
+        return false;
+    }
+
+    for (;;)
+    {
+        ssize_t r = read(fd, buf + bufEnd, bufSize - bufEnd);
+        if (r > 0)
+        {
+            bufEnd += r;
+            return true;
+        }
+        if ((r < 0) && (EINTR == errno)) continue;
+        readError = (r < 0);
+        eof = true;
+        return false;
+    }
+}
+
+bool CsvInput::nextLine(char **line, size_t *len)
+{
+    char    *start;
+    size_t  n;
+
+    STATS_SCOPE(STAT_READ);
+
+    if (map)
+    {
+        if (pos >= mapLen) return false;
+        start = map + pos;
+        char *nl = (char *)memchr(start, '\n', mapLen - pos);
+        n = nl ? (size_t)(nl - start) : (mapLen - pos);
+        pos += n + (nl ? 1 : 0);
+    }
+    else
+    {
+        size_t  scanned = 0;    // Bytes already known to have no newline
+        char    *nl;
+
+        for (;;)
+        {
+            nl = (char *)memchr(buf + bufStart + scanned, '\n', bufEnd - bufStart - scanned);
+            if (nl) break;
+            scanned = bufEnd - bufStart;
+            if (false == fill()) break;
+        }
+        if (nl)
+        {
+            start = buf + bufStart;
+            n = nl - start;
+            bufStart += n + 1;
+            streamBytes += n + 1;
+        }
+        else
+        {
+            // Last line without a newline
+            if (bufStart == bufEnd) return false;
+            start = buf + bufStart;
+            n = bufEnd - bufStart;
+            bufStart = bufEnd;
+            streamBytes += n;
+        }
+    }
+
+    *line = start;
+    *len = csv_line_length(start, n);
+    return true;
+}
+
+void CsvInput::peek(const char **data, size_t *len, size_t want)
+{
+    if (map)
+    {
+        *data = map + pos;
+        *len = mapLen - pos;
+        return;
+    }
+
+    while ((bufEnd - bufStart < want) && fill())
+    {
+    }
+    *data = buf + bufStart;
+    *len = bufEnd - bufStart;
+}
+
+bool CsvInput::skip(size_t n)
+{
+    if (map)
+    {
+        if (n > mapLen - pos) return false;
+        pos += n;
+        return true;
+    }
+
+    while (n)
+    {
+        if ((bufStart == bufEnd) && (false == fill())) return false;
+
+        size_t take = bufEnd - bufStart;
+        if (take > n) take = n;
+        bufStart += take;
+        streamBytes += take;
+        n -= take;
+    }
+    return true;
+}
+
+bool CsvInput::remaining(char **data, size_t *len)
+{
+    if ((char *)(NULL) == map) return false;
+
+    *data = map + pos;
+    *len = mapLen - pos;
+    pos = mapLen;
+    return true;
+}
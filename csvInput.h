@@ -0,0 +1,110 @@
+#ifndef __CSVINPUT_H__
+#define __CSVINPUT_H__
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include "decompressor.h"
+
+// Length of a line once the line ending is removed.  Like
+// strcspn(line, "\r\n") the line ends at the first carriage return.
+static inline size_t csv_line_length(const char *line, size_t n)
+{
+    const char *cr = (const char *)memchr(line, '\r', n);
+    if (cr) n = cr - line;
+    if (n && line[n-1] == '\n') --n;
+    return n;
+}
+
+// Line reader for the CSV input.
+//
+// Regular files are memory mapped and lines are handed out as pointers
+// into the mapping, so no per-line copy is made.  Anything that cannot
+// be mapped (stdin, pipes, empty files) is streamed: read() into a
+// buffer of STREAM_BUFFER_SIZE and lines handed out from there, so
+// memory stays bounded however long the input is.  The buffer only
+// grows for a line longer than itself.
+//
+// gzip and zstd input (recognised by its first bytes) is always
+// streamed, decompressed by a Decompressor on a thread of its own.
+//
+// Lines are returned without the line ending and are NOT null terminated.
+// The mapping is private, so callers may modify the line in place
+// (parse_csv_line() does this when unescaping quotes).
+#define STREAM_BUFFER_SIZE  (256 * 1024)
+
+class CsvInput {
+private:
+    int         fd;
+    bool        ownFd;
+    char        *map;
+    bool        ownMap;         // False for memory given to open(data, len)
+    size_t      mapLen;
+    size_t      pos;
+    char        *buf;           // Stream buffer
+    size_t      bufSize;
+    size_t      bufStart;       // Unread data is buf[bufStart..bufEnd)
+    size_t      bufEnd;
+    bool        eof;
+    size_t      streamBytes;
+    compression_t   compression;
+    Decompressor    *decompressor;
+    bool        readError;
+
+    // Set up streaming from fd, starting a Decompressor if the data
+    // is compressed.  Returns false if the compression is not supported.
+    bool startStream();
+
+    // Read more of the stream.  Returns false at end of input.
+    bool fill();
+
+public:
+    CsvInput();
+    ~CsvInput();
+
+    // Open a file by name.  Returns false if it can not be opened, or
+    // is compressed in a way this build can not decompress.
+    bool open(const char *fileName);
+
+    // Read from an already open stream (e.g. stdin).  Never mapped.
+    // Nothing must have been read from it with stdio.  It is not closed.
+    bool open(FILE *stream);
+
+    // Read len bytes of CSV already in memory, as if they were a
+    // mapped file.  The memory must be writable, is not copied and
+    // must stay until close().  Not decompressed.  data must not be
+    // NULL, even for no bytes.
+    bool open(char *data, size_t len);
+
+    void close();
+
+    // Get the next line.  Returns false at end of input.
+    bool nextLine(char **line, size_t *len);
+
+    // Look at (at least) the next want bytes without reading them,
+    // fewer at end of input.  For a stream, this reads ahead.
+    void peek(const char **data, size_t *len, size_t want);
+
+    // Pass over the next n bytes without looking at them.  Returns
+    // false if the input ends first.
+    bool skip(size_t n);
+
+    // Hand out everything not yet read as one block.  Only possible
+    // when the input is mapped.  Returns false otherwise.
+    bool remaining(char **data, size_t *len);
+
+    bool isMapped() const { return (char *)(NULL) != map; }
+
+    // Compression of the input.  Still set after open() failed because
+    // the compression is not supported.
+    compression_t getCompression() const { return compression; }
+
+    // True if the input could not all be read, or was corrupt compressed
+    // data.  Only known for certain once nextLine() has returned false.
+    bool failed() const { return readError; }
+
+    // Number of input bytes consumed so far
+    size_t bytesRead() const { return map ? pos : streamBytes; }
+};
+
+#endif
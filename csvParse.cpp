@@ -0,0 +1,566 @@
+#include <stdint.h>
+#include "csvParse.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CSVPARSE_X86    (1)
+#endif
+
+// Lines longer than this are always parsed by the scalar parser
+#define SIMD_MAX_LINE   (4096)
+#define SIMD_MAX_WORDS  (SIMD_MAX_LINE / 64)
+
+// Parse a CSV line into fields handling quoted fields and empty fields.
+// Returns number of fields parsed (up to max_fields).
+int parse_csv_line_scalar(char *line, size_t len, csvField_t *fields, int max_fields) {
+    int fi = 0;
+    char *p = line;
+    char *end = line + len;
+
+    // Count trailing commas up front because unescaping quoted
+    // fields below can shift bytes around inside the line.
+    int trailingCommas = 0;
+    for (char *q = end; q > line && *(q-1) == ','; q--) {
+        ++trailingCommas;
+    }
+
+    while (p < end && fi < max_fields) {
+        csvField_t *f = &fields[fi];
+
+        if (*p == '"') {
+            // Quoted field
+            p++; // skip opening quote
+            f->ptr = p;
+            char *out = p;
+            while (p < end) {
+                if (*p == '"') {
+                    // Handle escaped double quotes
+                    if ((p+1 < end) && (*(p+1) == '"')) {
+                        *out++ = '"';
+                        p += 2;
+                        continue;
+                    }
+                    p++; // closing quote
+                    break;
+                }
+                if (out != p) *out = *p;
+                out++;
+                p++;
+            }
+            f->len = out - f->ptr;
+            // Skip until comma or end
+            while (p < end && *p != ',') p++;
+            if (p < end) p++;
+        } else {
+            // Unquoted field
+            f->ptr = p;
+            while (p < end && *p != ',') p++;
+            f->len = p - f->ptr;
+            if (p < end) p++;
+        }
+
+        fi++;
+    }
+
+    // Handle trailing commas meaning empty fields
+    for (; trailingCommas > 0 && fi < max_fields; --trailingCommas) {
+        fields[fi].ptr = end;
+        fields[fi].len = 0;
+        fi++;
+    }
+
+    // Anything the line did not provide is empty
+    for (int i = fi; i < max_fields; i++) {
+        fields[i].ptr = end;
+        fields[i].len = 0;
+    }
+
+    return fi;
+}
+
+#ifdef CSVPARSE_X86
+
+// Bit i of the result is the XOR of bits 0..i of x.
+// For a mask of quote positions this is set for every byte from an
+// opening quote up to (not including) its closing quote.
+static inline uint64_t prefix_xor(uint64_t x)
+{
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+// Second stage shared by the SIMD parsers.  Uses the comma and quote
+// masks to find the field boundaries.  Returns -1 if the line must be
+// parsed by the scalar parser instead.
+//
+// The quote mask reads the line the way the scalar parser does as long
+// as every opening quote starts a field (or is the second quote of a
+// doubled quote) and every closing quote ends a field (or is the first
+// quote of a doubled quote).  Anything else, like a quote inside an
+// unquoted field or text after a closing quote, falls back.  The line
+// is only modified after that check, so a fallback sees the original.
+static int fields_from_masks(char *line, size_t len
+                             , uint64_t *commaBits, const uint64_t *quoteBits
+                             , csvField_t *fields, int max_fields)
+{
+    uint64_t    opens[SIMD_MAX_WORDS];
+    uint64_t    closes[SIMD_MAX_WORDS];
+    size_t      numWords = (len + 63) / 64;
+    uint64_t    anyQuotes = 0;
+    uint64_t    doubled = 0;
+    size_t      start = 0;
+    int         fi = 0;
+    char        *end = line + len;
+
+    for (size_t w = 0; w < numWords; w++) {
+        anyQuotes |= quoteBits[w];
+    }
+
+    if (anyQuotes) {
+        uint64_t inQuote = 0;
+        for (size_t w = 0; w < numWords; w++) {
+            uint64_t inside = prefix_xor(quoteBits[w]) ^ inQuote;
+            inQuote = (inside >> 63) ? ~(uint64_t)0 : 0;
+            opens[w] = quoteBits[w] & inside;
+            closes[w] = quoteBits[w] & ~inside;
+            commaBits[w] &= ~inside;
+        }
+        // An unterminated quote runs to the end of the line
+        if (inQuote) return -1;
+
+        uint64_t lastBit = (len % 64) ? ((uint64_t)1 << (len % 64 - 1)) : ((uint64_t)1 << 63);
+        for (size_t w = 0; w < numWords; w++) {
+            // Byte before each opening quote: start of line, a comma or a closing quote
+            uint64_t prevComma = (commaBits[w] << 1) | (w ? (commaBits[w-1] >> 63) : 1);
+            uint64_t prevClose = (closes[w] << 1) | (w ? (closes[w-1] >> 63) : 0);
+            // Byte after each closing quote: end of line, a comma or an opening quote
+            uint64_t nextComma = (commaBits[w] >> 1) | ((w + 1 < numWords) ? (commaBits[w+1] << 63) : 0);
+            uint64_t nextOpen = (opens[w] >> 1) | ((w + 1 < numWords) ? (opens[w+1] << 63) : 0);
+            uint64_t atEnd = (w + 1 == numWords) ? lastBit : 0;
+
+            if (opens[w] & ~(prevComma | prevClose)) return -1;
+            if (closes[w] & ~(nextComma | nextOpen | atEnd)) return -1;
+            doubled |= opens[w] & prevClose;
+        }
+    }
+
+    if (0 == len) {
+        for (int i = 0; i < max_fields; i++) {
+            fields[i].ptr = end;
+            fields[i].len = 0;
+        }
+        return 0;
+    }
+
+    for (size_t w = 0; w < numWords && fi < max_fields; w++) {
+        uint64_t c = commaBits[w];
+        while (c && fi < max_fields) {
+            size_t pos = w * 64 + __builtin_ctzll(c);
+            c &= c - 1;
+            fields[fi].ptr = line + start;
+            fields[fi].len = pos - start;
+            fi++;
+            start = pos + 1;
+        }
+    }
+
+    if (fi < max_fields) {
+        // The last field.  A line that ends with a comma instead gets
+        // one more empty field for each trailing comma, as with the
+        // scalar parser.
+        if (start < len) {
+            fields[fi].ptr = line + start;
+            fields[fi].len = len - start;
+            fi++;
+        }
+        else {
+            int trailingCommas = 0;
+            for (char *q = end; q > line && *(q-1) == ','; q--) {
+                ++trailingCommas;
+            }
+            for (; trailingCommas > 0 && fi < max_fields; --trailingCommas) {
+                fields[fi].ptr = end;
+                fields[fi].len = 0;
+                fi++;
+            }
+        }
+    }
+
+    // Strip the quotes from quoted fields, and unescape them
+    // if the line had any doubled quotes
+    if (anyQuotes) {
+        for (int i = 0; i < fi; i++) {
+            csvField_t *f = &fields[i];
+            if (f->len == 0 || f->ptr[0] != '"') continue;
+            f->ptr++;
+            f->len -= 2;
+            if (0 == doubled) continue;
+            char *q = (char *)memchr(f->ptr, '"', f->len);
+            if ((char *)(NULL) == q) continue;
+            char *out = q;
+            char *p = q;
+            char *fend = f->ptr + f->len;
+            while (p < fend) {
+                if (*p == '"') p++;     // first of a doubled quote
+                *out++ = *p++;
+            }
+            f->len = out - f->ptr;
+        }
+    }
+
+    // Anything the line did not provide is empty
+    for (int i = fi; i < max_fields; i++) {
+        fields[i].ptr = end;
+        fields[i].len = 0;
+    }
+
+    return fi;
+}
+
+// Comma and quote masks for one 64 byte block
+__attribute__((target("sse2")))
+static inline void block_masks_sse2(const char *p, uint64_t *commaBits, uint64_t *quoteBits)
+{
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i quote = _mm_set1_epi8('"');
+    uint64_t c = 0;
+    uint64_t q = 0;
+
+    for (int k = 0; k < 4; k++) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + k * 16));
+        c |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, comma)) << (k * 16);
+        q |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)) << (k * 16);
+    }
+    *commaBits = c;
+    *quoteBits = q;
+}
+
+__attribute__((target("avx2")))
+static inline void block_masks_avx2(const char *p, uint64_t *commaBits, uint64_t *quoteBits)
+{
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i quote = _mm256_set1_epi8('"');
+    __m256i lo = _mm256_loadu_si256((const __m256i *)(p));
+    __m256i hi = _mm256_loadu_si256((const __m256i *)(p + 32));
+
+    *commaBits = (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, comma))
+               | ((uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, comma)) << 32);
+    *quoteBits = (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, quote))
+               | ((uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, quote)) << 32);
+}
+
+// The masks for a whole line.  The last partial block is copied into
+// a zero padded block so nothing past the end of the line is read.
+#define LINE_MASKS(blockFn)                                                     \
+    size_t i;                                                                   \
+    for (i = 0; i + 64 <= len; i += 64) {                                       \
+        blockFn(line + i, &commaBits[i / 64], &quoteBits[i / 64]);              \
+    }                                                                           \
+    if (i < len) {                                                              \
+        char pad[64] = {};                                                      \
+        memcpy(pad, line + i, len - i);                                         \
+        blockFn(pad, &commaBits[i / 64], &quoteBits[i / 64]);                   \
+    }
+
+// SSE2 is part of x86-64, so this needs no runtime check there
+__attribute__((target("sse2")))
+int parse_csv_line_sse2(char *line, size_t len, csvField_t *fields, int max_fields)
+{
+    uint64_t    commaBits[SIMD_MAX_WORDS];
+    uint64_t    quoteBits[SIMD_MAX_WORDS];
+
+    if (len > SIMD_MAX_LINE) return parse_csv_line_scalar(line, len, fields, max_fields);
+
+    LINE_MASKS(block_masks_sse2)
+
+    int fi = fields_from_masks(line, len, commaBits, quoteBits, fields, max_fields);
+    if (fi < 0) fi = parse_csv_line_scalar(line, len, fields, max_fields);
+    return fi;
+}
+
+__attribute__((target("avx2")))
+int parse_csv_line_avx2(char *line, size_t len, csvField_t *fields, int max_fields)
+{
+    uint64_t    commaBits[SIMD_MAX_WORDS];
+    uint64_t    quoteBits[SIMD_MAX_WORDS];
+
+    if (len > SIMD_MAX_LINE) return parse_csv_line_scalar(line, len, fields, max_fields);
+
+    LINE_MASKS(block_masks_avx2)
+
+    int fi = fields_from_masks(line, len, commaBits, quoteBits, fields, max_fields);
+    if (fi < 0) fi = parse_csv_line_scalar(line, len, fields, max_fields);
+    return fi;
+}
+
+#endif /* CSVPARSE_X86 */
+
+typedef int (*parseFn_t)(char *, size_t, csvField_t *, int);
+
+// Pick the fastest parser this CPU supports
+static parseFn_t selectParser(const char **name)
+{
+#ifdef CSVPARSE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        *name = "avx2";
+        return parse_csv_line_avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        *name = "sse2";
+        return parse_csv_line_sse2;
+    }
+#endif
+    *name = "scalar";
+    return parse_csv_line_scalar;
+}
+
+static const char *parserName = "scalar";
+static parseFn_t parseFn = selectParser(&parserName);
+
+int parse_csv_line(char *line, size_t len, csvField_t *fields, int max_fields) {
+    return parseFn(line, len, fields, max_fields);
+}
+
+const char *csv_parser_name()
+{
+    return parserName;
+}
+
+bool parse_amount_cents(const csvField_t &field, int64_t *cents)
+{
+    csvField_t  f = field;
+    bool        any = false;        // Anything besides "$" and ","
+    bool        started = false;    // Past any leading blanks and sign
+    bool        negative = false;
+    bool        inFraction = false;
+    bool        roundUp = false;
+    int         fracDigits = 0;
+    uint64_t    whole = 0;
+    uint64_t    frac = 0;
+
+    strip_quotes(&f);
+
+    for (size_t i = 0; i < f.len; i++) {
+        char c = f.ptr[i];
+
+        if (c == ',' || c == '$') continue;
+        any = true;
+
+        if (c >= '0' && c <= '9') {
+            started = true;
+            if (false == inFraction) {
+                whole = whole * 10 + (c - '0');
+            }
+            else if (fracDigits < 2) {
+                frac = frac * 10 + (c - '0');
+                ++fracDigits;
+            }
+            else if (fracDigits == 2) {
+                roundUp = (c >= '5');
+                ++fracDigits;
+            }
+        }
+        else if (c == '.' && false == inFraction) {
+            started = true;
+            inFraction = true;
+        }
+        else if (false == started && (c == '-' || c == '+' || c == '(')) {
+            started = true;
+            negative = (c != '+');
+        }
+        else if (false == started && (c == ' ' || c == '\t')) {
+            continue;
+        }
+        else {
+            // End of the number.  The field still has an amount.
+            break;
+        }
+    }
+
+    if (false == any) return false;
+
+    for (; fracDigits < 2; fracDigits++) frac *= 10;
+    int64_t v = (int64_t)(whole * 100 + frac + (roundUp ? 1 : 0));
+    *cents = negative ? -v : v;
+    return true;
+}
+
+#ifdef CSVPARSE_TEST
+
+// Differential test of the SIMD parsers against the scalar parser,
+// and known answers for the amount parser.
+// Build with:
+//   g++ -O2 -DCSVPARSE_TEST csvParse.cpp -o csvParseTest
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TEST_FIELDS     (32)
+
+static bool sameFields(const char *name, const char *line, size_t len
+                       , int n1, const csvField_t *f1
+                       , int n2, const csvField_t *f2)
+{
+    if (n1 != n2) {
+        printf("%s: field count %d != %d for \"%.*s\"\n", name, n2, n1, (int)len, line);
+        return false;
+    }
+    for (int i = 0; i < TEST_FIELDS; i++) {
+        if  (   (f1[i].len != f2[i].len)
+             || (memcmp(f1[i].ptr, f2[i].ptr, f1[i].len) != 0)
+            )
+        {
+            printf("%s: field %d \"%.*s\" != \"%.*s\" for \"%.*s\"\n"
+                   , name, i
+                   , (int)f2[i].len, f2[i].ptr
+                   , (int)f1[i].len, f1[i].ptr
+                   , (int)len, line);
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool checkLine(const char *line, size_t len)
+{
+    bool ok = true;
+#ifdef CSVPARSE_X86
+    static char ref[SIMD_MAX_LINE + 64];
+    static char work[SIMD_MAX_LINE + 64];
+    csvField_t  f1[TEST_FIELDS];
+    csvField_t  f2[TEST_FIELDS];
+    const struct { const char *name; parseFn_t fn; bool supported; } impl[] =
+    {
+        {"sse2", parse_csv_line_sse2, (bool)__builtin_cpu_supports("sse2")}
+        ,{"avx2", parse_csv_line_avx2, (bool)__builtin_cpu_supports("avx2")}
+    };
+
+    memcpy(ref, line, len);
+    int n1 = parse_csv_line_scalar(ref, len, f1, TEST_FIELDS);
+    for (size_t k = 0; k < sizeof(impl) / sizeof(impl[0]); k++) {
+        if (false == impl[k].supported) continue;
+        memcpy(work, line, len);
+        int n2 = impl[k].fn(work, len, f2, TEST_FIELDS);
+        ok = sameFields(impl[k].name, line, len, n1, f1, n2, f2) && ok;
+    }
+#endif
+    return ok;
+}
+
+static int checkAmounts()
+{
+    const struct { const char *text; bool ok; int64_t cents; } amounts[] =
+    {
+        {"",                false,  0}
+        , {"\"\"",          false,  0}
+        , {"$,",            false,  0}
+        , {"0",             true,   0}
+        , {"12",            true,   1200}
+        , {"12.5",          true,   1250}
+        , {"-12.5",         true,   -1250}
+        , {"\"$1,234.56\"", true,   123456}
+        , {"-$1,234.56",    true,   -123456}
+        , {"$-1,234.56",    true,   -123456}
+        , {"(45.00)",       true,   -4500}
+        , {".07",           true,   7}
+        , {"1.005",         true,   101}
+        , {"1.0049",        true,   100}
+        , {" 3.10",         true,   310}
+        , {"+3",            true,   300}
+        , {"--",            true,   0}
+        , {"Processing",    true,   0}
+        , {"12.34 USD",     true,   1234}
+    };
+    int failures = 0;
+
+    for (size_t i = 0; i < sizeof(amounts) / sizeof(amounts[0]); i++) {
+        csvField_t f = {(char *)amounts[i].text, strlen(amounts[i].text)};
+        int64_t cents = 0;
+        bool ok = parse_amount_cents(f, &cents);
+        if (ok != amounts[i].ok || (ok && cents != amounts[i].cents)) {
+            printf("amount \"%s\": %d %lld, expected %d %lld\n"
+                   , amounts[i].text, (int)ok, (long long)cents
+                   , (int)amounts[i].ok, (long long)amounts[i].cents);
+            ++failures;
+        }
+    }
+    return failures;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *fixed[] =
+    {
+        ""
+        , "a"
+        , ","
+        , ",,,"
+        , "a,b,c"
+        , "a,b,"
+        , "a,,,"
+        , "\"a,b\",c"
+        , "\"a\"\"b\",c"
+        , "\"\""
+        , "\"\"\""
+        , "\"abc"
+        , "\"ab\"cd,e"
+        , "a\"b,c"
+        , "\"a,\",\"b,\","
+        , "01/02/2025,\"PAYROLL ACME \"\"CORP\"\" DEP\",\"2,500.00\",\"3,500.00\""
+    };
+    const char alphabet[] = "ab,,\"\" ";
+    char line[SIMD_MAX_LINE + 64];
+    int iterations = (argc > 1) ? atoi(argv[1]) : 200000;
+    int failures = 0;
+
+    printf("Selected parser: %s\n", csv_parser_name());
+
+    failures += checkAmounts();
+
+    for (size_t i = 0; i < sizeof(fixed) / sizeof(fixed[0]); i++) {
+        if (false == checkLine(fixed[i], strlen(fixed[i]))) ++failures;
+    }
+
+    srand(1);
+    for (int n = 0; n < iterations; n++) {
+        size_t len = 0;
+        if (n & 1) {
+            // Random bytes.  Mostly short lines, some past one
+            // and several 64 byte blocks.
+            len = (n % 10 == 1) ? (rand() % 400) : (rand() % 80);
+            for (size_t i = 0; i < len; i++) {
+                line[i] = alphabet[rand() % (sizeof(alphabet) - 1)];
+            }
+        }
+        else {
+            // Well formed lines of plain and quoted fields, which
+            // the SIMD parsers handle without falling back
+            int numFields = rand() % 40;
+            for (int f = 0; f < numFields && len < SIMD_MAX_LINE - 64; f++) {
+                bool quoted = rand() & 1;
+                int flen = rand() % 20;
+                if (f) line[len++] = ',';
+                if (quoted) line[len++] = '"';
+                for (int i = 0; i < flen; i++) {
+                    char c = alphabet[rand() % (sizeof(alphabet) - 1)];
+                    if (c == '"' || (c == ',' && false == quoted)) c = quoted ? c : 'x';
+                    if (c == '"') line[len++] = '"';
+                    line[len++] = c;
+                }
+                if (quoted) line[len++] = '"';
+            }
+        }
+        if (false == checkLine(line, len)) ++failures;
+    }
+
+    printf("%d failures\n", failures);
+    return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif /* CSVPARSE_TEST */
@@ -0,0 +1,63 @@
+#ifndef __CSVPARSE_H__
+#define __CSVPARSE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+
+// A single CSV field.  It points into the line that was parsed
+// (no copy is made) and is NOT null terminated.  Print it with
+// printf("%.*s", (int)f.len, f.ptr).
+typedef struct
+{
+    char        *ptr;
+    size_t      len;
+}   csvField_t;
+
+// Parse a CSV line into fields handling quoted fields and empty fields.
+// The line does not need to be null terminated.  Quoted fields with
+// doubled quotes ("") are unescaped in place, so the line must be writable.
+// Fields beyond the ones found are set to empty.
+// Returns number of fields parsed (up to max_fields).
+// Uses the fastest parser the CPU supports (AVX2, SSE2 or scalar),
+// picked once at startup.  All give the same results.
+int parse_csv_line(char *line, size_t len, csvField_t *fields, int max_fields);
+
+// The plain byte at a time parser
+int parse_csv_line_scalar(char *line, size_t len, csvField_t *fields, int max_fields);
+
+// Name of the parser parse_csv_line() uses ("avx2", "sse2" or "scalar")
+const char *csv_parser_name();
+
+// Parse a money amount such as "$1,234.56", "-12.5" or "(45.00)"
+// straight from a field into cents.  Surrounding quotes are removed,
+// "$" and "," are skipped and parentheses mean negative.  Beyond two
+// decimals the amount is rounded half away from zero.  Like strtod(),
+// parsing stops at the first character that can not be part of the
+// number and a field without digits is 0.
+// Returns false if the field is empty apart from quotes, "$" and ",".
+bool parse_amount_cents(const csvField_t &field, int64_t *cents);
+
+// Remove surrounding quotes from a field, if present
+static inline void strip_quotes(csvField_t *f)
+{
+    if (f->len >= 2 && f->ptr[0] == '"' && f->ptr[f->len-1] == '"') {
+        f->ptr++;
+        f->len -= 2;
+    }
+}
+
+// Case insensitive check of a field against a prefix
+static inline bool field_has_prefix_ci(const csvField_t &f, const char *prefix, size_t n)
+{
+    return (f.len >= n) && (strncasecmp(f.ptr, prefix, n) == 0);
+}
+
+// Case sensitive check of a field against a prefix
+static inline bool field_has_prefix(const csvField_t &f, const char *prefix, size_t n)
+{
+    return (f.len >= n) && (memcmp(f.ptr, prefix, n) == 0);
+}
+
+#endif
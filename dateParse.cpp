@@ -0,0 +1,256 @@
+#include <string.h>
+#include <strings.h>
+#include "dateParse.h"
+
+// Up to max digits at s[*i], moving *i past them.  Returns the number
+// of digits read.
+static inline int readDigits(const char *s, size_t n, size_t *i, int max, int *value)
+{
+    int count = 0;
+
+    *value = 0;
+    while ((*i < n) && (count < max) && ((unsigned)(s[*i] - '0') <= 9))
+    {
+        *value = *value * 10 + (s[*i] - '0');
+        ++*i;
+        ++count;
+    }
+    return count;
+}
+
+static inline bool isLeapYear(int year)
+{
+    return ((0 == year % 4) && (0 != year % 100)) || (0 == year % 400);
+}
+
+// The packed date, or 0 if the month does not have that day
+static inline int32_t makeDate(int year, int month, int day)
+{
+    static const int monthDays[12] = {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+    if ((month < 1) || (month > 12) || (day < 1) || (day > monthDays[month - 1])) return 0;
+    if ((2 == month) && (29 == day) && (false == isLeapYear(year))) return 0;
+    return year * 10000 + month * 100 + day;
+}
+
+int32_t parseDate(const char *s, size_t n, size_t *dateLen)
+{
+    size_t  i = 0;
+    int     first, second, third;
+    int32_t date = 0;
+    int     digits;
+
+    if (dateLen) *dateLen = n;
+
+    digits = readDigits(s, n, &i, 4, &first);
+    if ((i >= n) || (0 == digits)) return 0;
+
+    if (('/' == s[i]) && (digits <= 2))
+    {
+        // M/D/YYYY
+        ++i;
+        if  (   (readDigits(s, n, &i, 2, &second) == 0)
+             || (i >= n) || ('/' != s[i])
+            )
+        {
+            return 0;
+        }
+        ++i;
+        if (readDigits(s, n, &i, 4, &third) != 4) return 0;
+        date = makeDate(third, first, second);
+    }
+    else if (('-' == s[i]) && (4 == digits))
+    {
+        // YYYY-MM-DD
+        ++i;
+        if  (   (readDigits(s, n, &i, 2, &second) != 2)
+             || (i >= n) || ('-' != s[i])
+            )
+        {
+            return 0;
+        }
+        ++i;
+        if (readDigits(s, n, &i, 2, &third) != 2) return 0;
+        date = makeDate(first, second, third);
+    }
+    if (0 == date) return 0;
+
+    // Only " as of ..." may follow
+    if ((i < n) && ((n - i < 6) || (memcmp(s + i, " as of", 6) != 0))) return 0;
+
+    if (dateLen) *dateLen = i;
+    return date;
+}
+
+bool string2dateFormat(const char *s, dateFormat_t *format)
+{
+    static const struct
+    {
+        const char      *name;
+        dateFormat_t    format;
+    }   names[] =
+    {
+        {"asis", DATE_AS_IS}, {"mdy", DATE_MDY}, {"dmy", DATE_DMY}, {"iso", DATE_ISO}
+    };
+
+    for (const auto &n : names)
+    {
+        if (strcasecmp(s, n.name) == 0)
+        {
+            *format = n.format;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Two digits of v at dst
+static inline void put2(char *dst, int v)
+{
+    dst[0] = (char)('0' + v / 10);
+    dst[1] = (char)('0' + v % 10);
+}
+
+size_t formatDate(char *dst, int32_t date, dateFormat_t format)
+{
+    int year = date / 10000;
+    int month = (date / 100) % 100;
+    int day = date % 100;
+
+    switch (format)
+    {
+        case DATE_ISO:
+            put2(dst, year / 100);
+            put2(dst + 2, year % 100);
+            dst[4] = '-';
+            put2(dst + 5, month);
+            dst[7] = '-';
+            put2(dst + 8, day);
+            return 10;
+        case DATE_DMY:
+            put2(dst, day);
+            dst[2] = '/';
+            put2(dst + 3, month);
+            break;
+        default:
+            put2(dst, month);
+            dst[2] = '/';
+            put2(dst + 3, day);
+            break;
+    }
+    dst[5] = '/';
+    put2(dst + 6, year / 100);
+    put2(dst + 8, year % 100);
+    return 10;
+}
+
+#ifdef DATEPARSE_TEST
+
+// Known answers for reading dates, good and bad, and writing them.
+// Build with:
+//   g++ -O2 -DDATEPARSE_TEST dateParse.cpp -o dateParseTest
+
+#include <stdio.h>
+#include <stdlib.h>
+
+int main()
+{
+    const struct {
+        const char  *text;
+        int32_t     date;
+        size_t      dateLen;    // Only checked for a date
+    } dates[] = {
+        { "01/15/2025",                 20250115,   10 },
+        { "1/5/2025",                   20250105,   8 },
+        { "2025-01-15",                 20250115,   10 },
+        { "12/31/1999",                 19991231,   10 },
+        { "02/28/2025",                 20250228,   10 },
+        { "02/29/2024",                 20240229,   10 },   // Leap year
+        { "02/29/2000",                 20000229,   10 },   // Divisible by 400
+        { "2024-02-29",                 20240229,   10 },
+        { "04/30/2025",                 20250430,   10 },
+        { "07/31/2025 as of 07/30/2025", 20250731,  10 },
+        { "02/29/2025",                 0,          0 },    // Not a leap year
+        { "02/29/1900",                 0,          0 },    // Divisible by 100
+        { "2025-02-29",                 0,          0 },
+        { "02/30/2024",                 0,          0 },
+        { "04/31/2025",                 0,          0 },
+        { "2025-06-31",                 0,          0 },
+        { "09/31/2025",                 0,          0 },
+        { "11/31/2025",                 0,          0 },
+        { "13/01/2025",                 0,          0 },
+        { "00/10/2025",                 0,          0 },
+        { "01/00/2025",                 0,          0 },
+        { "01/32/2025",                 0,          0 },
+        { "01/15/25",                   0,          0 },
+        { "2025-1-15",                  0,          0 },
+        { "2025/01/15",                 0,          0 },
+        { "01/15/2025x",                0,          0 },
+        { "01/15/2025 as",              0,          0 },
+        { "Pending",                    0,          0 },
+        { "",                           0,          0 },
+    };
+    const struct {
+        int32_t         date;
+        dateFormat_t    format;
+        const char      *text;
+    } formats[] = {
+        { 20250105, DATE_MDY,   "01/05/2025" },
+        { 20250105, DATE_DMY,   "05/01/2025" },
+        { 20250105, DATE_ISO,   "2025-01-05" },
+        { 19991231, DATE_ISO,   "1999-12-31" },
+        { 20240229, DATE_MDY,   "02/29/2024" },
+    };
+    const struct {
+        const char      *name;
+        bool            ok;
+        dateFormat_t    format;
+    } names[] = {
+        { "asis",   true,   DATE_AS_IS },
+        { "MDY",    true,   DATE_MDY },
+        { "dmy",    true,   DATE_DMY },
+        { "iso",    true,   DATE_ISO },
+        { "ymd",    false,  DATE_AS_IS },
+        { "",       false,  DATE_AS_IS },
+    };
+    int failures = 0;
+
+    for (const auto &d : dates) {
+        size_t  dateLen;
+        int32_t date = parseDate(d.text, strlen(d.text), &dateLen);
+        if ((date != d.date) || (date && (dateLen != d.dateLen))) {
+            printf("parseDate(\"%s\") = %d length %zu, expected %d length %zu\n"
+                   , d.text, date, dateLen, d.date, d.dateLen);
+            ++failures;
+        }
+    }
+
+    for (const auto &f : formats) {
+        char    text[DATE_TEXT_MAX + 1];
+        size_t  n = formatDate(text, f.date, f.format);
+        text[n] = '\0';
+        if (strcmp(text, f.text) != 0) {
+            printf("formatDate(%d, %d) = \"%s\", expected \"%s\"\n", f.date, (int)f.format, text, f.text);
+            ++failures;
+        }
+        // parseDate() reads the month first, so DMY is not read back
+        if ((DATE_DMY != f.format) && (parseDate(text, n, (size_t *)(NULL)) != f.date)) {
+            printf("parseDate(formatDate(%d, %d)) is not the same date\n", f.date, (int)f.format);
+            ++failures;
+        }
+    }
+
+    for (const auto &nm : names) {
+        dateFormat_t format = DATE_AS_IS;
+        bool ok = string2dateFormat(nm.name, &format);
+        if ((ok != nm.ok) || (format != nm.format)) {
+            printf("string2dateFormat(\"%s\") = %d %d, expected %d %d\n", nm.name, ok, (int)format, nm.ok, (int)nm.format);
+            ++failures;
+        }
+    }
+
+    printf("%d failures\n", failures);
+    return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif /* DATEPARSE_TEST */
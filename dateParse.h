@@ -0,0 +1,45 @@
+#ifndef __DATEPARSE_H__
+#define __DATEPARSE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Dates as the exports write them, and as QIF is to get them.
+//
+// A date is kept as a yyyymmdd integer (20250115), so dates compare,
+// sort and hash as numbers.  0 is no date.
+
+// parseDate() reads a date in one pass, without looking for
+// separators first:
+//      M/D/YYYY or MM/DD/YYYY      (BoA, Citi, Fidelity, Schwab)
+//      YYYY-MM-DD
+// A date may be followed by " as of M/D/YYYY" (Schwab): that is the
+// date the transaction was backdated to, and the first one is kept.
+// Returns the packed date, or 0 if s is not a date (a day its month
+// does not have, as 02/29/2025 or 2025-04-31, or anything else after
+// it); such a date is written as the export has it.  *dateLen (if not
+// NULL) is set to the length of the first date, without any
+// " as of ...".
+int32_t parseDate(const char *s, size_t n, size_t *dateLen);
+
+// How dates are written to the QIF D line
+typedef enum
+{
+    DATE_AS_IS = 0,     // As in the export (without " as of ...")
+    DATE_MDY,           // MM/DD/YYYY
+    DATE_DMY,           // DD/MM/YYYY
+    DATE_ISO            // YYYY-MM-DD
+}   dateFormat_t;
+
+// Longest date formatDate() writes
+#define DATE_TEXT_MAX   10
+
+// The format named by s (asis, mdy, dmy or iso).  Returns false if it
+// is none of them.
+bool string2dateFormat(const char *s, dateFormat_t *format);
+
+// Write a packed date in format (not DATE_AS_IS) to dst, which has
+// room for DATE_TEXT_MAX.  Returns the length.
+size_t formatDate(char *dst, int32_t date, dateFormat_t format);
+
+#endif
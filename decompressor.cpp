@@ -0,0 +1,297 @@
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#include "decompressor.h"
+
+compression_t detectCompression(const char *data, size_t len)
+{
+    const unsigned char *p = (const unsigned char *)data;
+
+    if ((len >= 2) && (0x1F == p[0]) && (0x8B == p[1]))
+    {
+        return GZIP_COMPRESSION;
+    }
+    if ((len >= 4) && (0x28 == p[0]) && (0xB5 == p[1]) && (0x2F == p[2]) && (0xFD == p[3]))
+    {
+        return ZSTD_COMPRESSION;
+    }
+    return NO_COMPRESSION;
+}
+
+const char *compression2string(compression_t compression)
+{
+    switch (compression)
+    {
+        case GZIP_COMPRESSION:  return "gzip";
+        case ZSTD_COMPRESSION:  return "zstd";
+        default:                return "none";
+    }
+}
+
+bool compressionSupported(compression_t compression)
+{
+#ifdef HAVE_ZSTD
+    return true;
+#else
+    return (ZSTD_COMPRESSION != compression);
+#endif
+}
+
+// Read what is there, up to n bytes.  Returns 0 at end of file, -1 on an error.
+static ssize_t readInput(int fd, char *buf, size_t n)
+{
+    for (;;)
+    {
+        ssize_t r = ::read(fd, buf, n);
+        if ((r < 0) && (EINTR == errno)) continue;
+        return r;
+    }
+}
+
+Decompressor::Decompressor()
+    : head(0)
+    , tail(0)
+    , done(true)
+    , stopping(false)
+    , error(false)
+{
+}
+
+Decompressor::~Decompressor()
+{
+    stop();
+}
+
+bool Decompressor::start(int fd, compression_t compression, const char *prefix, size_t prefixLen)
+{
+    stop();
+    if  (   (NO_COMPRESSION == compression)
+         || (false == compressionSupported(compression))
+        )
+    {
+        return false;
+    }
+
+    ring.resize(DECOMPRESS_RING_SIZE);
+    head = tail = 0;
+    done = false;
+    stopping = false;
+    error = false;
+
+    std::vector<char> input(DECOMPRESS_READ_SIZE > prefixLen ? DECOMPRESS_READ_SIZE : prefixLen);
+    memcpy(input.data(), prefix, prefixLen);
+    producer = std::thread(&Decompressor::run, this, fd, compression, std::move(input), prefixLen);
+    return true;
+}
+
+void Decompressor::stop()
+{
+    if (false == producer.joinable()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    notFull.notify_one();
+    producer.join();
+}
+
+char *Decompressor::beginWrite(size_t *space)
+{
+    std::unique_lock<std::mutex> lock(mtx);
+
+    notFull.wait(lock, [&]() { return stopping || (tail - head < ring.size()); });
+    if (stopping) return (char *)(NULL);
+
+    size_t at = (size_t)(tail % ring.size());
+    size_t free = ring.size() - (size_t)(tail - head);
+    *space = (free < ring.size() - at) ? free : (ring.size() - at);
+    return ring.data() + at;
+}
+
+void Decompressor::endWrite(size_t n)
+{
+    if (0 == n) return;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        tail += n;
+    }
+    notEmpty.notify_one();
+}
+
+void Decompressor::finish(bool failed)
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        done = true;
+        error = failed;
+    }
+    notEmpty.notify_one();
+}
+
+size_t Decompressor::read(char *dst, size_t n)
+{
+    size_t avail;
+    size_t at;
+
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        notEmpty.wait(lock, [&]() { return done || (tail != head); });
+        avail = (size_t)(tail - head);
+        at = (size_t)(head % ring.size());
+    }
+    if (0 == avail) return 0;
+
+    // The producer only writes to the free part, so the copy needs no lock
+    if (n > avail) n = avail;
+    if (n > ring.size() - at) n = ring.size() - at;
+    memcpy(dst, ring.data() + at, n);
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        head += n;
+    }
+    notFull.notify_one();
+    return n;
+}
+
+bool Decompressor::failed()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    return error;
+}
+
+void Decompressor::run(int fd, compression_t compression, std::vector<char> input, size_t inputLen)
+{
+    if (GZIP_COMPRESSION == compression)
+    {
+        runGzip(fd, input, inputLen);
+    }
+    else
+    {
+        runZstd(fd, input, inputLen);
+    }
+}
+
+void Decompressor::runGzip(int fd, std::vector<char> &input, size_t inputLen)
+{
+    z_stream    zs;
+    bool        inputEnd = false;
+    bool        streamEnd = false;
+    bool        failed = false;
+
+    memset(&zs, 0, sizeof(zs));
+    // 32 lets zlib take the gzip header
+    if (inflateInit2(&zs, 15 + 32) != Z_OK)
+    {
+        finish(true);
+        return;
+    }
+    zs.next_in = (Bytef *)input.data();
+    zs.avail_in = (uInt)inputLen;
+
+    for (;;)
+    {
+        if ((0 == zs.avail_in) && (false == inputEnd))
+        {
+            ssize_t r = readInput(fd, input.data(), input.size());
+            if (r < 0) failed = true;
+            inputEnd = (r <= 0);
+            zs.next_in = (Bytef *)input.data();
+            zs.avail_in = (r > 0) ? (uInt)r : 0;
+        }
+        if (0 == zs.avail_in)
+        {
+            // A stream cut off part way is an error
+            failed = failed || (false == streamEnd);
+            break;
+        }
+
+        // gzip files may be several members one after the other
+        if (streamEnd)
+        {
+            inflateReset(&zs);
+            streamEnd = false;
+        }
+
+        size_t space;
+        char *out = beginWrite(&space);
+        if ((char *)(NULL) == out) break;
+
+        zs.next_out = (Bytef *)out;
+        zs.avail_out = (uInt)space;
+        int ret = inflate(&zs, Z_NO_FLUSH);
+        endWrite(space - zs.avail_out);
+
+        if (Z_STREAM_END == ret)
+        {
+            streamEnd = true;
+        }
+        else if ((Z_OK != ret) && (Z_BUF_ERROR != ret))
+        {
+            failed = true;
+            break;
+        }
+    }
+
+    inflateEnd(&zs);
+    finish(failed);
+}
+
+void Decompressor::runZstd(int fd, std::vector<char> &input, size_t inputLen)
+{
+#ifdef HAVE_ZSTD
+    ZSTD_DCtx       *dctx = ZSTD_createDCtx();
+    ZSTD_inBuffer   zin = {input.data(), inputLen, 0};
+    bool            inputEnd = false;
+    bool            frameEnd = false;
+    bool            failed = ((ZSTD_DCtx *)(NULL) == dctx);
+
+    while (false == failed)
+    {
+        if ((zin.pos == zin.size) && (false == inputEnd))
+        {
+            ssize_t r = readInput(fd, input.data(), input.size());
+            if (r < 0) failed = true;
+            inputEnd = (r <= 0);
+            zin.src = input.data();
+            zin.size = (r > 0) ? (size_t)r : 0;
+            zin.pos = 0;
+        }
+        if (zin.pos == zin.size)
+        {
+            // A frame cut off part way is an error
+            failed = failed || (false == frameEnd);
+            break;
+        }
+
+        size_t space;
+        char *out = beginWrite(&space);
+        if ((char *)(NULL) == out) break;
+
+        // Several frames one after the other are decompressed in turn
+        ZSTD_outBuffer zout = {out, space, 0};
+        size_t ret = ZSTD_decompressStream(dctx, &zout, &zin);
+        endWrite(zout.pos);
+
+        if (ZSTD_isError(ret))
+        {
+            failed = true;
+            break;
+        }
+        frameEnd = (0 == ret);
+    }
+
+    ZSTD_freeDCtx(dctx);
+    finish(failed);
+#else
+    (void)fd;
+    (void)input;
+    (void)inputLen;
+    finish(true);
+#endif
+}
@@ -0,0 +1,86 @@
+#ifndef __DECOMPRESSOR_H__
+#define __DECOMPRESSOR_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Compressed input.  gzip always (zlib), zstd when built with HAVE_ZSTD.
+// Files are recognised by their first bytes, not their name.
+typedef enum
+{
+    NO_COMPRESSION
+    , GZIP_COMPRESSION
+    , ZSTD_COMPRESSION
+}   compression_t;
+
+// Bytes needed to recognise every compression
+#define COMPRESSION_MAGIC_SIZE  4
+
+// The decompressed data is handed over in a ring buffer this large,
+// and the compressed data read in pieces this large
+#define DECOMPRESS_RING_SIZE    (4 * 1024 * 1024)
+#define DECOMPRESS_READ_SIZE    (256 * 1024)
+
+// The compression of data starting with these len bytes
+compression_t detectCompression(const char *data, size_t len);
+
+// "gzip", "zstd" or "none"
+const char *compression2string(compression_t compression);
+
+// False for zstd when built without HAVE_ZSTD
+bool compressionSupported(compression_t compression);
+
+// Decompresses a descriptor on a thread of its own into a ring buffer
+// that read() takes the data out of, so decompressing and converting
+// run on two cores.  The producer decompresses straight into the free
+// part of the ring; each side only waits when the ring is full or empty.
+class Decompressor {
+private:
+    std::vector<char>           ring;
+    uint64_t                    head;       // Total bytes taken out
+    uint64_t                    tail;       // Total bytes put in
+    bool                        done;       // No more will be put in
+    bool                        stopping;   // Consumer has gone away
+    bool                        error;
+    std::mutex                  mtx;
+    std::condition_variable     notEmpty;
+    std::condition_variable     notFull;
+    std::thread                 producer;
+
+    // Producer side: wait for free space and return the contiguous
+    // part of it, or NULL once stopping.  endWrite() hands it over.
+    char *beginWrite(size_t *space);
+    void endWrite(size_t n);
+    void finish(bool failed);
+
+    void run(int fd, compression_t compression, std::vector<char> input, size_t inputLen);
+    void runGzip(int fd, std::vector<char> &input, size_t inputLen);
+    void runZstd(int fd, std::vector<char> &input, size_t inputLen);
+
+public:
+    Decompressor();
+    ~Decompressor();
+
+    // Start decompressing fd.  The first prefixLen bytes of the data
+    // have already been read from it and are in prefix.  The caller
+    // keeps fd open until stop().  Returns false if the compression
+    // is not supported.
+    bool start(int fd, compression_t compression, const char *prefix, size_t prefixLen);
+
+    // Wait for the thread to finish.  It stops early if it is still
+    // decompressing.
+    void stop();
+
+    // Take up to n decompressed bytes.  Waits until there are some.
+    // Returns 0 at the end of the data (or on an error).
+    size_t read(char *dst, size_t n);
+
+    // True if the data was corrupt, truncated or could not be read
+    bool failed();
+};
+
+#endif
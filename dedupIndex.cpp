@@ -0,0 +1,411 @@
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "dedupIndex.h"
+
+// Final mix of a 64 bit hash (MurmurHash3 fmix64)
+static inline uint64_t fmix64(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+static inline uint64_t fnv1a(uint64_t h, const char *s, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        h ^= (uint8_t)s[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+DedupIndex::DedupIndex()
+    : map(nullptr)
+    , mapLen(0)
+    , slots(nullptr)
+    , numSlots(0)
+    , numEntries(0)
+    , duplicates(0)
+    , ordUsed(0)
+{
+    heap.assign(DEDUP_MIN_SLOTS, 0);
+    slots = heap.data();
+    numSlots = DEDUP_MIN_SLOTS;
+}
+
+DedupIndex::~DedupIndex()
+{
+    if (map) munmap(map, mapLen);
+}
+
+bool DedupIndex::open(const char *name, std::string &errMsg)
+{
+    struct stat st;
+
+    fileName = name;
+
+    int fd = ::open(name, O_RDONLY);
+    if (fd < 0)
+    {
+        // A new index
+        return true;
+    }
+    if  (   (fstat(fd, &st) != 0)
+         || ((size_t)st.st_size < sizeof(dedupHeader_t))
+        )
+    {
+        ::close(fd);
+        errMsg = std::string("Not a dedup index: ") + name;
+        return false;
+    }
+
+    // Private and writable: new fingerprints go into copies of the
+    // pages, the file only changes when save() writes a new one
+    void *p = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (MAP_FAILED == p)
+    {
+        errMsg = std::string("Error mapping dedup index ") + name;
+        return false;
+    }
+
+    const dedupHeader_t *h = (const dedupHeader_t *)p;
+    if  (   (memcmp(h->magic, DEDUP_MAGIC, sizeof(h->magic)) != 0)
+         || (DEDUP_VERSION != h->version)
+         || (h->numSlots < DEDUP_MIN_SLOTS)
+         || (h->numSlots & (h->numSlots - 1))
+         || (sizeof(dedupHeader_t) + h->numSlots * sizeof(uint64_t) != (size_t)st.st_size)
+         || (h->numEntries * 2 > h->numSlots)
+        )
+    {
+        munmap(p, st.st_size);
+        errMsg = std::string("Not a dedup index (or wrong version): ") + name;
+        return false;
+    }
+
+    map = p;
+    mapLen = st.st_size;
+    slots = (uint64_t *)(h + 1);
+    numSlots = h->numSlots;
+    numEntries = h->numEntries;
+    heap.clear();
+    heap.shrink_to_fit();
+    return true;
+}
+
+bool DedupIndex::save(std::string &errMsg)
+{
+    if (fileName.empty()) return true;
+
+    dedupHeader_t header = {};
+    memcpy(header.magic, DEDUP_MAGIC, sizeof(header.magic));
+    header.version = DEDUP_VERSION;
+    header.numEntries = numEntries;
+    header.numSlots = numSlots;
+
+    std::string tmpName = fileName + ".tmp";
+    FILE *fp = fopen(tmpName.c_str(), "wb");
+    if ((FILE *)(NULL) == fp)
+    {
+        errMsg = std::string("Error opening ") + tmpName;
+        return false;
+    }
+    fwrite(&header, sizeof(header), 1, fp);
+    fwrite(slots, sizeof(uint64_t), numSlots, fp);
+    bool ok = (0 == ferror(fp));
+    ok = (0 == fclose(fp)) && ok;
+    if  (   (false == ok)
+         || (rename(tmpName.c_str(), fileName.c_str()) != 0)
+        )
+    {
+        unlink(tmpName.c_str());
+        errMsg = std::string("Error writing ") + fileName;
+        return false;
+    }
+    return true;
+}
+
+void DedupIndex::grow()
+{
+    std::vector<uint64_t>   bigger(numSlots * 2, 0);
+    uint64_t                mask = bigger.size() - 1;
+
+    for (uint64_t i = 0; i < numSlots; i++)
+    {
+        uint64_t fp = slots[i];
+        if (0 == fp) continue;
+
+        uint64_t at = fp & mask;
+        while (bigger[at]) at = (at + 1) & mask;
+        bigger[at] = fp;
+    }
+
+    if (map)
+    {
+        munmap(map, mapLen);
+        map = nullptr;
+        mapLen = 0;
+    }
+    heap.swap(bigger);
+    slots = heap.data();
+    numSlots = heap.size();
+}
+
+bool DedupIndex::insert(uint64_t fp)
+{
+    if (0 == fp) fp = 1;    // 0 marks an empty slot
+
+    uint64_t mask = numSlots - 1;
+    uint64_t at = fp & mask;
+
+    // Linear probing
+    while (slots[at])
+    {
+        if (slots[at] == fp) return false;
+        at = (at + 1) & mask;
+    }
+
+    if ((numEntries + 1) * 2 > numSlots)
+    {
+        grow();
+        mask = numSlots - 1;
+        at = fp & mask;
+        while (slots[at]) at = (at + 1) & mask;
+    }
+    slots[at] = fp;
+    ++numEntries;
+    return true;
+}
+
+void DedupIndex::beginFile()
+{
+    ordKeys.assign(1024, 0);
+    ordCounts.assign(1024, 0);
+    ordUsed = 0;
+}
+
+uint32_t DedupIndex::nextOrdinal(uint64_t base)
+{
+    if (0 == base) base = 1;
+    if ((ordUsed + 1) * 2 > ordKeys.size())
+    {
+        std::vector<uint64_t> keys(ordKeys.size() * 2, 0);
+        std::vector<uint32_t> counts(ordKeys.size() * 2, 0);
+        uint64_t mask = keys.size() - 1;
+
+        for (size_t i = 0; i < ordKeys.size(); i++)
+        {
+            if (0 == ordKeys[i]) continue;
+            uint64_t at = ordKeys[i] & mask;
+            while (keys[at]) at = (at + 1) & mask;
+            keys[at] = ordKeys[i];
+            counts[at] = ordCounts[i];
+        }
+        ordKeys.swap(keys);
+        ordCounts.swap(counts);
+    }
+
+    uint64_t mask = ordKeys.size() - 1;
+    uint64_t at = base & mask;
+    while (ordKeys[at] && (ordKeys[at] != base)) at = (at + 1) & mask;
+    if (0 == ordKeys[at])
+    {
+        ordKeys[at] = base;
+        ++ordUsed;
+    }
+    return ordCounts[at]++;
+}
+
+uint64_t DedupIndex::fingerprint(int32_t dateKey
+                                 , const char *dateText, size_t dateLen
+                                 , const char *desc, size_t descLen
+                                 , int64_t cents)
+{
+    uint64_t    h = 14695981039346656037ull;
+    char        c;
+    bool        blank = false;
+    size_t      i = 0;
+
+    if (dateKey)
+    {
+        h = fnv1a(h, (const char *)&dateKey, sizeof(dateKey));
+    }
+    else
+    {
+        h = fnv1a(h, dateText, dateLen);
+    }
+    h = fnv1a(h, "\n", 1);
+
+    // Upper case, without leading and trailing blanks, runs of blanks as one
+    while ((i < descLen) && isspace((unsigned char)desc[i])) ++i;
+    for (; i < descLen; i++)
+    {
+        if (isspace((unsigned char)desc[i]))
+        {
+            blank = true;
+            continue;
+        }
+        if (blank)
+        {
+            h = fnv1a(h, " ", 1);
+            blank = false;
+        }
+        c = (char)toupper((unsigned char)desc[i]);
+        h = fnv1a(h, &c, 1);
+    }
+    h = fnv1a(h, "\n", 1);
+    h = fnv1a(h, (const char *)&cents, sizeof(cents));
+    return fmix64(h);
+}
+
+bool DedupIndex::isDuplicate(uint64_t base)
+{
+    if (ordKeys.empty()) beginFile();
+
+    uint64_t ordinal = nextOrdinal(base);
+    if (insert(fmix64(base + ordinal * 0x9E3779B97F4A7C15ull))) return false;
+    ++duplicates;
+    return true;
+}
+
+#ifdef DEDUPINDEX_TEST
+
+// Known answers for fingerprints, ordinals across files, growing the
+// set and keeping it in a file.
+// Build with:
+//   g++ -O2 -DDEDUPINDEX_TEST dedupIndex.cpp -o dedupIndexTest
+
+#include <stdlib.h>
+
+#define FP(key, date, desc, cents) \
+    DedupIndex::fingerprint(key, date, strlen(date), desc, strlen(desc), cents)
+
+int main()
+{
+    const struct {
+        int32_t     key1;
+        const char  *date1;
+        const char  *desc1;
+        int64_t     cents1;
+        int32_t     key2;
+        const char  *date2;
+        const char  *desc2;
+        int64_t     cents2;
+        bool        same;
+    } prints[] = {
+        { 20250103, "01/03/2025", "YOU SOLD", -1000,    20250103, "2025-01-03", "YOU SOLD", -1000,          true },
+        { 20250103, "01/03/2025", "You  sold ", -1000,  20250103, "01/03/2025", " YOU SOLD", -1000,         true },
+        { 20250103, "01/03/2025", "YOU SOLD", -1000,    20250104, "01/03/2025", "YOU SOLD", -1000,          false },
+        { 20250103, "01/03/2025", "YOU SOLD", -1000,    20250103, "01/03/2025", "YOU SOLD", 1000,           false },
+        { 20250103, "01/03/2025", "YOU SOLD", -1000,    20250103, "01/03/2025", "YOU BOUGHT", -1000,        false },
+        { 20250103, "01/03/2025", "YOUSOLD", -1000,     20250103, "01/03/2025", "YOU SOLD", -1000,          false },
+        { 0, "Pending", "YOU SOLD", -1000,              0, "Pending", "YOU SOLD", -1000,                    true },
+        { 0, "Pending", "YOU SOLD", -1000,              0, "Total", "YOU SOLD", -1000,                      false },
+    };
+    // Two files of transactions A, B, C: whether each is a duplicate
+    const struct {
+        char        txn;
+        bool        newFile;
+        bool        duplicate;
+    } runs[] = {
+        { 'A', true,  false }, { 'A', false, false }, { 'B', false, false },
+        { 'A', true,  true  }, { 'B', false, true  }, { 'B', false, false },
+        { 'A', false, true  }, { 'A', false, false }, { 'C', false, false },
+    };
+    char        fileName[] = "/tmp/dedupIndexTestXXXXXX";
+    std::string errMsg;
+    int         failures = 0;
+
+    for (const auto &p : prints) {
+        bool same = (FP(p.key1, p.date1, p.desc1, p.cents1) == FP(p.key2, p.date2, p.desc2, p.cents2));
+        if (same != p.same) {
+            printf("fingerprint(\"%s\" \"%s\" %lld) %s fingerprint(\"%s\" \"%s\" %lld)\n"
+                   , p.date1, p.desc1, (long long)p.cents1, same ? "==" : "!="
+                   , p.date2, p.desc2, (long long)p.cents2);
+            ++failures;
+        }
+    }
+
+    auto fpOf = [](char txn) {
+        char desc[2] = {txn, '\0'};
+        return FP(20250103, "01/03/2025", desc, 100);
+    };
+
+    DedupIndex index;
+    for (size_t i = 0; i < sizeof(runs) / sizeof(runs[0]); i++) {
+        if (runs[i].newFile) index.beginFile();
+        if (index.isDuplicate(fpOf(runs[i].txn)) != runs[i].duplicate) {
+            printf("run %zu: %c is%s a duplicate\n", i, runs[i].txn, runs[i].duplicate ? " not" : "");
+            ++failures;
+        }
+    }
+    if ((index.size() != 6) || (index.numDuplicates() != 3)) {
+        printf("%llu entries, %llu duplicates, expected 6 and 3\n"
+               , (unsigned long long)index.size(), (unsigned long long)index.numDuplicates());
+        ++failures;
+    }
+
+    // Past DEDUP_MIN_SLOTS the set grows, and keeps what it had
+    for (uint64_t i = 0; i < 3 * DEDUP_MIN_SLOTS; i++) {
+        if (false == index.insert(fmix64(i + 1))) {
+            printf("insert %llu: already there\n", (unsigned long long)i);
+            ++failures;
+            break;
+        }
+    }
+    index.beginFile();
+    if ((false == index.isDuplicate(fpOf('C'))) || index.insert(fmix64(1))) {
+        printf("lost fingerprints when the set grew\n");
+        ++failures;
+    }
+
+    // Saved and opened again, the index has the same fingerprints
+    int fd = mkstemp(fileName);
+    if (fd < 0) {
+        printf("Can not make a file in /tmp\n");
+        return EXIT_FAILURE;
+    }
+    ::close(fd);
+    {
+        DedupIndex bad;
+        if (bad.open(fileName, errMsg)) {
+            printf("an empty file opened as an index\n");
+            ++failures;
+        }
+    }
+    unlink(fileName);
+    {
+        DedupIndex saved;
+        if ((false == saved.open(fileName, errMsg)) || (false == saved.insert(fmix64(7))) || (false == saved.save(errMsg))) {
+            printf("save: %s\n", errMsg.c_str());
+            ++failures;
+        }
+    }
+    {
+        DedupIndex loaded;
+        if  (   (false == loaded.open(fileName, errMsg))
+             || (loaded.size() != 1)
+             || loaded.insert(fmix64(7))
+             || (false == loaded.insert(fmix64(8)))
+            )
+        {
+            printf("open: the saved index is not the same %s\n", errMsg.c_str());
+            ++failures;
+        }
+    }
+    unlink(fileName);
+
+    printf("%d failures\n", failures);
+    return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif /* DEDUPINDEX_TEST */
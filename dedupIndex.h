@@ -0,0 +1,98 @@
+#ifndef __DEDUPINDEX_H__
+#define __DEDUPINDEX_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Transactions already converted, so overlapping exports of the same
+// account do not give the same transaction twice.
+//
+// A transaction is known by a 64 bit fingerprint of its date, its
+// description, its amount in cents and its ordinal: the first, second,
+// ... transaction of the file with that date, description and amount.
+// The ordinal keeps two real, identical transactions of one day apart,
+// while the same day exported again in another file matches them one
+// for one.  The fingerprint is taken from the row as the export has
+// it, when it is converted: the date as parseDate() packs it (its text
+// if it is not a date), and the description before it is rewritten
+// (upper case, runs of blanks made one).  So --date-format and the
+// description rules do not change it.
+//
+// Fingerprints are kept in an open addressing hash set of uint64_t,
+// 0 for an empty slot, at most half full: 16 to 32 bytes a transaction
+// however long its description.
+//
+// The set can be kept in an index file between runs.  It is memory
+// mapped (privately) when opened, so a large index is not read in, and
+// written back by save().  File layout:
+//      dedupHeader_t
+//      numSlots    uint64_t    fingerprints
+#define DEDUP_MAGIC         "C2QDEDUP"
+#define DEDUP_VERSION       2
+#define DEDUP_MIN_SLOTS     4096
+
+typedef struct
+{
+    char        magic[8];
+    uint32_t    version;
+    uint32_t    reserved;
+    uint64_t    numEntries;
+    uint64_t    numSlots;       // A power of two
+}   dedupHeader_t;
+
+class DedupIndex {
+private:
+    std::string             fileName;   // Empty if not kept in a file
+    void                    *map;
+    size_t                  mapLen;
+    std::vector<uint64_t>   heap;       // Slots once they are not mapped
+    uint64_t                *slots;
+    uint64_t                numSlots;
+    uint64_t                numEntries;
+    uint64_t                duplicates;
+
+    // Ordinals of this file: base fingerprint and count so far
+    std::vector<uint64_t>   ordKeys;
+    std::vector<uint32_t>   ordCounts;
+    size_t                  ordUsed;
+
+    void grow();
+    uint32_t nextOrdinal(uint64_t base);
+
+public:
+    DedupIndex();
+    ~DedupIndex();
+
+    // Keep the set in fileName, loading it if the file exists.
+    // Returns false, with errMsg set, if it is not an index file.
+    bool open(const char *fileName, std::string &errMsg);
+
+    // Write the set back to its file, replacing it in one step.
+    // Does nothing if it is not kept in a file.
+    bool save(std::string &errMsg);
+
+    // Ordinals count from the start of each file
+    void beginFile();
+
+    // Fingerprint of a transaction, without its ordinal.  dateKey is
+    // the date packed by parseDate(); dateText is only used if it is 0.
+    static uint64_t fingerprint(int32_t dateKey
+                                , const char *dateText, size_t dateLen
+                                , const char *desc, size_t descLen
+                                , int64_t cents);
+
+    // Add a fingerprint.  Returns false if it was already there.
+    bool insert(uint64_t fp);
+
+    // The next transaction of the file, in file order, by its
+    // fingerprint().  Returns true if it was seen before (in this run,
+    // or in the index file), and is to be left out.
+    bool isDuplicate(uint64_t base);
+
+    uint64_t size() const           { return numEntries; }
+    uint64_t numDuplicates() const  { return duplicates; }
+};
+
+#endif
@@ -0,0 +1,387 @@
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include "descRules.h"
+#include "csvParse.h"
+
+#define MAX_RULE_LINE   4096
+
+typedef struct
+{
+    descRuleClass_t     ruleClass;
+    const char          *prefix;
+    const char          *replacement;
+}   builtInRule_t;
+
+// In the order they are tried
+static const builtInRule_t builtInRules[] =
+{
+     {DESC_RULE_MM,     "DIVIDEND",             "{symbol} Dividend"}
+    ,{DESC_RULE_MM,     "Reinvest Dividend",    "{symbol} Dividend"}
+    ,{DESC_RULE_MM,     "Cash Dividend",        "{symbol} Dividend"}
+    ,{DESC_RULE_MM,     "REINVESTMENT",         "{symbol} Purchase"}
+    ,{DESC_RULE_MM,     "YOU BOUGHT",           "{symbol} Purchase"}
+    ,{DESC_RULE_MM,     "Reinvest Shares",      "{symbol} Purchase"}
+    ,{DESC_RULE_MM,     "Buy",                  "{symbol} Purchase"}
+    ,{DESC_RULE_MM,     "YOU SOLD",             "{symbol} Sale"}
+    ,{DESC_RULE_MM,     "Sell",                 "{symbol} Sale"}
+    ,{DESC_RULE_TBILL,  "YOU BOUGHT",           "T-Bill Purchase"}
+    ,{DESC_RULE_TBILL,  "REDEMPTION",           "T-Bill Redemption"}
+    ,{DESC_RULE_CD,     "INTEREST",             "{bank} - Interest"}
+    ,{DESC_RULE_CD,     "REDEMPTION",           "{bank} - Redemption"}
+};
+
+static const char *ruleClassNames[NUM_DESC_RULE_CLASSES] = {"mm", "tbill", "cd"};
+
+PrefixMatcher::PrefixMatcher()
+{
+    build(std::vector<std::string>());
+}
+
+void PrefixMatcher::build(const std::vector<std::string> &prefixes)
+{
+    // A class for each character used, upper and lower case the same
+    memset(charClass, 0, sizeof(charClass));
+    numClasses = 1;
+    for (const std::string &prefix : prefixes)
+    {
+        for (unsigned char c : prefix)
+        {
+            unsigned char lower = (unsigned char)tolower(c);
+            if (0 == charClass[lower])
+            {
+                charClass[lower] = (uint16_t)numClasses++;
+                charClass[(unsigned char)toupper(c)] = charClass[lower];
+            }
+        }
+    }
+
+    // State 0 is the start
+    next.assign(numClasses, 0);
+    idAt.assign(1, -1);
+    for (size_t id = 0; id < prefixes.size(); id++)
+    {
+        int32_t state = 0;
+
+        for (unsigned char c : prefixes[id])
+        {
+            int32_t &to = next[state * numClasses + charClass[c]];
+            if (0 == to)
+            {
+                to = (int32_t)idAt.size();
+                idAt.push_back(-1);
+                next.resize(next.size() + numClasses, 0);
+            }
+            // next may have moved
+            state = next[state * numClasses + charClass[c]];
+        }
+        if (idAt[state] < 0) idAt[state] = (int32_t)id;
+    }
+}
+
+int PrefixMatcher::match(const char *s, size_t n) const
+{
+    int32_t     state = 0;
+    int         best = -1;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        uint16_t c = charClass[(unsigned char)s[i]];
+        if (0 == c) break;
+
+        state = next[state * numClasses + c];
+        if (0 == state) break;
+
+        int id = idAt[state];
+        if ((id >= 0) && ((best < 0) || (id < best))) best = id;
+    }
+    return best;
+}
+
+DescriptionRules::DescriptionRules()
+    : pool(arena)
+{
+    for (const builtInRule_t &r : builtInRules)
+    {
+        texts.push_back({r.ruleClass, r.prefix, r.replacement});
+    }
+    build();
+}
+
+const DescriptionRules &DescriptionRules::builtIn()
+{
+    static const DescriptionRules rules;
+    return rules;
+}
+
+void DescriptionRules::build()
+{
+    std::vector<std::string>    prefixes[NUM_DESC_RULE_CLASSES];
+
+    pool.clear();
+    arena.reset();
+    for (int c = 0; c < NUM_DESC_RULE_CLASSES; c++) rules[c].clear();
+
+    for (const ruleText_t &t : texts)
+    {
+        const std::string   &r = t.replacement;
+        descRule_t          rule;
+        size_t              at;
+        size_t              len = 0;
+
+        rule.insert = DESC_INSERT_NONE;
+        if ((at = r.find("{symbol}")) != std::string::npos)
+        {
+            rule.insert = DESC_INSERT_SYMBOL;
+            len = 8;
+        }
+        else if ((at = r.find("{bank}")) != std::string::npos)
+        {
+            rule.insert = DESC_INSERT_BANK;
+            len = 6;
+        }
+        else
+        {
+            at = r.size();
+        }
+
+        rule.head = pool.get(pool.intern(r.data(), at));
+        rule.tail = pool.get(pool.intern(r.data() + at + len, r.size() - at - len));
+
+        prefixes[t.ruleClass].push_back(t.prefix);
+        rules[t.ruleClass].push_back(rule);
+    }
+
+    for (int c = 0; c < NUM_DESC_RULE_CLASSES; c++) matchers[c].build(prefixes[c]);
+}
+
+bool DescriptionRules::load(const char *fileName, std::string &errMsg)
+{
+    FILE                    *fp = fopen(fileName, "r");
+    char                    line[MAX_RULE_LINE];
+    csvField_t              fields[4];
+    std::vector<ruleText_t> added;
+    int                     lineNumber = 0;
+
+    if ((FILE *)(NULL) == fp)
+    {
+        errMsg = std::string("Error opening rules file ") + fileName;
+        return false;
+    }
+
+    while (fgets(line, sizeof(line), fp))
+    {
+        size_t len = strlen(line);
+
+        ++lineNumber;
+        while (len && (('\n' == line[len - 1]) || ('\r' == line[len - 1]))) --len;
+        if ((0 == len) || ('#' == line[0])) continue;
+
+        int n = parse_csv_line(line, len, fields, 4);
+        for (int i = 0; i < n; i++) strip_quotes(&fields[i]);
+
+        ruleText_t  t;
+        int         c;
+        for (c = 0; c < NUM_DESC_RULE_CLASSES; c++)
+        {
+            size_t nameLen = strlen(ruleClassNames[c]);
+            if ((fields[0].len == nameLen) && (strncasecmp(fields[0].ptr, ruleClassNames[c], nameLen) == 0)) break;
+        }
+        t.ruleClass = (descRuleClass_t)c;
+        t.prefix.assign(fields[1].ptr, fields[1].len);
+        t.replacement.assign(fields[2].ptr, fields[2].len);
+
+        const char *problem = (const char *)(NULL);
+        if (3 != n)
+        {
+            problem = "not class,prefix,replacement";
+        }
+        else if (NUM_DESC_RULE_CLASSES == c)
+        {
+            problem = "class is not mm, tbill or cd";
+        }
+        else if (t.prefix.empty())
+        {
+            problem = "empty prefix";
+        }
+        else if (   ((t.replacement.find("{bank}") != std::string::npos) && (DESC_RULE_CD != t.ruleClass))
+                 || ((t.replacement.find("{symbol}") != std::string::npos) && (t.replacement.find("{bank}") != std::string::npos))
+                )
+        {
+            problem = "{bank} is only for cd rules, and one of {symbol} or {bank} at most";
+        }
+        if (problem)
+        {
+            fclose(fp);
+            errMsg = std::string(fileName) + " line " + std::to_string(lineNumber) + ": " + problem;
+            return false;
+        }
+        added.push_back(t);
+    }
+    fclose(fp);
+
+    texts.insert(texts.begin(), added.begin(), added.end());
+    build();
+    return true;
+}
+
+#ifdef DESCRULES_TEST
+
+// Known answers for prefix matching, the built-in rules, and rules
+// files good and bad.
+// Build with:
+//   g++ -O2 -DDESCRULES_TEST descRules.cpp transaction.cpp csvParse.cpp -o descRulesTest
+
+#include <stdlib.h>
+#include <unistd.h>
+
+// A rule as "head|insert|tail" (insert s, b or -), or "" for none
+static std::string ruleText(const descRule_t *rule)
+{
+    if ((const descRule_t *)(NULL) == rule) return "";
+
+    const char *insert = (DESC_INSERT_SYMBOL == rule->insert) ? "s" : (DESC_INSERT_BANK == rule->insert) ? "b" : "-";
+    return std::string(rule->head) + "|" + insert + "|" + std::string(rule->tail);
+}
+
+static bool writeRules(const char *fileName, const char *text)
+{
+    FILE *fp = fopen(fileName, "w");
+
+    if ((FILE *)(NULL) == fp) return false;
+    fputs(text, fp);
+    return (0 == fclose(fp));
+}
+
+int main()
+{
+    const struct {
+        const char  *desc;
+        int         id;
+    } prefixMatches[] = {
+        { "ABCD",   0 },        // AB, A and ABC all match: the lowest id
+        { "abc",    0 },
+        { "AX",     1 },
+        { "A",      1 },
+        { "B",      -1 },
+        { "",       -1 },
+        { "XA",     -1 },
+    };
+    const struct {
+        descRuleClass_t ruleClass;
+        const char      *desc;
+        const char      *rule;
+    } builtIn[] = {
+        { DESC_RULE_MM,     "DIVIDEND RECEIVED FIDELITY",   "|s| Dividend" },
+        { DESC_RULE_MM,     "dividend received",            "|s| Dividend" },
+        { DESC_RULE_MM,     "Reinvest Shares",              "|s| Purchase" },
+        { DESC_RULE_MM,     "YOU SOLD FIDELITY MM",         "|s| Sale" },
+        { DESC_RULE_MM,     "REDEMPTION PAYOUT",            "" },
+        { DESC_RULE_TBILL,  "YOU BOUGHT UNITED STATES",     "T-Bill Purchase|-|" },
+        { DESC_RULE_TBILL,  "REDEMPTION PAYOUT",            "T-Bill Redemption|-|" },
+        { DESC_RULE_TBILL,  "DIVIDEND",                     "" },
+        { DESC_RULE_CD,     "INTEREST EARNED",              "|b| - Interest" },
+        { DESC_RULE_CD,     "REDEMPTION PAYOUT",            "|b| - Redemption" },
+        { DESC_RULE_CD,     "YOU BOUGHT",                   "" },
+    };
+    const struct {
+        const char      *text;
+        bool            ok;
+        const char      *error;         // The end of errMsg
+        descRuleClass_t ruleClass;      // And then a match
+        const char      *desc;
+        const char      *rule;
+    } files[] = {
+        { "# comment\n\nmm,DIVIDEND,Div {symbol}\r\n", true, "",
+          DESC_RULE_MM, "DIVIDEND RECEIVED", "Div |s|" },
+        { "mm,DIVIDEND,Div {symbol}\n", true, "",
+          DESC_RULE_MM, "YOU SOLD", "|s| Sale" },
+        { "CD,\"INTEREST, PAID\",{bank} interest\n", true, "",
+          DESC_RULE_CD, "interest, paid", "|b| interest" },
+        { "tbill,YOU BOUGHT,Bill\nmm,SWEEP,Sweep {symbol} in\n", true, "",
+          DESC_RULE_MM, "SWEEP", "Sweep |s| in" },
+        { "mm,DIVIDEND\n", false, "line 1: not class,prefix,replacement",
+          DESC_RULE_MM, "DIVIDEND", "|s| Dividend" },
+        { "# ok\nbond,X,Y\n", false, "line 2: class is not mm, tbill or cd",
+          DESC_RULE_MM, "DIVIDEND", "|s| Dividend" },
+        { "mm,,Y\n", false, "line 1: empty prefix",
+          DESC_RULE_MM, "DIVIDEND", "|s| Dividend" },
+        { "mm,X,{bank}\n", false, "line 1: {bank} is only for cd rules, and one of {symbol} or {bank} at most",
+          DESC_RULE_MM, "X", "" },
+        { "mm,SWEEP,Sweep\ncd,X,{bank} {symbol}\n", false, "line 2: {bank} is only for cd rules, and one of {symbol} or {bank} at most",
+          DESC_RULE_MM, "SWEEP", "" },
+    };
+    char        fileName[] = "/tmp/descRulesTestXXXXXX";
+    std::string errMsg;
+    int         failures = 0;
+
+    PrefixMatcher matcher;
+    matcher.build({"AB", "A", "ABC"});
+    for (const auto &m : prefixMatches) {
+        int id = matcher.match(m.desc, strlen(m.desc));
+        if (id != m.id) {
+            printf("PrefixMatcher: \"%s\" matched %d, expected %d\n", m.desc, id, m.id);
+            ++failures;
+        }
+    }
+
+    const DescriptionRules &rules = DescriptionRules::builtIn();
+    for (const auto &b : builtIn) {
+        std::string got = ruleText(rules.match(b.ruleClass, b.desc, strlen(b.desc)));
+        if (got != b.rule) {
+            printf("built-in %s \"%s\": \"%s\", expected \"%s\"\n"
+                   , ruleClassNames[b.ruleClass], b.desc, got.c_str(), b.rule);
+            ++failures;
+        }
+    }
+
+    int fd = mkstemp(fileName);
+    if (fd < 0) {
+        printf("Can not make a file in /tmp\n");
+        return EXIT_FAILURE;
+    }
+    close(fd);
+
+    for (const auto &f : files) {
+        DescriptionRules loaded;
+        size_t           before = loaded.size();
+
+        errMsg.clear();
+        if (false == writeRules(fileName, f.text)) {
+            printf("Can not write %s\n", fileName);
+            ++failures;
+            continue;
+        }
+        bool ok = loaded.load(fileName, errMsg);
+        size_t n = errMsg.size();
+        size_t e = strlen(f.error);
+        if  (   (ok != f.ok)
+             || (n < e)
+             || (errMsg.compare(n - e, e, f.error) != 0)
+             || (false == ok && (loaded.size() != before))
+            )
+        {
+            printf("file \"%s\": %s \"%s\", expected %s \"%s\"\n", f.text
+                   , ok ? "loaded" : "refused", errMsg.c_str(), f.ok ? "loaded" : "refused", f.error);
+            ++failures;
+        }
+        std::string got = ruleText(loaded.match(f.ruleClass, f.desc, strlen(f.desc)));
+        if (got != f.rule) {
+            printf("file \"%s\": %s \"%s\" matched \"%s\", expected \"%s\"\n", f.text
+                   , ruleClassNames[f.ruleClass], f.desc, got.c_str(), f.rule);
+            ++failures;
+        }
+    }
+    unlink(fileName);
+
+    if (DescriptionRules().load("/nonexistent/rules", errMsg)) {
+        printf("a missing rules file loaded\n");
+        ++failures;
+    }
+
+    printf("%d failures\n", failures);
+    return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif /* DESCRULES_TEST */
@@ -0,0 +1,114 @@
+#ifndef __DESCRULES_H__
+#define __DESCRULES_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "transaction.h"
+
+// How the descriptions of money market, T-Bill and CD transactions are
+// rewritten.  A rule belongs to one class of holding and says: a
+// description that starts with this prefix (upper and lower case are
+// the same) becomes this replacement.  When more than one prefix
+// matches, the rule listed first wins.
+//
+// A replacement may hold one {symbol} (the transaction's symbol) or,
+// for a CD, one {bank} (the issuing bank).  The text around it is
+// interned once, when the rules are built, so rewriting a row is a
+// table walk and at most three copies.
+//
+// The built-in rules are in descRules.cpp.  More can be read from a
+// rules file, one rule a line, as CSV:
+//      class,prefix,replacement
+// class is mm, tbill or cd.  Blank lines and lines starting with # are
+// skipped.  Rules from the file come before the built-in ones, so they
+// can change what a built-in prefix is rewritten to.
+typedef enum
+{
+    DESC_RULE_MM = 0,           // Money market funds
+    DESC_RULE_TBILL,            // T-Bills
+    DESC_RULE_CD,               // CDs
+    NUM_DESC_RULE_CLASSES
+}   descRuleClass_t;
+
+typedef enum
+{
+    DESC_INSERT_NONE = 0,
+    DESC_INSERT_SYMBOL,
+    DESC_INSERT_BANK
+}   descInsert_t;
+
+// A replacement: head, then the symbol or bank (if any), then tail
+typedef struct
+{
+    std::string_view    head;
+    descInsert_t        insert;
+    std::string_view    tail;
+}   descRule_t;
+
+// Finds which of a set of prefixes a string starts with, ignoring
+// case.  The prefixes are made into a trie, kept as a state table
+// indexed by state and character class, so matching looks at each
+// character of the string once and stops as soon as no prefix can
+// match.
+class PrefixMatcher {
+private:
+    uint16_t                charClass[256];     // 0 for a character in no prefix
+    int                     numClasses;
+    std::vector<int32_t>    next;               // [state * numClasses + class], 0 for none
+    std::vector<int32_t>    idAt;               // Id of the prefix ending at each state, -1 if none
+
+public:
+    PrefixMatcher();
+
+    // Make the matcher for prefixes[i], whose id is i
+    void build(const std::vector<std::string> &prefixes);
+
+    // Lowest id of the prefixes s starts with, -1 if none
+    int match(const char *s, size_t n) const;
+};
+
+class DescriptionRules {
+private:
+    typedef struct
+    {
+        descRuleClass_t     ruleClass;
+        std::string         prefix;
+        std::string         replacement;
+    }   ruleText_t;
+
+    std::vector<ruleText_t>     texts;      // In the order they are tried
+    Arena                       arena;
+    StringPool                  pool;
+    PrefixMatcher               matchers[NUM_DESC_RULE_CLASSES];
+    std::vector<descRule_t>     rules[NUM_DESC_RULE_CLASSES];
+
+    void build();
+
+public:
+    DescriptionRules();
+
+    DescriptionRules(const DescriptionRules &) = delete;
+    DescriptionRules &operator=(const DescriptionRules &) = delete;
+
+    // The built-in rules only
+    static const DescriptionRules &builtIn();
+
+    // Add the rules of a rules file ahead of the ones there are.
+    // Returns false, with errMsg set, if it can not be read or a
+    // line is not a rule.  Nothing is added then.
+    bool load(const char *fileName, std::string &errMsg);
+
+    // The rule for a description, or NULL if it is not rewritten
+    const descRule_t *match(descRuleClass_t ruleClass, const char *desc, size_t len) const
+    {
+        int i = matchers[ruleClass].match(desc, len);
+        return (i < 0) ? (const descRule_t *)(NULL) : &rules[ruleClass][i];
+    }
+
+    size_t size() const     { return texts.size(); }
+};
+
+#endif
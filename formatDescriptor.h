@@ -0,0 +1,118 @@
+#ifndef __FORMATDESCRIPTOR_H__
+#define __FORMATDESCRIPTOR_H__
+
+#include <stddef.h>
+#include "bankFormat.h"
+
+// How each bank lays out its export.  A format is described here,
+// not coded: QifConverter finds the columns by name in the export's
+// column header line, and compiles a row function for each distinct
+// set of flags.  Adding a bank is a bankFormat_t value and an entry
+// in formatDescriptors[].
+
+// Row handling.  These are template arguments of the row functions,
+// so a format only pays for the steps it uses.
+#define ROW_DEBIT_CREDIT        0x01    // Separate withdrawal (debit) and deposit (credit)
+                                        // columns instead of one signed amount.  A debit
+                                        // is used if not empty and is made negative.
+#define ROW_SKIP_PREFIX         0x02    // Skip rows whose skip column starts with skipPrefix
+#define ROW_DATE_DIGIT          0x04    // Skip rows whose date does not start with a digit
+#define ROW_DATE_AS_OF          0x08    // Cut any " as of ..." off the date
+#define ROW_REWRITE_HOLDINGS    0x10    // Rewrite money market, T-Bill and CD descriptions
+                                        // by symbol (Fidelity)
+#define ROW_REWRITE_MM_ACTION   0x20    // For money market symbols the description is the
+                                        // action, rewritten (Schwab brokerage)
+
+// A column: its name in the column header line, and the column it is
+// when the header does not have that name.  A name matches a header
+// column exactly, or failing that the start of one ("Amount" finds
+// "Amount ($)").  {NULL, -1} for a column the format does not have.
+typedef struct
+{
+    const char  *name;
+    int         index;
+}   columnSpec_t;
+
+#define NO_COLUMN   {(const char *)(NULL), -1}
+
+typedef struct
+{
+    bankFormat_t    bankFormat;
+    const char      *name;          // As given to -f
+    const char      *nameMatch;     // string2bankFormat() looks for this in a name
+    const char      *headerStart;   // The column header line starts with this
+    const char      *signature;     // Start of the column header line, long enough to
+                                    // tell this format from the others (sniffBankFormat())
+    unsigned        flags;          // ROW_...
+    bool            newestFirst;    // Transactions are listed newest first
+    bool            investment;     // A brokerage account: OFX writes an investment
+                                    // statement rather than a bank statement
+    columnSpec_t    date;
+    columnSpec_t    desc;
+    columnSpec_t    amount;         // Without ROW_DEBIT_CREDIT
+    columnSpec_t    debit;          // With ROW_DEBIT_CREDIT
+    columnSpec_t    credit;         // With ROW_DEBIT_CREDIT
+    columnSpec_t    symbol;
+    columnSpec_t    action;
+    columnSpec_t    skip;           // With ROW_SKIP_PREFIX
+    const char      *skipPrefix;    // With ROW_SKIP_PREFIX
+}   formatDescriptor_t;
+
+// Header lines are compared with the quotes removed
+inline constexpr formatDescriptor_t formatDescriptors[] =
+{
+    {
+        BOA_FORMAT, "BoA", "boa"
+        , "Date,", "Date,Description,Amount,Running Bal."
+        , 0, false, false
+        , {"Date", 0}, {"Description", 1}, {"Amount", 2}
+        , NO_COLUMN, NO_COLUMN, NO_COLUMN, NO_COLUMN, NO_COLUMN
+        , (const char *)(NULL)
+    }
+    ,{
+        CITI_FORMAT, "Citi", "citi"
+        , "Status", "Status,Date,Description,Debit,Credit"
+        , ROW_DEBIT_CREDIT, false, false
+        , {"Date", 1}, {"Description", 2}, NO_COLUMN
+        , {"Debit", 3}, {"Credit", 4}, NO_COLUMN, NO_COLUMN, NO_COLUMN
+        , (const char *)(NULL)
+    }
+    ,{
+        FIDELITY_FORMAT, "Fidelity", "fid"
+        , "Run Date,", "Run Date,Action,Symbol,Description,"
+        , ROW_SKIP_PREFIX | ROW_DATE_DIGIT | ROW_REWRITE_HOLDINGS, true, true
+        , {"Run Date", 0}, {"Action", 1}, {"Amount", 14}
+        , NO_COLUMN, NO_COLUMN, {"Symbol", 2}, NO_COLUMN, {"Cash Balance", 15}
+        , "Processing"      // Still in process
+    }
+    ,{
+        SCHWAB_BANK_FORMAT, "SchwabBank", "schwabbank"
+        , "Date,", "Date,Status,Type,CheckNumber,Description,Withdrawal,Deposit"
+        , ROW_DEBIT_CREDIT, true, false
+        , {"Date", 0}, {"Description", 4}, NO_COLUMN
+        , {"Withdrawal", 5}, {"Deposit", 6}, NO_COLUMN, NO_COLUMN, NO_COLUMN
+        , (const char *)(NULL)
+    }
+    ,{
+        SCHWAB_BROKERAGE_FORMAT, "SchwabBrokerage", "schwabbrok"
+        , "Date,", "Date,Action,Symbol,Description,Quantity,Price"
+        , ROW_DATE_AS_OF | ROW_REWRITE_MM_ACTION, true, true
+        , {"Date", 0}, {"Description", 3}, {"Amount", 7}
+        , NO_COLUMN, NO_COLUMN, {"Symbol", 2}, {"Action", 1}, NO_COLUMN
+        , (const char *)(NULL)
+    }
+};
+
+#define NUM_FORMAT_DESCRIPTORS  (sizeof(formatDescriptors) / sizeof(formatDescriptors[0]))
+
+// Index of a format's descriptor, or -1
+constexpr int formatDescriptorIndex(bankFormat_t bankFormat)
+{
+    for (size_t i = 0; i < NUM_FORMAT_DESCRIPTORS; i++)
+    {
+        if (formatDescriptors[i].bankFormat == bankFormat) return (int)i;
+    }
+    return -1;
+}
+
+#endif
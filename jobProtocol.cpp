@@ -0,0 +1,55 @@
+#include <errno.h>
+#include <unistd.h>
+#include "jobProtocol.h"
+
+bool readFull(int fd, void *buf, size_t n)
+{
+    char *p = (char *)buf;
+
+    while (n)
+    {
+        ssize_t r = ::read(fd, p, n);
+        if (r < 0)
+        {
+            if (EINTR == errno) continue;
+            return false;
+        }
+        if (0 == r) return false;
+        p += r;
+        n -= r;
+    }
+    return true;
+}
+
+bool writeFull(int fd, const void *buf, size_t n)
+{
+    const char *p = (const char *)buf;
+
+    while (n)
+    {
+        ssize_t w = ::write(fd, p, n);
+        if (w < 0)
+        {
+            if (EINTR == errno) continue;
+            return false;
+        }
+        p += w;
+        n -= w;
+    }
+    return true;
+}
+
+const char *jobStatus2string(int status)
+{
+    switch (status)
+    {
+        case 0:     return "OK";
+        case -2:    return "Bad request";
+        case -4:    return "Error opening input file";
+        case -5:    return "Error opening output file";
+        case -6:    return "Unknown Bank Format";
+        case -7:    return "Error writing output file";
+        case -10:   return "Error reading input file";
+        default:    return "Conversion failed";
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef __JOBPROTOCOL_H__
+#define __JOBPROTOCOL_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "bankFormat.h"
+
+// The conversion server's protocol (csv2qifBLS --serve), over a local
+// (AF_UNIX stream) socket.  Both ends are on the one machine, so the
+// numbers are in its own byte order.
+//
+// A client sends a job: a jobRequest_t, then inputLen bytes of input,
+// then outputLen bytes of output file name.  The input is the name of
+// a CSV file the server can read, or with JOB_INLINE_CSV the CSV
+// itself.  With an output file name the server writes the QIF there;
+// without one the QIF comes back in the reply.
+//
+// The server answers each job with a jobReply_t, then qifLen bytes of
+// QIF.  A connection can carry any number of jobs, one after the
+// other; the server closes it if a request is not one, or if the
+// client leaves it idle or stops part way through a request (see
+// jobServer.h).
+
+#define JOB_REQUEST_MAGIC   "C2QJ"
+#define JOB_REPLY_MAGIC     "C2QR"
+#define JOB_VERSION         1
+
+// jobRequest_t flags
+#define JOB_INLINE_CSV      0x1     // The input is the CSV, not a file name
+
+// Largest input and output name a server takes
+#define JOB_MAX_INPUT       (256u * 1024 * 1024)
+#define JOB_MAX_NAME        4096u
+
+typedef struct
+{
+    char        magic[4];           // JOB_REQUEST_MAGIC
+    uint32_t    version;            // JOB_VERSION
+    uint32_t    bankFormat;         // UNKNOWN_BANK_FORMAT: found from the header line
+    uint32_t    flags;
+    uint32_t    inputLen;
+    uint32_t    outputLen;          // 0: return the QIF
+}   jobRequest_t;
+
+typedef struct
+{
+    char        magic[4];           // JOB_REPLY_MAGIC
+    int32_t     status;             // 0, or the csv2qifBLS return code
+    uint32_t    numTransactions;
+    uint32_t    reserved;
+    uint64_t    bytesIn;
+    uint64_t    qifLen;             // Bytes of QIF following
+}   jobReply_t;
+
+// Read or write exactly n bytes, retrying short transfers and
+// interrupts.  Return false on an error or end of file.
+bool readFull(int fd, void *buf, size_t n);
+bool writeFull(int fd, const void *buf, size_t n);
+
+// The message for a status, "OK" for 0
+const char *jobStatus2string(int status);
+
+#endif
@@ -0,0 +1,532 @@
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include "jobServer.h"
+#include "jobProtocol.h"
+#include "qifConverter.h"
+#include "qifWriter.h"
+#include "csvInput.h"
+#include "stopSignal.h"
+
+typedef std::chrono::steady_clock   serverClock;
+
+// A client connection, and the request being read from it.  The poll
+// loop owns it while it is idle or its request is coming in, and a
+// worker from the time the request is whole until its reply is sent.
+typedef struct
+{
+    int                     fd;
+    bool                    busy;       // Its job is queued or being converted
+    bool                    closing;    // The reply could not be sent
+    serverClock::time_point due;        // Closed if nothing arrives by then
+    jobRequest_t            req;
+    size_t                  got;        // Bytes of the request read so far
+    std::vector<char>       input;
+    std::vector<char>       outName;
+}   serverConn_t;
+
+// What the poll loop and the workers share
+typedef struct
+{
+    std::mutex                  mutex;
+    std::condition_variable     ready;
+    std::deque<serverConn_t *>  jobs;       // Requests read, not yet taken
+    std::vector<serverConn_t *> done;       // Replied to, for the poll loop
+    int                         wakeFd;     // Written to when done grows
+    bool                        stopping;
+
+    int                         verbosity;
+    const MoneyMarketSymbols    *mmSymbols;
+    const CUSIPBankMap          *cusip2bank;
+    const DescriptionRules      *rules;
+    dateFormat_t                dateFormat;
+
+    std::atomic<uint64_t>       numJobs;
+    std::atomic<uint64_t>       numFailed;
+    std::atomic<uint64_t>       numTransactions;
+    std::atomic<uint64_t>       bytesIn;
+}   serverState_t;
+
+// Convert one job.  input has inputLen bytes and room for a null
+// after them.  The QIF goes to outName, or to qif if outName is empty.
+static int runJob(serverState_t &state
+                  , const jobRequest_t &req
+                  , char *input
+                  , const char *outName
+                  , QifBuffer &qif
+                  , convertResult_t *result
+                 )
+{
+    CsvInput        csvIn;
+    QifWriter       qifOut;
+    bankFormat_t    bankFormat = (bankFormat_t)req.bankFormat;
+    bool            opened;
+    int             ret;
+
+    result->numTransactions = 0;
+    result->bytesIn = 0;
+    result->seconds = 0.0;
+
+    if (req.flags & JOB_INLINE_CSV)
+    {
+        opened = csvIn.open(input, req.inputLen);
+    }
+    else
+    {
+        input[req.inputLen] = '\0';
+        opened = csvIn.open((const char *)input);
+    }
+    if (false == opened) return -4;
+
+    if (UNKNOWN_BANK_FORMAT == bankFormat)
+    {
+        const char  *head;
+        size_t      headLen;
+
+        csvIn.peek(&head, &headLen, SNIFF_SIZE);
+        bankFormat = sniffBankFormat(head, headLen);
+    }
+
+    QifConverter converter(bankFormat, 1, *state.mmSymbols, *state.cusip2bank);
+
+    if ((const formatDescriptor_t *)(NULL) == converter.getFormat()) return -6;
+    converter.useRules(state.rules);
+    converter.useDateFormat(state.dateFormat);
+
+    if (outName[0])
+    {
+        if (false == qifOut.open(outName)) return -5;
+    }
+    else
+    {
+        qifOut.attach(&qif);
+    }
+
+    ret = convertStream(converter, csvIn, qifOut, 1, (FILE *)(NULL), result);
+    csvIn.close();
+    if ((false == qifOut.close()) && (0 == ret)) ret = -7;
+    return ret;
+}
+
+// Read what has come in of conn's request, without waiting for more.
+// Returns 1 once the request is whole, 0 if more is to come, or -1 if
+// the connection is to be closed: the client hung up, or sent
+// something that is not a request (which is answered first).
+static int readRequest(serverConn_t &conn)
+{
+    size_t headLen = sizeof(conn.req);
+
+    while (true)
+    {
+        size_t  at = conn.got;
+        char    *p;
+        size_t  want;
+
+        if (at < headLen)
+        {
+            p = (char *)&conn.req + at;
+            want = headLen - at;
+        }
+        else if ((at -= headLen) < conn.req.inputLen)
+        {
+            p = conn.input.data() + at;
+            want = conn.req.inputLen - at;
+        }
+        else
+        {
+            at -= conn.req.inputLen;
+            p = conn.outName.data() + at;
+            want = conn.req.outputLen - at;
+        }
+
+        ssize_t r = recv(conn.fd, p, want, MSG_DONTWAIT);
+        if (r < 0)
+        {
+            if (EINTR == errno) continue;
+            return ((EAGAIN == errno) || (EWOULDBLOCK == errno)) ? 0 : -1;
+        }
+        if (0 == r) return -1;
+        conn.got += r;
+
+        if (conn.got == headLen)
+        {
+            const jobRequest_t &req = conn.req;
+
+            if  (   (memcmp(req.magic, JOB_REQUEST_MAGIC, sizeof(req.magic)) != 0)
+                 || (JOB_VERSION != req.version)
+                 || (req.inputLen > JOB_MAX_INPUT)
+                 || (req.outputLen > JOB_MAX_NAME)
+                )
+            {
+                jobReply_t reply;
+
+                memset(&reply, 0, sizeof(reply));
+                memcpy(reply.magic, JOB_REPLY_MAGIC, sizeof(reply.magic));
+                reply.status = -2;
+                writeFull(conn.fd, &reply, sizeof(reply));
+                return -1;
+            }
+
+            // Room for the nulls that end the names
+            conn.input.resize(req.inputLen + 1);
+            conn.outName.resize(req.outputLen + 1);
+        }
+        if (conn.got >= headLen + conn.req.inputLen + conn.req.outputLen) break;
+    }
+
+    conn.outName[conn.req.outputLen] = '\0';
+    return 1;
+}
+
+// Convert the job read from conn and send its reply
+static void serveJob(serverState_t &state, serverConn_t &conn)
+{
+    const jobRequest_t  &req = conn.req;
+    QifBuffer           qif;
+    jobReply_t          reply;
+    convertResult_t     result;
+    auto                start = serverClock::now();
+
+    memset(&reply, 0, sizeof(reply));
+    memcpy(reply.magic, JOB_REPLY_MAGIC, sizeof(reply.magic));
+
+    reply.status = runJob(state, req, conn.input.data(), conn.outName.data(), qif, &result);
+    reply.numTransactions = result.numTransactions;
+    reply.bytesIn = result.bytesIn;
+    reply.qifLen = (0 == reply.status) ? qif.size() : 0;
+
+    ++state.numJobs;
+    if (reply.status) ++state.numFailed;
+    state.numTransactions += result.numTransactions;
+    state.bytesIn += result.bytesIn;
+
+    if (state.verbosity >= 2)
+    {
+        double ms = std::chrono::duration<double, std::milli>(serverClock::now() - start).count();
+
+        printf("%-40s: %s, %d transactions, %.1f KB, %.1f ms\n"
+               , (req.flags & JOB_INLINE_CSV) ? "(inline)" : conn.input.data()
+               , jobStatus2string(reply.status)
+               , result.numTransactions
+               , result.bytesIn / 1024.0
+               , ms
+              );
+    }
+
+    if  (   (false == writeFull(conn.fd, &reply, sizeof(reply)))
+         || (false == writeFull(conn.fd, qif.data(), reply.qifLen))
+        )
+    {
+        conn.closing = true;
+    }
+
+    // Don't hold on to a large job's input while the client is idle
+    std::vector<char>().swap(conn.input);
+}
+
+static void worker(serverState_t &state)
+{
+    while (true)
+    {
+        serverConn_t *conn;
+
+        {
+            std::unique_lock<std::mutex> lock(state.mutex);
+
+            state.ready.wait(lock, [&]() { return state.stopping || state.jobs.size(); });
+            if (state.stopping) break;
+            conn = state.jobs.front();
+            state.jobs.pop_front();
+        }
+
+        serveJob(state, *conn);
+
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            char                        c = 0;
+            ssize_t                     n = ::write(state.wakeFd, &c, 1);
+
+            (void)n;
+            state.done.push_back(conn);
+        }
+    }
+}
+
+// Listen at socketPath.  A socket file left by a server that is gone
+// is replaced; one that a server still answers on is not.
+static int listenAt(const char *socketPath)
+{
+    struct sockaddr_un  addr;
+    struct stat         st;
+    int                 fd;
+
+    if (strlen(socketPath) >= sizeof(addr.sun_path))
+    {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socketPath);
+
+    if ((stat(socketPath, &st) == 0) && S_ISSOCK(st.st_mode))
+    {
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return -1;
+        bool answered = (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+        ::close(fd);
+        if (answered)
+        {
+            errno = EADDRINUSE;
+            return -1;
+        }
+        unlink(socketPath);
+    }
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+
+    if  (   (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+         || (listen(fd, SOMAXCONN) != 0)
+        )
+    {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int serverRun(const char *socketPath
+              , int numWorkers
+              , int verbosity
+              , const MoneyMarketSymbols &mmSymbols
+              , const CUSIPBankMap &cusip2bank
+              , const DescriptionRules &rules
+              , dateFormat_t dateFormat
+             )
+{
+    serverState_t                               state;
+    std::vector<std::thread>                    workers;
+    std::vector<std::unique_ptr<serverConn_t>>  conns;
+    std::vector<struct pollfd>                  fds;
+    std::vector<serverConn_t *>                 polled;
+    auto                                        start = serverClock::now();
+    int                                         listenFd;
+    int                                         stopFd;
+    int                                         wakePipe[2];
+
+    if (numWorkers < 1) numWorkers = 1;
+
+    state.stopping = false;
+    state.verbosity = verbosity;
+    state.mmSymbols = &mmSymbols;
+    state.cusip2bank = &cusip2bank;
+    state.rules = &rules;
+    state.dateFormat = dateFormat;
+    state.numJobs = 0;
+    state.numFailed = 0;
+    state.numTransactions = 0;
+    state.bytesIn = 0;
+
+    listenFd = listenAt(socketPath);
+    if (listenFd < 0)
+    {
+        fprintf(stderr, "%s: Error opening socket: %s\n", socketPath, strerror(errno));
+        return -13;
+    }
+    if (pipe2(wakePipe, O_CLOEXEC | O_NONBLOCK) != 0)
+    {
+        fprintf(stderr, "%s: Error opening socket: %s\n", socketPath, strerror(errno));
+        ::close(listenFd);
+        unlink(socketPath);
+        return -13;
+    }
+    state.wakeFd = wakePipe[1];
+    stopFd = stopSignalCatch();
+    if (stopFd < 0)
+    {
+        ::close(wakePipe[0]);
+        ::close(wakePipe[1]);
+        ::close(listenFd);
+        unlink(socketPath);
+        return -13;
+    }
+
+    for (int i = 0; i < numWorkers; i++)
+    {
+        workers.emplace_back(worker, std::ref(state));
+    }
+
+    if (verbosity >= 1)
+    {
+        printf("Serving on %s with %d worker%s\n", socketPath, numWorkers, (1 == numWorkers) ? "" : "s");
+        fflush(stdout);
+    }
+
+    auto closeConn = [&](size_t i)
+    {
+        ::close(conns[i]->fd);
+        conns[i] = std::move(conns.back());
+        conns.pop_back();
+    };
+
+    // Poll the listening socket, and every connection that is not
+    // waiting on a job, for a request to read.  A connection with a
+    // request whole is handed to the workers, and polled again once
+    // they have replied.
+    while (true)
+    {
+        int     timeout = -1;
+        auto    now = serverClock::now();
+
+        fds.clear();
+        polled.clear();
+        fds.push_back({listenFd, POLLIN, 0});
+        fds.push_back({stopFd, POLLIN, 0});
+        fds.push_back({wakePipe[0], POLLIN, 0});
+        for (auto &conn : conns)
+        {
+            if (conn->busy) continue;
+
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(conn->due - now).count() + 1;
+            if (ms < 0) ms = 0;
+            if ((timeout < 0) || (ms < timeout)) timeout = (int)ms;
+
+            fds.push_back({conn->fd, POLLIN, 0});
+            polled.push_back(conn.get());
+        }
+
+        if (poll(fds.data(), fds.size(), timeout) < 0)
+        {
+            if (EINTR == errno) continue;
+            break;
+        }
+        if (fds[1].revents) break;
+        now = serverClock::now();
+
+        // Read a request from each connection it has come in on
+        for (size_t i = 0; i < polled.size(); i++)
+        {
+            serverConn_t *conn = polled[i];
+
+            if (0 == fds[i + 3].revents) continue;
+
+            size_t  got = conn->got;
+            int     r = readRequest(*conn);
+
+            if (r < 0)
+            {
+                conn->closing = true;
+                continue;
+            }
+            if (conn->got != got) conn->due = now + std::chrono::milliseconds(JOB_READ_TIMEOUT_MS);
+            if (r > 0)
+            {
+                std::lock_guard<std::mutex> lock(state.mutex);
+
+                conn->busy = true;
+                state.jobs.push_back(conn);
+                state.ready.notify_one();
+            }
+        }
+
+        // Take back the connections replied to
+        if (fds[2].revents & POLLIN)
+        {
+            char buf[256];
+
+            while (read(wakePipe[0], buf, sizeof(buf)) > 0) {}
+
+            std::lock_guard<std::mutex> lock(state.mutex);
+
+            for (serverConn_t *conn : state.done)
+            {
+                conn->busy = false;
+                conn->got = 0;
+                conn->due = now + std::chrono::milliseconds(JOB_IDLE_TIMEOUT_MS);
+            }
+            state.done.clear();
+        }
+
+        // Close connections that hung up, failed, or have been idle, or
+        // stalled in the middle of a request, for too long
+        for (size_t i = conns.size(); i-- > 0; )
+        {
+            const serverConn_t *conn = conns[i].get();
+
+            if ((false == conn->busy) && (conn->closing || (conn->due <= now))) closeConn(i);
+        }
+
+        if (fds[0].revents & POLLIN)
+        {
+            int fd = accept4(listenFd, (struct sockaddr *)(NULL), (socklen_t *)(NULL), SOCK_CLOEXEC);
+            if (fd < 0) continue;
+
+            // A client that does not take its reply can not hold a
+            // worker for longer than a stalled request holds the loop
+            struct timeval sendTimeout = {JOB_READ_TIMEOUT_MS / 1000, (JOB_READ_TIMEOUT_MS % 1000) * 1000};
+            setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &sendTimeout, sizeof(sendTimeout));
+
+            std::unique_ptr<serverConn_t> conn(new serverConn_t);
+            conn->fd = fd;
+            conn->busy = false;
+            conn->closing = false;
+            conn->due = now + std::chrono::milliseconds(JOB_IDLE_TIMEOUT_MS);
+            conn->got = 0;
+            conns.push_back(std::move(conn));
+        }
+    }
+
+    // Stop taking jobs.  Jobs not yet taken by a worker are dropped;
+    // the ones being converted finish and get their reply.
+    ::close(listenFd);
+    unlink(socketPath);
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+
+        state.stopping = true;
+        state.jobs.clear();
+        state.ready.notify_all();
+    }
+    for (auto &w : workers)
+    {
+        w.join();
+    }
+    while (conns.size())
+    {
+        closeConn(conns.size() - 1);
+    }
+    ::close(wakePipe[0]);
+    ::close(wakePipe[1]);
+
+    stopSignalRelease();
+
+    if (verbosity >= 1)
+    {
+        double seconds = std::chrono::duration<double>(serverClock::now() - start).count();
+
+        printf("Number of Jobs        : %" PRIu64 " (%" PRIu64 " failed)\n"
+               , state.numJobs.load(), state.numFailed.load());
+        printf("Number of Transactions: %" PRIu64 "\n", state.numTransactions.load());
+        printf("Input                 : %.1f MB\n", state.bytesIn / (1024.0 * 1024.0));
+        printf("Elapsed Time          : %.3f s\n", seconds);
+    }
+    return 0;
+}
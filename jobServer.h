@@ -0,0 +1,43 @@
+#ifndef __JOBSERVER_H__
+#define __JOBSERVER_H__
+
+#include "mmSymbols.h"
+#include "cusipBankMap.h"
+#include "descRules.h"
+#include "dateParse.h"
+
+#define JOB_IDLE_TIMEOUT_MS     60000
+#define JOB_READ_TIMEOUT_MS     10000
+
+// A resident conversion server (csv2qifBLS --serve).
+//
+// The lookup tables and description rules are loaded once, by the
+// caller, and shared by every job, so a job costs only its conversion:
+// no process start, no reference database or rules file to read.  Jobs
+// come in over a local socket at socketPath (see jobProtocol.h).  One
+// thread polls every connection and reads each request as it arrives;
+// a request that is whole is queued as a job for numWorkers threads,
+// which take the jobs one at a time, from whichever connection.  A
+// connection's jobs are converted in order, one at a time, but a client
+// that is slow or idle holds no worker.  Inline CSV is converted from
+// the request's memory, and QIF to be returned is built in memory, so
+// neither touches a file.
+//
+// A connection is closed once it has been idle, between requests, for
+// JOB_IDLE_TIMEOUT_MS, or a request or reply has stalled, part way, for
+// JOB_READ_TIMEOUT_MS.
+//
+// Runs until SIGINT or SIGTERM, then lets the jobs being converted
+// finish, removes the socket and returns 0.  Returns -13 if the socket
+// can not be set up.  Prints each job when verbosity >= 2, and a
+// summary when verbosity >= 1.
+int serverRun(const char *socketPath
+              , int numWorkers
+              , int verbosity
+              , const MoneyMarketSymbols &mmSymbols
+              , const CUSIPBankMap &cusip2bank
+              , const DescriptionRules &rules
+              , dateFormat_t dateFormat
+             );
+
+#endif
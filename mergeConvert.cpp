@@ -0,0 +1,442 @@
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include "mergeConvert.h"
+#include "qifConverter.h"
+#include "qifWriter.h"
+#include "csvInput.h"
+#include "transaction.h"
+
+// Rows of an oldest first file are parsed this many at a time as they
+// are merged
+#define MERGE_READ_ROWS     1024
+
+// One input file, in date order.  A newest first file is parsed whole
+// and reversed; an oldest first one is read as it is merged, batch
+// holding the rows read so far that are not merged yet.
+typedef struct
+{
+    int                                 ret;
+    bankFormat_t                        bankFormat;
+    std::unique_ptr<QifConverter>       converter;
+    std::unique_ptr<TransactionBatch>   batch;
+    std::unique_ptr<CsvInput>           csvIn;      // Oldest first, while it is being read
+    size_t                              numTransactions;
+    size_t                              bytesIn;
+    double                              seconds;
+}   mergeRun_t;
+
+// The files of one account
+typedef struct
+{
+    std::string             name;
+    std::vector<size_t>     runs;       // In file order
+    std::string             outFileName;
+    int                     ret;
+    long                    numTransactions;
+}   mergeAccount_t;
+
+// Where the merge is in one run: its next transaction
+typedef struct
+{
+    int32_t     date;
+    size_t      run;
+    size_t      pos;
+}   mergeCursor_t;
+
+// The account of a file: from the file list, or the file's name
+// without directory and extension
+static std::string accountName(const batchItem_t &item)
+{
+    if (false == item.account.empty()) return item.account;
+
+    std::string name = item.inFileName;
+    size_t slash = name.rfind('/');
+    if (std::string::npos != slash) name.erase(0, slash + 1);
+
+    size_t len = name.size();
+    if ((len > 3) && (strcasecmp(name.c_str() + len - 3, ".gz") == 0)) name.resize(len - 3);
+    else if ((len > 4) && (strcasecmp(name.c_str() + len - 4, ".zst") == 0)) name.resize(len - 4);
+
+    size_t dot = name.rfind('.');
+    if ((std::string::npos != dot) && (dot > 0)) name.resize(dot);
+    return name;
+}
+
+static bool earlier(const transaction_t &a, const transaction_t &b)
+{
+    return a.date < b.date;
+}
+
+// Find the format of one file and make its converter.  A newest first
+// file is parsed, oldest transaction first; an oldest first file is
+// left to openRun().
+static void parseRun(const batchItem_t &item
+                     , mergeRun_t &run
+                     , const MoneyMarketSymbols &mmSymbols
+                     , const CUSIPBankMap &cusip2bank
+                     , const DescriptionRules &rules
+                     , dateFormat_t dateFormat
+                    )
+{
+    auto            start = std::chrono::steady_clock::now();
+    CsvInput        csvIn;
+    char            *line;
+    size_t          lineLen;
+
+    run.numTransactions = 0;
+    run.bytesIn = 0;
+    run.seconds = 0.0;
+    run.bankFormat = item.bankFormat;
+    if (UNKNOWN_BANK_FORMAT == run.bankFormat)
+    {
+        run.bankFormat = batchFormatForFile(item.inFileName);
+    }
+    if (UNKNOWN_BANK_FORMAT == run.bankFormat)
+    {
+        run.ret = -6;
+        return;
+    }
+
+    // Verbosity 1: the verbose listing is not printed when merging
+    run.converter.reset(new QifConverter(run.bankFormat, 1, mmSymbols, cusip2bank));
+    run.converter->useRules(&rules);
+    run.converter->useDateFormat(dateFormat);
+    run.batch.reset(new TransactionBatch());
+    run.ret = 0;
+    if (false == run.converter->getFormat()->newestFirst) return;
+
+    if (false == csvIn.open(item.inFileName.c_str()))
+    {
+        run.ret = -4;
+        return;
+    }
+    findColumnHeader(*run.converter, csvIn);
+    while (csvIn.nextLine(&line, &lineLen))
+    {
+        run.converter->parseLine(line, lineLen, *run.batch);
+    }
+    run.bytesIn = csvIn.bytesRead();
+    run.ret = csvIn.failed() ? -10 : 0;
+    csvIn.close();
+
+    // Newest first exports are reversed.  Anything still out of order
+    // is sorted, rows of one day staying in the order they were.
+    std::vector<transaction_t> &t = run.batch->transactions();
+    std::reverse(t.begin(), t.end());
+    if (false == std::is_sorted(t.begin(), t.end(), earlier))
+    {
+        std::stable_sort(t.begin(), t.end(), earlier);
+    }
+    run.numTransactions = t.size();
+
+    run.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Open an oldest first file to be read as it is merged
+static void openRun(const batchItem_t &item, mergeRun_t &run)
+{
+    if ((0 != run.ret) || run.converter->getFormat()->newestFirst) return;
+
+    run.csvIn.reset(new CsvInput());
+    if (false == run.csvIn->open(item.inFileName.c_str()))
+    {
+        run.csvIn.reset();
+        run.ret = -4;
+        return;
+    }
+    findColumnHeader(*run.converter, *run.csvIn);
+}
+
+// Make transaction pos of run's batch the run's next one, reading more
+// of an oldest first file if pos is past the rows read.  Returns false
+// once the run has no more.
+static bool nextTransaction(mergeRun_t &run, size_t &pos)
+{
+    char    *line;
+    size_t  lineLen;
+
+    if (pos < run.batch->size()) return true;
+    if ((CsvInput *)(NULL) == run.csvIn.get()) return false;
+
+    auto start = std::chrono::steady_clock::now();
+    bool more = true;
+
+    // The rows before pos have been written, so the batch starts again
+    run.batch->clear();
+    pos = 0;
+    while ((run.batch->size() < MERGE_READ_ROWS) && (more = run.csvIn->nextLine(&line, &lineLen)))
+    {
+        run.converter->parseLine(line, lineLen, *run.batch);
+    }
+    run.numTransactions += run.batch->size();
+    if (false == more)
+    {
+        run.bytesIn = run.csvIn->bytesRead();
+        if (run.csvIn->failed()) run.ret = -10;
+        run.csvIn.reset();
+    }
+    run.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return (run.batch->size() > 0);
+}
+
+// Write the transactions of an account's runs to qifOut in date order.
+// Of transactions on the same day, the earlier file's go first.
+static long mergeAccount(const mergeAccount_t &account
+                         , const std::vector<batchItem_t> &items
+                         , std::vector<mergeRun_t> &runs
+                         , QifWriter &qifOut
+                        )
+{
+    std::vector<mergeCursor_t>  heap;
+    QifOutput                   out;
+
+    // A min-heap on date, then file
+    auto after = [](const mergeCursor_t &a, const mergeCursor_t &b)
+    {
+        return (a.date != b.date) ? (a.date > b.date) : (a.run > b.run);
+    };
+
+    for (size_t r : account.runs)
+    {
+        size_t pos = 0;
+
+        openRun(items[r], runs[r]);
+        if ((0 == runs[r].ret) && nextTransaction(runs[r], pos))
+        {
+            heap.push_back({(*runs[r].batch)[pos].date, r, pos});
+        }
+    }
+    std::make_heap(heap.begin(), heap.end(), after);
+
+    while (heap.size())
+    {
+        std::pop_heap(heap.begin(), heap.end(), after);
+        mergeCursor_t   &c = heap.back();
+        mergeRun_t      &run = runs[c.run];
+
+        run.converter->writeTransaction(*run.batch, (*run.batch)[c.pos], out);
+        if (nextTransaction(run, ++c.pos))
+        {
+            c.date = (*run.batch)[c.pos].date;
+            std::push_heap(heap.begin(), heap.end(), after);
+        }
+        else
+        {
+            heap.pop_back();
+        }
+
+        if (out.qif.size() >= QIF_WRITE_SIZE)
+        {
+            qifOut.write(out.qif);
+            out.qif.clear();
+        }
+    }
+    qifOut.write(out.qif);
+
+    return out.numTransactions;
+}
+
+int mergeConvert(const std::vector<batchItem_t> &items
+                 , int numJobs
+                 , int verbosity
+                 , const char *mergedFileName
+                 , const char *accountDir
+                 , const MoneyMarketSymbols &mmSymbols
+                 , const CUSIPBankMap &cusip2bank
+                 , const DescriptionRules &rules
+                 , dateFormat_t dateFormat
+                )
+{
+    std::vector<mergeRun_t>     runs(items.size());
+    std::vector<mergeAccount_t> accounts;
+    std::vector<std::thread>    workers;
+    std::atomic<size_t>         next(0);
+    auto                        start = std::chrono::steady_clock::now();
+    int                         ret = 0;
+
+    if (numJobs < 1) numJobs = 1;
+
+    // Parse the files
+    int numThreads = ((size_t)numJobs > items.size()) ? (int)items.size() : numJobs;
+    for (int i = 0; i < numThreads; i++)
+    {
+        workers.emplace_back([&]()
+        {
+            size_t n;
+            while ((n = next++) < items.size())
+            {
+                parseRun(items[n], runs[n], mmSymbols, cusip2bank, rules, dateFormat);
+            }
+        });
+    }
+    for (auto &w : workers)
+    {
+        w.join();
+    }
+    workers.clear();
+
+    // Group them by account
+    for (size_t n = 0; n < items.size(); n++)
+    {
+        std::string name = accountName(items[n]);
+        size_t a;
+
+        for (a = 0; a < accounts.size(); a++)
+        {
+            if (accounts[a].name == name) break;
+        }
+        if (a == accounts.size())
+        {
+            accounts.push_back({name, {}, "", 0, 0});
+        }
+        accounts[a].runs.push_back(n);
+    }
+
+    if (mergedFileName)
+    {
+        QifWriter qifOut;
+
+        if (false == qifOut.open(mergedFileName))
+        {
+            fprintf(stderr, "%s: Error opening output file\n", mergedFileName);
+            return -5;
+        }
+
+        qifOut.write("!Option:AutoSwitch\n", 19);
+        for (mergeAccount_t &account : accounts)
+        {
+            std::string header = "!Account\nN" + account.name + "\nTBank\n^\n!Type:Bank\n";
+
+            qifOut.write(header.data(), header.size());
+            account.numTransactions = mergeAccount(account, items, runs, qifOut);
+            account.outFileName = mergedFileName;
+        }
+        if (false == qifOut.close())
+        {
+            fprintf(stderr, "%s: Error writing output file\n", mergedFileName);
+            return -7;
+        }
+    }
+    else
+    {
+        // An account to each worker, each to its own file
+        next = 0;
+        numThreads = ((size_t)numJobs > accounts.size()) ? (int)accounts.size() : numJobs;
+        for (int i = 0; i < numThreads; i++)
+        {
+            workers.emplace_back([&]()
+            {
+                size_t n;
+                while ((n = next++) < accounts.size())
+                {
+                    mergeAccount_t  &account = accounts[n];
+                    QifWriter       qifOut;
+                    std::string     fileName = account.name;
+
+                    std::replace(fileName.begin(), fileName.end(), '/', '_');
+                    account.outFileName = std::string(accountDir) + "/" + fileName + ".qif";
+                    if (false == qifOut.open(account.outFileName.c_str()))
+                    {
+                        account.ret = -5;
+                        continue;
+                    }
+                    qifOut.write("!Type:Bank\n", 11);
+                    account.numTransactions = mergeAccount(account, items, runs, qifOut);
+                    if (false == qifOut.close()) account.ret = -7;
+                }
+            });
+        }
+        for (auto &w : workers)
+        {
+            w.join();
+        }
+    }
+
+    double  seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    long    totalTransactions = 0;
+    size_t  totalBytes = 0;
+    int     numFailed = 0;
+
+    for (size_t n = 0; n < items.size(); n++)
+    {
+        const mergeRun_t &r = runs[n];
+        const char *msg = (const char *)(NULL);
+
+        switch (r.ret)
+        {
+            case 0:                                                 break;
+            case -4:    msg = "Error opening input file";           break;
+            case -6:    msg = "Unknown Bank Format";                break;
+            case -10:   msg = "Error reading input file";           break;
+            default:    msg = "Conversion failed";                  break;
+        }
+
+        if (msg)
+        {
+            // Left out of its account, or cut short if it was read
+            // while merging
+            fprintf(stderr, "%s: %s\n", items[n].inFileName.c_str(), msg);
+            ++numFailed;
+            ret = -8;
+            continue;
+        }
+
+        totalBytes += r.bytesIn;
+        if (verbosity >= 1)
+        {
+            printf("%-40s -> %s: %zu transactions, %.1f KB, %.1f ms\n"
+                   , items[n].inFileName.c_str()
+                   , accountName(items[n]).c_str()
+                   , r.numTransactions
+                   , r.bytesIn / 1024.0
+                   , r.seconds * 1000.0
+                  );
+        }
+    }
+
+    for (const mergeAccount_t &account : accounts)
+    {
+        if (account.ret)
+        {
+            fprintf(stderr, "%s: %s\n", account.outFileName.c_str()
+                    , (-5 == account.ret) ? "Error opening output file" : "Error writing output file");
+            if (0 == ret) ret = account.ret;
+            continue;
+        }
+        totalTransactions += account.numTransactions;
+        if (verbosity >= 1)
+        {
+            printf("Account %-32s -> %s: %ld transactions from %zu file%s\n"
+                   , account.name.c_str()
+                   , account.outFileName.c_str()
+                   , account.numTransactions
+                   , account.runs.size()
+                   , (1 == account.runs.size()) ? "" : "s"
+                  );
+        }
+    }
+
+    if (verbosity >= 1)
+    {
+        printf("Number of Files       : %zu (%d failed)\n", items.size(), numFailed);
+        printf("Number of Accounts    : %zu\n", accounts.size());
+        printf("Number of Transactions: %ld\n", totalTransactions);
+        printf("Elapsed Time          : %.3f s\n", seconds);
+        if (seconds > 0.0)
+        {
+            printf("Throughput            : %.0f transactions/s, %.2f MB/s\n"
+                   , totalTransactions / seconds
+                   , totalBytes / (1024.0 * 1024.0) / seconds
+                  );
+        }
+    }
+
+    return ret;
+}
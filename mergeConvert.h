@@ -0,0 +1,48 @@
+#ifndef __MERGECONVERT_H__
+#define __MERGECONVERT_H__
+
+#include <vector>
+#include "batchConvert.h"
+#include "mmSymbols.h"
+#include "cusipBankMap.h"
+#include "descRules.h"
+#include "dateParse.h"
+
+// A consolidated run: the files of a batch are accounts (or pieces of
+// accounts), and come out merged by account and sorted by date.
+//
+// Transactions carry their date as a yyyymmdd integer.  Newest first
+// exports are parsed numJobs at a time, each into a TransactionBatch,
+// and reversed (a file that is still out of order is sorted, keeping
+// rows of the same day in file order).  Oldest first exports are not
+// parsed ahead: each is read, a block of rows at a time, as it is
+// merged, so only newest first files are held in memory whole.  A row
+// of an oldest first file that is out of date order is written where
+// the file has it.  The files of one account are merged a transaction
+// at a time, k-way, and the QIF written as it is merged, so no
+// account's transactions are gathered and sorted as one.
+//
+// A file's account is the one in the file list, or else its name
+// without directory and extension.  Accounts are written in the order
+// they first appear.
+//
+// With mergedFileName, all accounts go to that one QIF, an !Account
+// block for each.  With accountDir, each account goes to its own
+// accountDir/<account>.qif, numJobs accounts at a time.  Dates are
+// written in dateFormat.  Prints a per file and total report when
+// verbosity >= 1.  Returns 0 if everything converted, -5 if an output
+// file can not be opened, -7 if writing failed, -8 if an input file
+// failed (one that fails part way through being merged leaves its
+// account with the rows before).
+int mergeConvert(const std::vector<batchItem_t> &items
+                 , int numJobs
+                 , int verbosity
+                 , const char *mergedFileName
+                 , const char *accountDir
+                 , const MoneyMarketSymbols &mmSymbols
+                 , const CUSIPBankMap &cusip2bank
+                 , const DescriptionRules &rules
+                 , dateFormat_t dateFormat
+                );
+
+#endif
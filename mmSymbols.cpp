@@ -1,13 +1,36 @@
 #include "mmSymbols.h"
+#include "perfectHash.h"
 
-bool MoneyMarketSymbols::contains(const std::string& symbol) const {
-    return symbols.find(symbol) != symbols.end();
-}
+#define SYMBOL_LEN  5
+
+typedef struct
+{
+    std::string_view    key;        // Symbol
+}   mmSymbol_t;
 
-bool MoneyMarketSymbols::contains(const char* symbol) const {
-    return symbols.find(symbol) != symbols.end();
+static constexpr mmSymbol_t symbols[] = {
+    {"FDLXX"}, {"SPAXX"}, {"FDRXX"}, {"SPRXX"}, {"FZFXX"}, {"SNSXX"}, {"SNVXX"}
+};
+
+static constexpr bool allSymbolLength()
+{
+    for (const mmSymbol_t &e : symbols) {
+        if (e.key.size() != SYMBOL_LEN) return false;
+    }
+    return true;
 }
+static_assert(allSymbolLength(), "Every symbol is 5 characters");
+
+static constexpr auto symbolTable = buildPerfectHash<4, 16>(symbols);
 
-// Usage:
-// MoneyMarketSymbols mmSymbols;
-// bool found = mmSymbols.contains("VUSXX");
\ No newline at end of file
+const char *MoneyMarketSymbols::lookup(std::string_view symbol) const {
+    if (refDb) return refDb->lookupSymbol(symbol);
+
+    if (symbol.size() != SYMBOL_LEN) return nullptr;
+
+    int i = symbolTable.find(symbol);
+    if ((i >= 0) && (symbols[i].key == symbol)) {
+        return symbols[i].key.data();
+    }
+    return nullptr;
+}
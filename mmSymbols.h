@@ -1,25 +1,30 @@
 #ifndef __MMSYMBOLS_H__
 #define __MMSYMBOLS_H__
 
-#include <unordered_set>
-#include <string>
+#include <string_view>
+#include "refDb.h"
 
+// Money market fund symbols.  The default table is built into the
+// program (see mmSymbols.cpp), so there is nothing to construct at
+// startup.  A reference database with symbols replaces it.
 class MoneyMarketSymbols {
 private:
-    std::unordered_set<std::string> symbols;
-    
+    const RefDb     *refDb;
+
 public:
-  MoneyMarketSymbols() {
-        // Initialize your symbols
-        symbols = {"FDLXX", "SPAXX", "FDRXX", "SPRXX", "FZFXX", "SNSXX", "SNVXX"};
-    }  
+    MoneyMarketSymbols() : refDb(nullptr) {}
+
+    // Use the symbols in db instead of the built-in table.
+    // Ignored if db has none.  db must stay open.
+    void use(const RefDb *db)   { refDb = (db && db->numSymbols()) ? db : nullptr; }
 
-    bool contains(const std::string& symbol) const;
-    bool contains(const char* symbol) const;
+    // The symbol as it is in the table, or nullptr if it is not
+    // a money market fund
+    const char *lookup(std::string_view symbol) const;
 };
 
 // Usage:
 // MoneyMarketSymbols mmSymbols;
-// bool found = mmSymbols.contains("VUSXX");
+// bool found = (mmSymbols.lookup("VUSXX") != nullptr);
 
-#endif
\ No newline at end of file
+#endif
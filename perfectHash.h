@@ -0,0 +1,135 @@
+#ifndef __PERFECTHASH_H__
+#define __PERFECTHASH_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string_view>
+
+// Perfect hash tables for small, fixed sets of keys, built by the
+// compiler.  Keys are first hashed into buckets.  Each bucket then gets
+// the seed that puts all of its keys into free slots ("hash and
+// displace"), so every key has a slot of its own.  A lookup is two
+// hashes, one slot and one compare.  There is no allocation and nothing
+// to build at startup.
+//
+// The entries are any struct with a std::string_view member named key:
+//
+//   static constexpr entry_t entries[] = {{"ABC", ...}, ...};
+//   static constexpr auto table = buildPerfectHash<16, 64>(entries);
+//   int i = table.find(key);
+//   if ((i >= 0) && (entries[i].key == key)) ...
+
+// FNV-1a with a final mix, so different seeds give unrelated hashes
+constexpr uint32_t perfectHashKey(std::string_view key, uint32_t seed)
+{
+    uint32_t h = 2166136261u ^ (seed * 0x9E3779B9u);
+
+    for (char c : key)
+    {
+        h ^= (uint8_t)c;
+        h *= 16777619u;
+    }
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    return h;
+}
+
+// NUM_BUCKETS buckets of seeds, NUM_SLOTS (a power of two) slots
+template <size_t NUM_BUCKETS, size_t NUM_SLOTS>
+struct PerfectHash
+{
+    uint32_t    seeds[NUM_BUCKETS];
+    uint16_t    slots[NUM_SLOTS];       // Entry index + 1, 0 if empty
+
+    static_assert((NUM_SLOTS & (NUM_SLOTS - 1)) == 0, "NUM_SLOTS must be a power of two");
+
+    // The index of the only entry that can match key, or -1.
+    // The caller still has to compare the key.
+    constexpr int find(std::string_view key) const
+    {
+        uint32_t seed = seeds[perfectHashKey(key, 0) % NUM_BUCKETS];
+        return (int)slots[perfectHashKey(key, seed) & (NUM_SLOTS - 1)] - 1;
+    }
+};
+
+template <size_t NUM_BUCKETS, size_t NUM_SLOTS, typename entry_t, size_t N>
+constexpr PerfectHash<NUM_BUCKETS, NUM_SLOTS> buildPerfectHash(const entry_t (&entries)[N])
+{
+    static_assert(N < NUM_SLOTS, "More keys than slots");
+
+    PerfectHash<NUM_BUCKETS, NUM_SLOTS> table = {};
+    size_t      bucketOf[N] = {};
+    size_t      bucketSize[NUM_BUCKETS] = {};
+    size_t      order[NUM_BUCKETS] = {};
+    bool        used[NUM_SLOTS] = {};
+    size_t      members[N] = {};
+    size_t      memberSlots[N] = {};
+
+    for (size_t i = 0; i < N; i++)
+    {
+        bucketOf[i] = perfectHashKey(entries[i].key, 0) % NUM_BUCKETS;
+        ++bucketSize[bucketOf[i]];
+    }
+
+    // Place the biggest buckets first, while there are the most free slots
+    for (size_t b = 0; b < NUM_BUCKETS; b++) order[b] = b;
+    for (size_t b = 0; b < NUM_BUCKETS; b++)
+    {
+        for (size_t c = b + 1; c < NUM_BUCKETS; c++)
+        {
+            if (bucketSize[order[c]] > bucketSize[order[b]])
+            {
+                size_t t = order[b];
+                order[b] = order[c];
+                order[c] = t;
+            }
+        }
+    }
+
+    for (size_t o = 0; o < NUM_BUCKETS; o++)
+    {
+        size_t b = order[o];
+        size_t n = 0;
+
+        if (0 == bucketSize[b]) break;
+        for (size_t i = 0; i < N; i++)
+        {
+            if (bucketOf[i] == b) members[n++] = i;
+        }
+
+        // Try seeds until every key of the bucket lands on a free slot,
+        // and on a different one from the others.  A set of keys that
+        // can not be placed (duplicate keys) stops the compile when it
+        // runs out of constexpr steps.
+        for (uint32_t seed = 1; ; seed++)
+        {
+            bool fits = true;
+            for (size_t m = 0; (m < n) && fits; m++)
+            {
+                memberSlots[m] = perfectHashKey(entries[members[m]].key, seed) & (NUM_SLOTS - 1);
+                fits = (false == used[memberSlots[m]]);
+                for (size_t k = 0; (k < m) && fits; k++)
+                {
+                    fits = (memberSlots[k] != memberSlots[m]);
+                }
+            }
+            if (fits)
+            {
+                table.seeds[b] = seed;
+                for (size_t m = 0; m < n; m++)
+                {
+                    used[memberSlots[m]] = true;
+                    table.slots[memberSlots[m]] = (uint16_t)(members[m] + 1);
+                }
+                break;
+            }
+        }
+    }
+
+    return table;
+}
+
+#endif
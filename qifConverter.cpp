@@ -0,0 +1,868 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <array>
+#include <utility>
+#include <chrono>
+#include "qifConverter.h"
+#include "csvParse.h"
+#include "csvInput.h"
+#include "stats.h"
+
+// Chunks smaller than this are not worth a thread
+#define MIN_CHUNK_SIZE  (256 * 1024)
+
+// Converted QIF is written out once this much has accumulated
+#define OUTPUT_FLUSH_SIZE   QIF_WRITE_SIZE
+
+// Streamed input is written out in smaller pieces, so QIF comes out
+// of a pipeline while the input is still coming in
+#define STREAM_FLUSH_SIZE   (64 * 1024)
+
+// Remove all quotes from a line.
+// This will remove quotes from within a field
+// so only do this when trying to find the
+// column header line
+static void remove_all_quotes(char *s) {
+    char *dst = s, *src = s;
+    while (*src) {
+        if  (*src != '"')
+        {
+            *dst++ = *src;
+        }
+        src++;
+    }
+    *dst = '\0';
+}
+
+// Rewrite a description with the rule for it, if there is one.  A
+// replacement without a symbol or bank is the rule's own (interned)
+// text; the others are put together in buf (MAX_LINE).
+static void applyRule(const DescriptionRules &rules
+                      , descRuleClass_t ruleClass
+                      , csvField_t *desc
+                      , const csvField_t &symbol
+                      , const char *bankName
+                      , char *buf
+                     )
+{
+    const descRule_t *rule = rules.match(ruleClass, desc->ptr, desc->len);
+
+    if ((const descRule_t *)(NULL) == rule) return;
+
+    if (DESC_INSERT_NONE == rule->insert)
+    {
+        desc->ptr = (char *)rule->head.data();
+        desc->len = rule->head.size();
+        return;
+    }
+
+    const char  *value = symbol.ptr;
+    size_t      valueLen = symbol.len;
+    if (DESC_INSERT_BANK == rule->insert)
+    {
+        value = bankName;
+        valueLen = strlen(bankName);
+    }
+
+    // Cut short rather than overrun buf
+    size_t headLen = rule->head.size();
+    if (headLen > MAX_LINE) headLen = MAX_LINE;
+    if (valueLen > MAX_LINE - headLen) valueLen = MAX_LINE - headLen;
+    size_t tailLen = rule->tail.size();
+    if (tailLen > MAX_LINE - headLen - valueLen) tailLen = MAX_LINE - headLen - valueLen;
+
+    memcpy(buf, rule->head.data(), headLen);
+    memcpy(buf + headLen, value, valueLen);
+    memcpy(buf + headLen + valueLen, rule->tail.data(), tailLen);
+    desc->ptr = buf;
+    desc->len = headLen + valueLen + tailLen;
+}
+
+// Field i of a parsed line, empty if the format has no such column
+static inline csvField_t column(const csvField_t *fields, int i)
+{
+    return (i >= 0) ? fields[i] : csvField_t();
+}
+
+// The row functions of one set of ROW_ flags.  The flags are known at
+// compile time, so each format gets code with only the steps it uses.
+template <unsigned FLAGS>
+struct RowConverter
+{
+    static bool mapFields(const QifConverter &c, csvField_t *fields, rowFields_t *row)
+    {
+        const columnMap_t   &cols = c.cols;
+        bool                withdrawal = false;
+
+        row->amtCents = 0;
+        row->dateKey = 0;
+
+        if (FLAGS & ROW_SKIP_PREFIX)
+        {
+            csvField_t skip = column(fields, cols.skip);
+            strip_quotes(&skip);
+            if (field_has_prefix_ci(skip, c.format->skipPrefix, c.skipPrefixLen)) {
+                // e.g. transactions that are still in process
+                STATS_COUNT(STAT_SKIP_PROCESSING);
+                return false;
+            }
+        }
+
+        row->date = column(fields, cols.date);
+        strip_quotes(&row->date);
+        if (FLAGS & ROW_DATE_DIGIT)
+        {
+            if ((0 == row->date.len) || (isdigit((unsigned char)row->date.ptr[0]) == 0)) {
+                // Skip lines without a valid date
+                STATS_COUNT(STAT_SKIP_DATE);
+                return false;
+            }
+        }
+        size_t dateLen;
+        row->dateKey = parseDate(row->date.ptr, row->date.len, &dateLen);
+        if (FLAGS & ROW_DATE_AS_OF)
+        {
+            // Remove any "as of ..." portion of this field.  parseDate()
+            // has found it after a date; only something that is not a
+            // date is searched.
+            if (row->dateKey)
+            {
+                row->date.len = dateLen;
+            }
+            else
+            {
+                char *cp = (char *)memmem(row->date.ptr, row->date.len, " as of", 6);
+                if (cp) row->date.len = cp - row->date.ptr;
+            }
+        }
+        if (c.filter && (false == c.filter->dateOk(row->dateKey)))
+        {
+            STATS_COUNT(STAT_SKIP_FILTER);
+            return false;
+        }
+
+        row->desc = column(fields, cols.desc);
+        row->symbol = column(fields, cols.symbol);
+        row->action = column(fields, cols.action);
+        strip_quotes(&row->desc);
+        strip_quotes(&row->symbol);
+        strip_quotes(&row->action);
+        if  (   c.filter
+             && (   (false == c.filter->symbolOk(row->symbol.ptr, row->symbol.len))
+                 || (false == c.filter->descOk(row->desc.ptr, row->desc.len))
+                )
+            )
+        {
+            STATS_COUNT(STAT_SKIP_FILTER);
+            return false;
+        }
+
+        if (FLAGS & ROW_DEBIT_CREDIT)
+        {
+            // The withdrawal (debit) field might be blank
+            row->amt = column(fields, cols.debit);
+            if (0 == row->amt.len)
+            {
+                row->amt = column(fields, cols.credit);
+            }
+            else
+            {
+                // Withdrawals are listed as positive numbers,
+                // but QIF needs them to be negative.
+                withdrawal = true;
+            }
+        }
+        else
+        {
+            row->amt = column(fields, cols.amount);
+        }
+
+        // No amount, no transaction
+        if (false == parse_amount_cents(row->amt, &row->amtCents))
+        {
+            STATS_COUNT(STAT_SKIP_AMOUNT);
+            return false;
+        }
+        if (withdrawal) row->amtCents = -row->amtCents;
+
+        return true;
+    }
+
+    static void rewriteDescription(const QifConverter &c, rowFields_t *row, char *descBuf)
+    {
+        if (FLAGS & ROW_REWRITE_HOLDINGS)
+        {
+            std::string_view sym(row->symbol.ptr, row->symbol.len);
+            const char *bankName;
+            if (c.mmSymbols.lookup(sym)) {
+                STATS_COUNT(STAT_MM_HIT);
+                applyRule(*c.rules, DESC_RULE_MM, &row->desc, row->symbol, (const char *)(NULL), descBuf);
+            }
+            else if (field_has_prefix_ci(row->symbol, "912797", 6)) {
+                STATS_COUNT(STAT_MM_MISS);
+                applyRule(*c.rules, DESC_RULE_TBILL, &row->desc, row->symbol, (const char *)(NULL), descBuf);
+            }
+            else if ((bankName = c.cusip2bank.lookup(sym)) != nullptr) {
+                STATS_COUNT(STAT_MM_MISS);
+                STATS_COUNT(STAT_CUSIP_HIT);
+                applyRule(*c.rules, DESC_RULE_CD, &row->desc, row->symbol, bankName, descBuf);
+            }
+            else {
+                STATS_COUNT(STAT_MM_MISS);
+                STATS_COUNT(STAT_CUSIP_MISS);
+            }
+        }
+        if (FLAGS & ROW_REWRITE_MM_ACTION)
+        {
+            if (c.mmSymbols.lookup(std::string_view(row->symbol.ptr, row->symbol.len))) {
+                // Replace the description with the action
+                STATS_COUNT(STAT_MM_HIT);
+                row->desc = row->action;
+                applyRule(*c.rules, DESC_RULE_MM, &row->desc, row->symbol, (const char *)(NULL), descBuf);
+            }
+            else {
+                STATS_COUNT(STAT_MM_MISS);
+            }
+        }
+    }
+
+    // The row's dedup fingerprint, before its description is rewritten
+    static uint64_t fingerprint(const rowFields_t &row)
+    {
+        return DedupIndex::fingerprint(row.dateKey, row.date.ptr, row.date.len, row.desc.ptr, row.desc.len, row.amtCents);
+    }
+
+    static bool convertLine(const QifConverter &c, char *line, size_t len, QifOutput &out, int32_t *dateKey)
+    {
+        char                descBuf[MAX_LINE];
+        csvField_t          fields[MAX_FIELDS];
+        rowFields_t         row;
+
+        if (dateKey) *dateKey = 0;
+        if (0 == len) return false;
+        STATS_COUNT(STAT_ROWS);
+
+        {
+            STATS_SCOPE(STAT_PARSE);
+            parse_csv_line(line, len, fields, MAX_FIELDS);
+        }
+        {
+            STATS_SCOPE(STAT_MAP);
+            bool isTransaction = mapFields(c, fields, &row);
+            if (dateKey) *dateKey = row.dateKey;
+            if (false == isTransaction) return false;
+        }
+        qifMark_t mark = {c.dedup ? fingerprint(row) : 0, out.qif.size(), out.log.size()};
+        {
+            STATS_SCOPE(STAT_REWRITE);
+            rewriteDescription(c, &row, descBuf);
+        }
+        STATS_SCOPE(STAT_FORMAT);
+        if (false == c.writeRow(row, out)) return false;
+        if (c.dedup) out.marks.push_back(mark);
+        STATS_COUNT(STAT_TRANSACTIONS);
+        return true;
+    }
+
+    static void convertBlock(const QifConverter &c, char *data, size_t len, QifOutput &out)
+    {
+        char    *p = data;
+        char    *end = data + len;
+
+        while (p < end)
+        {
+            char *nl = (char *)memchr(p, '\n', end - p);
+            size_t n = nl ? (size_t)(nl - p) : (size_t)(end - p);
+            convertLine(c, p, csv_line_length(p, n), out, (int32_t *)(NULL));
+            p += n + (nl ? 1 : 0);
+        }
+    }
+
+    static bool parseLine(const QifConverter &c, char *line, size_t len, TransactionBatch &batch, int32_t *dateKey)
+    {
+        char                descBuf[MAX_LINE];
+        csvField_t          fields[MAX_FIELDS];
+        rowFields_t         row;
+
+        if (dateKey) *dateKey = 0;
+        if (0 == len) return false;
+        STATS_COUNT(STAT_ROWS);
+
+        {
+            STATS_SCOPE(STAT_PARSE);
+            parse_csv_line(line, len, fields, MAX_FIELDS);
+        }
+        {
+            STATS_SCOPE(STAT_MAP);
+            bool isTransaction = mapFields(c, fields, &row);
+            if (dateKey) *dateKey = row.dateKey;
+            if (false == isTransaction) return false;
+        }
+        bool        keepPrint = c.dedup || c.keepPrints;
+        uint64_t    print = keepPrint ? fingerprint(row) : 0;
+        {
+            STATS_SCOPE(STAT_REWRITE);
+            rewriteDescription(c, &row, descBuf);
+        }
+        batch.add(row.date, row.dateKey, row.desc, row.symbol, row.amtCents);
+        if (keepPrint) batch.addFingerprint(print);
+        return true;
+    }
+
+    static void parseBlock(const QifConverter &c, char *data, size_t len, TransactionBatch &batch)
+    {
+        char    *p = data;
+        char    *end = data + len;
+
+        while (p < end)
+        {
+            char *nl = (char *)memchr(p, '\n', end - p);
+            size_t n = nl ? (size_t)(nl - p) : (size_t)(end - p);
+            parseLine(c, p, csv_line_length(p, n), batch, (int32_t *)(NULL));
+            p += n + (nl ? 1 : 0);
+        }
+    }
+};
+
+struct rowFns_t
+{
+    bool    (*mapFields)(const QifConverter &, csvField_t *, rowFields_t *);
+    void    (*rewriteDescription)(const QifConverter &, rowFields_t *, char *);
+    bool    (*convertLine)(const QifConverter &, char *, size_t, QifOutput &, int32_t *);
+    void    (*convertBlock)(const QifConverter &, char *, size_t, QifOutput &);
+    bool    (*parseLine)(const QifConverter &, char *, size_t, TransactionBatch &, int32_t *);
+    void    (*parseBlock)(const QifConverter &, char *, size_t, TransactionBatch &);
+};
+
+template <unsigned FLAGS>
+static constexpr rowFns_t rowFnsFor()
+{
+    return {
+        &RowConverter<FLAGS>::mapFields
+        , &RowConverter<FLAGS>::rewriteDescription
+        , &RowConverter<FLAGS>::convertLine
+        , &RowConverter<FLAGS>::convertBlock
+        , &RowConverter<FLAGS>::parseLine
+        , &RowConverter<FLAGS>::parseBlock
+    };
+}
+
+// The row functions of every descriptor, in formatDescriptors[] order
+template <size_t... I>
+static constexpr std::array<rowFns_t, sizeof...(I)> makeRowFns(std::index_sequence<I...>)
+{
+    return {{ rowFnsFor<formatDescriptors[I].flags>()... }};
+}
+
+static constexpr auto rowFnsTable = makeRowFns(std::make_index_sequence<NUM_FORMAT_DESCRIPTORS>());
+
+// Column of a columnSpec_t in the parsed column header line
+static int resolveColumn(const columnSpec_t &spec, csvField_t *fields, int numFields)
+{
+    if ((const char *)(NULL) == spec.name) return -1;
+
+    size_t n = strlen(spec.name);
+    int index = spec.index;
+
+    for (int i = 0; i < numFields; i++)
+    {
+        if ((fields[i].len == n) && (strncasecmp(fields[i].ptr, spec.name, n) == 0))
+        {
+            return i;
+        }
+    }
+    for (int i = 0; i < numFields; i++)
+    {
+        if (field_has_prefix_ci(fields[i], spec.name, n))
+        {
+            index = i;
+            break;
+        }
+    }
+    return (index < MAX_FIELDS) ? index : -1;
+}
+
+QifConverter::QifConverter(bankFormat_t bankFormat
+                           , int verbosity
+                           , const MoneyMarketSymbols &mmSymbols
+                           , const CUSIPBankMap &cusip2bank
+                          )
+    : format((const formatDescriptor_t *)(NULL))
+    , fns((const rowFns_t *)(NULL))
+    , skipPrefixLen(0)
+    , verbosity(verbosity)
+    , mmSymbols(mmSymbols)
+    , cusip2bank(cusip2bank)
+    , rules(&DescriptionRules::builtIn())
+    , dateFormat(DATE_AS_IS)
+    , dedup((DedupIndex *)(NULL))
+    , keepPrints(false)
+    , filter((const RowFilter *)(NULL))
+{
+    int i = formatDescriptorIndex(bankFormat);
+
+    memset(&cols, -1, sizeof(cols));
+    if (i < 0) return;
+
+    format = &formatDescriptors[i];
+    fns = &rowFnsTable[i];
+    if (format->skipPrefix) skipPrefixLen = strlen(format->skipPrefix);
+
+    // The usual columns, until resolveColumns() finds the real ones
+    cols.date = format->date.index;
+    cols.desc = format->desc.index;
+    cols.amount = format->amount.index;
+    cols.debit = format->debit.index;
+    cols.credit = format->credit.index;
+    cols.symbol = format->symbol.index;
+    cols.action = format->action.index;
+    cols.skip = format->skip.index;
+}
+
+bool QifConverter::isHeaderLine(const char *line, size_t len) const
+{
+    char    header[MAX_LINE];
+
+    if ((const formatDescriptor_t *)(NULL) == format) return false;
+
+    // Header lines are rare, so work on a null terminated copy
+    size_t n = (len < sizeof(header)) ? len : sizeof(header) - 1;
+    memcpy(header, line, n);
+    header[n] = '\0';
+    remove_all_quotes(header);
+
+    return (strncmp(header, format->headerStart, strlen(format->headerStart)) == 0);
+}
+
+void QifConverter::resolveColumns(char *line, size_t len)
+{
+    csvField_t  fields[MAX_FIELDS];
+
+    if ((const formatDescriptor_t *)(NULL) == format) return;
+
+    int n = parse_csv_line(line, len, fields, MAX_FIELDS);
+    for (int i = 0; i < n; i++)
+    {
+        strip_quotes(&fields[i]);
+        while (fields[i].len && (' ' == fields[i].ptr[0]))
+        {
+            fields[i].ptr++;
+            fields[i].len--;
+        }
+        while (fields[i].len && (' ' == fields[i].ptr[fields[i].len - 1]))
+        {
+            fields[i].len--;
+        }
+    }
+
+    cols.date = resolveColumn(format->date, fields, n);
+    cols.desc = resolveColumn(format->desc, fields, n);
+    cols.amount = resolveColumn(format->amount, fields, n);
+    cols.debit = resolveColumn(format->debit, fields, n);
+    cols.credit = resolveColumn(format->credit, fields, n);
+    cols.symbol = resolveColumn(format->symbol, fields, n);
+    cols.action = resolveColumn(format->action, fields, n);
+    cols.skip = resolveColumn(format->skip, fields, n);
+}
+
+bool QifConverter::mapFields(csvField_t *fields, rowFields_t *row) const
+{
+    if ((const rowFns_t *)(NULL) == fns) return false;
+    return fns->mapFields(*this, fields, row);
+}
+
+void QifConverter::rewriteDescription(rowFields_t *row, char *descBuf) const
+{
+    if (fns) fns->rewriteDescription(*this, row, descBuf);
+}
+
+bool QifConverter::writeRow(const rowFields_t &row, QifOutput &out) const
+{
+    char                cents[QIF_CENTS_MAX];
+    int                 centsLen = formatCents(cents, row.amtCents);
+    char                dateText[DATE_TEXT_MAX];
+    const char          *date = row.date.ptr;
+    size_t              dateLen = row.date.len;
+
+    if ((DATE_AS_IS != dateFormat) && row.dateKey)
+    {
+        dateLen = formatDate(dateText, row.dateKey, dateFormat);
+        date = dateText;
+    }
+
+    if (verbosity >= 2)
+    {
+        char logLine[MAX_LINE];
+        snprintf(logLine, sizeof(logLine), "%.*s\t%.*s\t$%.*s\n"
+                 , (int)dateLen, date
+                 , (int)((row.desc.len < 16) ? row.desc.len : 16), row.desc.ptr
+                 , centsLen, cents
+                );
+        out.log += logLine;
+    }
+
+    // D<date>\nP<desc>\nT<amount>\nC*\n^\n
+    char *p = out.qif.reserve(dateLen + row.desc.len + centsLen + 16);
+    char *start = p;
+    *p++ = 'D';
+    memcpy(p, date, dateLen);
+    p += dateLen;
+    *p++ = '\n';
+    *p++ = 'P';
+    memcpy(p, row.desc.ptr, row.desc.len);
+    p += row.desc.len;
+    *p++ = '\n';
+    *p++ = 'T';
+    memcpy(p, cents, centsLen);
+    p += centsLen;
+    memcpy(p, "\nC*\n^\n", 6);
+    p += 6;
+    out.qif.commit(p - start);
+    ++out.numTransactions;
+
+    return true;
+}
+
+bool QifConverter::convertLine(char *line, size_t len, QifOutput &out, int32_t *dateKey) const
+{
+    if (dateKey) *dateKey = 0;
+    if ((const rowFns_t *)(NULL) == fns) return false;
+    return fns->convertLine(*this, line, len, out, dateKey);
+}
+
+void QifConverter::convertBlock(char *data, size_t len, QifOutput &out) const
+{
+    if (fns) fns->convertBlock(*this, data, len, out);
+}
+
+bool QifConverter::parseLine(char *line, size_t len, TransactionBatch &batch, int32_t *dateKey) const
+{
+    if (dateKey) *dateKey = 0;
+    if ((const rowFns_t *)(NULL) == fns) return false;
+    return fns->parseLine(*this, line, len, batch, dateKey);
+}
+
+void QifConverter::parseBlock(char *data, size_t len, TransactionBatch &batch) const
+{
+    if (fns) fns->parseBlock(*this, data, len, batch);
+}
+
+bool QifConverter::writeTransaction(const TransactionBatch &batch, const transaction_t &t, QifOutput &out) const
+{
+    std::string_view    date = batch.dateText(t);
+    std::string_view    desc = batch.desc(t);
+    rowFields_t         row;
+
+    // writeRow() only reads the fields
+    memset(&row, 0, sizeof(row));
+    row.date.ptr = (char *)date.data();
+    row.date.len = date.size();
+    row.dateKey = t.date;
+    row.desc.ptr = (char *)desc.data();
+    row.desc.len = desc.size();
+    row.amtCents = t.cents;
+    return writeRow(row, out);
+}
+
+void QifConverter::writeBatch(const TransactionBatch &batch, QifOutput &out) const
+{
+    for (const transaction_t &t : batch)
+    {
+        writeTransaction(batch, t, out);
+    }
+}
+
+void QifConverter::useDedup(DedupIndex *index)
+{
+    dedup = index;
+    if (dedup) dedup->beginFile();
+}
+
+int QifConverter::dedupe(QifOutput &out) const
+{
+    if (((DedupIndex *)(NULL) == dedup) || out.marks.empty()) return 0;
+
+    // Move the records (and log lines) that are kept down over those
+    // that are not.  A record runs to the start of the next one.
+    char        *qif = (char *)out.qif.data();
+    size_t      qifDst = out.marks[0].qif;
+    size_t      logDst = out.marks[0].log;
+    int         removed = 0;
+
+    for (size_t i = 0; i < out.marks.size(); i++)
+    {
+        const qifMark_t &m = out.marks[i];
+        size_t          qifEnd = (i + 1 < out.marks.size()) ? out.marks[i + 1].qif : out.qif.size();
+        size_t          logEnd = (i + 1 < out.marks.size()) ? out.marks[i + 1].log : out.log.size();
+
+        if (dedup->isDuplicate(m.fingerprint))
+        {
+            ++removed;
+            continue;
+        }
+        if (qifDst != m.qif) memmove(qif + qifDst, qif + m.qif, qifEnd - m.qif);
+        if (logDst != m.log) memmove(&out.log[logDst], &out.log[m.log], logEnd - m.log);
+        qifDst += qifEnd - m.qif;
+        logDst += logEnd - m.log;
+    }
+
+    out.qif.truncate(qifDst);
+    out.log.resize(logDst);
+    out.numTransactions -= removed;
+    out.marks.clear();
+    return removed;
+}
+
+void splitLines(char *data, size_t len, int numJobs, std::vector<lineBlock_t> &blocks)
+{
+    if (numJobs < 1) numJobs = 1;
+
+    // Several chunks per thread so a slow chunk does not hold up the
+    // others, but never so small that thread hand off dominates.
+    size_t chunkSize = len / ((size_t)numJobs * 4);
+    if (chunkSize < MIN_CHUNK_SIZE) chunkSize = MIN_CHUNK_SIZE;
+
+    // Split on line boundaries.  Every newline ends a record, exactly
+    // as it does when the input is read a line at a time, so any
+    // newline is a safe place to split.
+    char *p = data;
+    char *end = data + len;
+    while (p < end)
+    {
+        char *q = end;
+        if ((size_t)(end - p) > chunkSize)
+        {
+            char *nl = (char *)memchr(p + chunkSize, '\n', end - (p + chunkSize));
+            if (nl) q = nl + 1;
+        }
+        blocks.push_back({p, (size_t)(q - p)});
+        p = q;
+    }
+}
+
+// One piece of the input for convertParallel()
+typedef struct
+{
+    char        *data;
+    size_t      len;
+    QifOutput   out;
+    bool        done;
+}   chunk_t;
+
+int convertParallel(const QifConverter &converter
+                    , char *data
+                    , size_t len
+                    , int numJobs
+                    , QifWriter &qifOut
+                    , FILE *fpLog
+                   )
+{
+    std::vector<chunk_t>        chunks;
+    std::vector<std::thread>    workers;
+    std::atomic<size_t>         nextChunk(0);
+    std::mutex                  mtx;
+    std::condition_variable     cv;
+    std::vector<lineBlock_t>    blocks;
+    int                         numTransactions = 0;
+
+    if (numJobs < 1) numJobs = 1;
+
+    splitLines(data, len, numJobs, blocks);
+    chunks.resize(blocks.size());
+    for (size_t n = 0; n < blocks.size(); n++)
+    {
+        chunks[n].data = blocks[n].data;
+        chunks[n].len = blocks[n].len;
+        chunks[n].done = false;
+    }
+
+    if ((size_t)numJobs > chunks.size()) numJobs = (int)chunks.size();
+
+    for (int i = 0; i < numJobs; i++)
+    {
+        workers.emplace_back([&]()
+        {
+            size_t n;
+            while ((n = nextChunk++) < chunks.size())
+            {
+                converter.convertBlock(chunks[n].data, chunks[n].len, chunks[n].out);
+                std::lock_guard<std::mutex> lock(mtx);
+                chunks[n].done = true;
+                cv.notify_all();
+            }
+        });
+    }
+
+    // Write the results out in order as they become available
+    for (size_t n = 0; n < chunks.size(); n++)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait(lock, [&]() { return chunks[n].done; });
+        }
+        QifOutput &out = chunks[n].out;
+        converter.dedupe(out);
+        qifOut.write(out.qif);
+        if (fpLog) fwrite(out.log.data(), 1, out.log.size(), fpLog);
+        numTransactions += out.numTransactions;
+        out = QifOutput();
+    }
+
+    for (auto &w : workers)
+    {
+        w.join();
+    }
+
+    return numTransactions;
+}
+
+bool qifFileNameFromInput(const char *inFileName, char *outFileName, size_t outSize)
+{
+    const char *cp = strrchr(inFileName, '.');
+
+    if ((const char *)(NULL) == cp) return false;
+
+    // x.csv.gz becomes x.qif
+    if  (   ((strcasecmp(cp, ".gz") == 0) || (strcasecmp(cp, ".zst") == 0))
+         && (cp > inFileName)
+        )
+    {
+        const char *ext = (const char *)memrchr(inFileName, '.', cp - inFileName);
+        if (ext) cp = ext;
+    }
+
+    snprintf(outFileName, outSize, "%.*s.qif", (int)(cp - inFileName), inFileName);
+    return true;
+}
+
+bool findColumnHeader(QifConverter &converter, CsvInput &csvIn)
+{
+    char    *line;
+    size_t  lineLen;
+
+    STATS_SCOPE(STAT_HEADER);
+
+    while (csvIn.nextLine(&line, &lineLen))
+    {
+        if (lineLen && converter.isHeaderLine(line, lineLen))
+        {
+            converter.resolveColumns(line, lineLen);
+            return true;
+        }
+    }
+    return false;
+}
+
+int convertStream(QifConverter &converter
+                  , CsvInput &csvIn
+                  , QifWriter &qifOut
+                  , int numJobs
+                  , FILE *fpLog
+                  , convertResult_t *result
+                 )
+{
+    char                *line;
+    size_t              lineLen;
+    char                *data;
+    size_t              dataLen;
+    auto                start = std::chrono::steady_clock::now();
+
+    result->numTransactions = 0;
+    result->bytesIn = 0;
+    result->seconds = 0.0;
+
+    qifOut.write("!Type:Bank\n", 11);
+
+    findColumnHeader(converter, csvIn);
+
+    if  (   (numJobs > 1)
+         && csvIn.remaining(&data, &dataLen)
+        )
+    {
+        result->numTransactions = convertParallel(converter, data, dataLen, numJobs, qifOut, fpLog);
+    }
+    else
+    {
+        QifOutput       out;
+        bool            streaming = (false == csvIn.isMapped());
+        size_t          flushSize = streaming ? STREAM_FLUSH_SIZE : OUTPUT_FLUSH_SIZE;
+        const RowFilter *filter = converter.getFilter();
+        bool            stopEarly = filter && dateRangeLimited(filter->dateRange()) && converter.getFormat();
+        DateOrder       order(stopEarly && converter.getFormat()->newestFirst);
+        int32_t         dateKey;
+
+        while (csvIn.nextLine(&line, &lineLen))
+        {
+            converter.convertLine(line, lineLen, out, &dateKey);
+            converter.dedupe(out);
+            if (stopEarly && order.pastRange(filter->dateRange(), dateKey)) break;
+
+            if (out.qif.size() >= flushSize)
+            {
+                qifOut.write(out.qif);
+                out.qif.clear();
+                if (streaming) qifOut.flush();
+            }
+            if (out.log.size())
+            {
+                if (fpLog) fputs(out.log.c_str(), fpLog);
+                out.log.clear();
+            }
+        }
+        qifOut.write(out.qif);
+        result->numTransactions = out.numTransactions;
+    }
+    qifOut.flush();
+
+    result->bytesIn = csvIn.bytesRead();
+    result->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (csvIn.failed()) return -10;
+    return qifOut.failed() ? -7 : 0;
+}
+
+int convertFile(QifConverter &converter
+                , const char *inFileName
+                , const char *outFileName
+                , int numJobs
+                , FILE *fpLog
+                , convertResult_t *result
+               )
+{
+    CsvInput            csvIn;
+    QifWriter           qifOut;
+    int                 ret;
+
+    result->numTransactions = 0;
+    result->bytesIn = 0;
+    result->seconds = 0.0;
+
+    if (false == csvIn.open(inFileName))
+    {
+        return -4;
+    }
+
+    if (false == qifOut.open(outFileName))
+    {
+        csvIn.close();
+        return -5;
+    }
+
+    ret = convertStream(converter, csvIn, qifOut, numJobs, fpLog, result);
+    csvIn.close();
+
+    if ((false == qifOut.close()) && (0 == ret))
+    {
+        ret = -7;
+    }
+
+    return ret;
+}
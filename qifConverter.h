@@ -0,0 +1,268 @@
+#ifndef __QIFCONVERTER_H__
+#define __QIFCONVERTER_H__
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include "bankFormat.h"
+#include "mmSymbols.h"
+#include "cusipBankMap.h"
+#include "descRules.h"
+#include "dateParse.h"
+#include "csvParse.h"
+#include "csvInput.h"
+#include "qifWriter.h"
+#include "formatDescriptor.h"
+#include "dedupIndex.h"
+#include "transaction.h"
+#include "rowFilter.h"
+
+#define MAX_LINE 4096
+#define MAX_FIELDS  32
+
+// A transaction written to a QifOutput by a converter with a dedup
+// index: its fingerprint, and where its QIF record and log line start
+typedef struct
+{
+    uint64_t    fingerprint;
+    size_t      qif;
+    size_t      log;
+}   qifMark_t;
+
+// Where converted transactions go.  qif holds the QIF records,
+// log holds the verbose (-v -v) listing.  marks has a mark for each
+// record while dedup has yet to look at it (see QifConverter::dedupe()).
+class QifOutput {
+public:
+    QifBuffer               qif;
+    std::string             log;
+    int                     numTransactions;
+    std::vector<qifMark_t>  marks;
+
+    QifOutput() : numTransactions(0) {}
+};
+
+// The fields of one transaction.  They point into the CSV line
+// (or for a rewritten description, into the caller's buffer).
+// dateKey is the date packed by parseDate(), 0 if it is not one.
+// amtCents is the amount with the QIF sign, withdrawals negative.
+typedef struct
+{
+    csvField_t  date;
+    int32_t     dateKey;
+    csvField_t  desc;
+    csvField_t  action;
+    csvField_t  symbol;
+    csvField_t  amt;
+    int64_t     amtCents;
+}   rowFields_t;
+
+// Where this file's columns are: formatDescriptor_t columns resolved
+// against the column header line.  -1 for a column it does not have.
+typedef struct
+{
+    int         date;
+    int         desc;
+    int         amount;
+    int         debit;
+    int         credit;
+    int         symbol;
+    int         action;
+    int         skip;
+}   columnMap_t;
+
+template <unsigned FLAGS> struct RowConverter;
+struct rowFns_t;
+
+// Converts CSV transaction lines of one bank format into QIF records.
+// The format's row function is picked once, when the converter is made,
+// so converting a row does not look at the format.  Conversion does not
+// modify the converter, so one converter can be shared by several
+// threads, each with its own QifOutput.
+class QifConverter {
+private:
+    const formatDescriptor_t    *format;    // NULL for an unknown format
+    const rowFns_t              *fns;
+    columnMap_t                 cols;
+    size_t                      skipPrefixLen;
+    int                         verbosity;
+    const MoneyMarketSymbols    &mmSymbols;
+    const CUSIPBankMap          &cusip2bank;
+    const DescriptionRules      *rules;
+    dateFormat_t                dateFormat;
+    DedupIndex                  *dedup;     // NULL if not removing duplicates
+    bool                        keepPrints; // Fingerprint rows parsed into batches
+    const RowFilter             *filter;    // NULL if converting every row
+
+    template <unsigned FLAGS> friend struct RowConverter;
+
+public:
+    QifConverter(bankFormat_t bankFormat
+                 , int verbosity
+                 , const MoneyMarketSymbols &mmSymbols
+                 , const CUSIPBankMap &cusip2bank
+                );
+
+    // NULL for an unknown format
+    const formatDescriptor_t *getFormat() const { return format; }
+
+    // Rewrite descriptions with rules instead of the built-in rules.
+    // rules must last as long as the converter.
+    void useRules(const DescriptionRules *r)    { rules = r; }
+
+    // Write dates in format instead of as the export has them.  Dates
+    // that can not be read are still written as they are.
+    void useDateFormat(dateFormat_t format)     { dateFormat = format; }
+
+    // Convert only the rows filter passes.  filter must last as long
+    // as the converter.  NULL (or a filter with no tests) converts
+    // every row.
+    void useFilter(const RowFilter *f)          { filter = (f && f->active()) ? f : (const RowFilter *)(NULL); }
+    const RowFilter *getFilter() const          { return filter; }
+
+    // Remove transactions already in index from what is converted.
+    // A converter is one file, so this starts the file's ordinals.
+    // Each row converted is fingerprinted (DedupIndex::fingerprint())
+    // as the export has it, and QIF records are marked with theirs in
+    // QifOutput marks, or batches given theirs, for dedupe() or
+    // writeTransactions() to look up in file order.
+    void useDedup(DedupIndex *index);
+    DedupIndex *getDedup() const                { return dedup; }
+
+    // Give the transactions parsed into batches their fingerprints
+    // even without a dedup index, so a TransactionCache written from
+    // them can be deduplicated by a later run
+    void keepFingerprints(bool keep)            { keepPrints = keep; }
+
+    // Remove the duplicates, and their verbose listing, from the
+    // records of out marked since the last call, if useDedup() was
+    // given an index.  Call in the order the output is written, from
+    // one thread, before out is written or logged.  Returns the number
+    // removed.
+    int dedupe(QifOutput &out) const;
+
+    // True if this is the column header line that starts
+    // the transaction section for this bank format
+    bool isHeaderLine(const char *line, size_t len) const;
+
+    // Find the format's columns by name in the column header line.
+    // Columns it does not name keep the format's usual position.
+    // The line may be modified.  Call before converting, not while
+    // other threads are converting.
+    void resolveColumns(char *line, size_t len);
+
+    // Convert one transaction line (without line ending).
+    // The line may be modified.  Returns true if a transaction
+    // was written to out.  *dateKey (if not NULL) is set to the row's
+    // packed date, 0 if it has none, whether it was written or not
+    // (for DateOrder).
+    bool convertLine(char *line, size_t len, QifOutput &out, int32_t *dateKey = (int32_t *)(NULL)) const;
+
+    // The steps of convertLine().  They are public so each can be
+    // timed on its own (see csv2qifBench).
+
+    // Pick this format's fields out of the parsed line and parse the
+    // amount.  Returns false if the line is not a transaction, or the
+    // converter's filter leaves it out; the filter is tested as soon
+    // as the date, then the symbol and description, are picked out.
+    bool mapFields(csvField_t *fields, rowFields_t *row) const;
+
+    // Rewrite the description of money market, T-Bill and CD
+    // transactions by the converter's DescriptionRules.  descBuf
+    // (MAX_LINE) holds a new description that is put together.
+    void rewriteDescription(rowFields_t *row, char *descBuf) const;
+
+    // Append the QIF record
+    bool writeRow(const rowFields_t &row, QifOutput &out) const;
+
+    // Convert a block of transaction lines
+    void convertBlock(char *data, size_t len, QifOutput &out) const;
+
+    // The same as convertLine() and convertBlock(), but add the
+    // transactions to batch instead of writing QIF
+    bool parseLine(char *line, size_t len, TransactionBatch &batch, int32_t *dateKey = (int32_t *)(NULL)) const;
+    void parseBlock(char *data, size_t len, TransactionBatch &batch) const;
+
+    // Write the QIF record of a transaction of batch, the same as
+    // convertLine() would have written it
+    bool writeTransaction(const TransactionBatch &batch, const transaction_t &t, QifOutput &out) const;
+
+    // Write every transaction of batch, in order
+    void writeBatch(const TransactionBatch &batch, QifOutput &out) const;
+};
+
+// Result of converting one file
+typedef struct
+{
+    int         numTransactions;
+    size_t      bytesIn;
+    double      seconds;
+}   convertResult_t;
+
+// Build the output file name from the input file name by replacing
+// the extension with .qif (x.csv.gz and x.csv.zst give x.qif).
+// Returns false if there is no extension.
+bool qifFileNameFromInput(const char *inFileName, char *outFileName, size_t outSize);
+
+// Read csvIn up to and including the column header line, and resolve
+// the converter's columns against it.  Returns false if there is none.
+bool findColumnHeader(QifConverter &converter, CsvInput &csvIn);
+
+// Convert CSV from csvIn to QIF written to qifOut, both already open.
+// Neither is closed; qifOut is flushed.  numJobs > 1 converts the rest
+// of the input with convertParallel() once the column header line is
+// found, when the input is mapped.  Input that is streamed is converted
+// a line at a time and the QIF written out every STREAM_FLUSH_SIZE, so
+// it works in a pipeline in bounded memory.  Input read a line at a
+// time stops early, as DateOrder finds, once the rest of it is past
+// the date range of the converter's filter.  The converter's columns
+// are resolved against the column header line.  The verbose listing
+// goes to fpLog if not NULL.  Returns 0 on success, -7 if writing
+// failed or -10 if the input could not all be read (or was corrupt
+// compressed data).
+int convertStream(QifConverter &converter
+                  , CsvInput &csvIn
+                  , QifWriter &qifOut
+                  , int numJobs
+                  , FILE *fpLog
+                  , convertResult_t *result
+                 );
+
+// Convert one CSV file to a QIF file with convertStream().  Returns 0
+// on success, -4 if the input file can not be opened, -5 if the output
+// file can not be opened, -7 if writing it failed or -10 if reading
+// the input failed.
+int convertFile(QifConverter &converter
+                , const char *inFileName
+                , const char *outFileName
+                , int numJobs
+                , FILE *fpLog
+                , convertResult_t *result
+               );
+
+// A line aligned piece of a block of transaction lines
+typedef struct
+{
+    char        *data;
+    size_t      len;
+}   lineBlock_t;
+
+// Split a block of transaction lines at newlines into pieces for
+// numJobs threads: several per thread, so a slow piece does not hold
+// up the others, but none smaller than is worth a thread.
+void splitLines(char *data, size_t len, int numJobs, std::vector<lineBlock_t> &blocks);
+
+// Convert a block of transaction lines with numJobs threads.
+// The block is split into line aligned chunks that are converted
+// in parallel.  QIF is written to fpOut and the verbose listing to
+// fpLog in the original order.  Returns the number of transactions.
+int convertParallel(const QifConverter &converter
+                    , char *data
+                    , size_t len
+                    , int numJobs
+                    , QifWriter &qifOut
+                    , FILE *fpLog
+                   );
+
+#endif
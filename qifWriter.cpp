@@ -0,0 +1,136 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "qifWriter.h"
+#include "stats.h"
+
+int formatCents(char *buf, int64_t cents)
+{
+    char        tmp[QIF_CENTS_MAX];
+    char        *p = tmp + sizeof(tmp);
+    uint64_t    v = (cents < 0) ? (0 - (uint64_t)cents) : (uint64_t)cents;
+
+    // Build it backwards: cents, the point, then the dollars
+    *--p = (char)('0' + v % 10);    v /= 10;
+    *--p = (char)('0' + v % 10);    v /= 10;
+    *--p = '.';
+    do
+    {
+        *--p = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    if (cents < 0) *--p = '-';
+
+    int n = (int)(tmp + sizeof(tmp) - p);
+    memcpy(buf, p, n);
+    return n;
+}
+
+void QifBuffer::grow(size_t need)
+{
+    size_t newSize = buf.size() ? buf.size() * 2 : 64 * 1024;
+
+    while (newSize < need) newSize *= 2;
+    buf.resize(newSize);
+}
+
+QifWriter::QifWriter()
+    : fd(-1)
+    , ownFd(false)
+    , memory((QifBuffer *)(NULL))
+    , error(false)
+{
+}
+
+QifWriter::~QifWriter()
+{
+    close();
+}
+
+bool QifWriter::open(const char *fileName, bool append)
+{
+    close();
+    error = false;
+    fd = ::open(fileName, O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC), 0666);
+    ownFd = true;
+    return (fd >= 0);
+}
+
+void QifWriter::attach(int outFd)
+{
+    close();
+    error = false;
+    fd = outFd;
+    ownFd = false;
+}
+
+void QifWriter::attach(QifBuffer *buffer)
+{
+    close();
+    error = false;
+    memory = buffer;
+}
+
+void QifWriter::writeAll(const char *s, size_t n)
+{
+    STATS_SCOPE(STAT_WRITE);
+
+    while (n && (false == error))
+    {
+        ssize_t w = ::write(fd, s, n);
+        if (w < 0)
+        {
+            if (EINTR == errno) continue;
+            error = true;
+            break;
+        }
+        s += w;
+        n -= w;
+    }
+}
+
+void QifWriter::write(const char *s, size_t n)
+{
+    if (memory)
+    {
+        STATS_SCOPE(STAT_WRITE);
+        memory->append(s, n);
+        return;
+    }
+    if (fd < 0) return;
+
+    if (pending.size() + n < QIF_WRITE_SIZE)
+    {
+        pending.append(s, n);
+        return;
+    }
+    flush();
+    if (n < QIF_WRITE_SIZE)
+    {
+        pending.append(s, n);
+    }
+    else
+    {
+        writeAll(s, n);
+    }
+}
+
+void QifWriter::flush()
+{
+    if (fd < 0) return;
+
+    writeAll(pending.data(), pending.size());
+    pending.clear();
+}
+
+bool QifWriter::close()
+{
+    memory = (QifBuffer *)(NULL);
+    if (fd < 0) return (false == error);
+
+    flush();
+    if (ownFd && (::close(fd) != 0)) error = true;
+    fd = -1;
+    ownFd = false;
+    return (false == error);
+}
@@ -0,0 +1,93 @@
+#ifndef __QIFWRITER_H__
+#define __QIFWRITER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+// QIF is written to the file in pieces at least this large
+#define QIF_WRITE_SIZE  (1024 * 1024)
+
+// Format cents as [-]dollars.cc, the same as printf("%.2lf") of
+// cents / 100.0 but exact and without going through printf.
+// buf needs room for QIF_CENTS_MAX characters.  No null is added.
+// Returns the number of characters written.
+#define QIF_CENTS_MAX   24
+int formatCents(char *buf, int64_t cents);
+
+// A reusable, growable buffer that QIF records are built in.
+// clear() keeps the memory so a buffer that is reused does not
+// allocate once it has reached its working size.
+class QifBuffer {
+private:
+    std::vector<char>   buf;
+    size_t              len;
+
+    void grow(size_t need);
+
+public:
+    QifBuffer() : len(0) {}
+
+    const char  *data() const   { return buf.data(); }
+    size_t      size() const    { return len; }
+    void        clear()         { len = 0; }
+    void        truncate(size_t n)  { if (n < len) len = n; }
+
+    // Make room for n more characters and return where they go.
+    // Follow with commit() of the number actually used.
+    char *reserve(size_t n)
+    {
+        if (len + n > buf.size()) grow(len + n);
+        return buf.data() + len;
+    }
+    void commit(size_t n)       { len += n; }
+
+    void append(const char *s, size_t n)
+    {
+        memcpy(reserve(n), s, n);
+        len += n;
+    }
+};
+
+// Writes QIF to a file with large write() calls.  Small writes are
+// collected until there is QIF_WRITE_SIZE to write; large ones are
+// written straight from the caller's memory.
+class QifWriter {
+private:
+    int         fd;
+    bool        ownFd;
+    QifBuffer   *memory;    // Written to instead of fd by attach(QifBuffer *)
+    QifBuffer   pending;
+    bool        error;
+
+    void writeAll(const char *s, size_t n);
+
+public:
+    QifWriter();
+    ~QifWriter();
+
+    // Create (or truncate) the file, or with append add to the end of
+    // it.  Returns false if it can not be opened.
+    bool open(const char *fileName, bool append = false);
+
+    // Write to an already open descriptor (e.g. stdout).  close()
+    // flushes it but leaves it open.
+    void attach(int fd);
+
+    // Append to a buffer instead of writing a file.  close() leaves
+    // the QIF in it.
+    void attach(QifBuffer *buffer);
+
+    void write(const char *s, size_t n);
+    void write(const QifBuffer &b)  { write(b.data(), b.size()); }
+    void flush();
+
+    // True once anything could not be written
+    bool failed() const             { return error; }
+
+    // Flush and close.  Returns false if anything could not be written.
+    bool close();
+};
+
+#endif
@@ -0,0 +1,319 @@
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <vector>
+#include <algorithm>
+#include "refDb.h"
+#include "csvParse.h"
+#include "csvInput.h"
+
+// Index of key in n records of recSize bytes in Eytzinger order,
+// or -1.  The key is padded to width and sits at the start of a record.
+static long eytzingerFind(const char *base, size_t recSize, size_t width, uint32_t n, const char *key)
+{
+    size_t k = 1;
+
+    // Go left when the record is not less than the key, right otherwise
+    while (k <= n)
+    {
+        k = 2 * k + (memcmp(base + (k - 1) * recSize, key, width) < 0);
+    }
+    // Back up past the right turns to the last left turn: the
+    // first record not less than the key
+    k >>= __builtin_ffsl(~k);
+    if (0 == k) return -1;
+    return (memcmp(base + (k - 1) * recSize, key, width) == 0) ? (long)(k - 1) : -1;
+}
+
+// Lay out sorted records in Eytzinger order.  Returns the next sorted index.
+template <typename rec_t>
+static size_t eytzingerLayout(const std::vector<rec_t> &sorted, std::vector<rec_t> &out, size_t i, size_t k)
+{
+    if (k <= sorted.size())
+    {
+        i = eytzingerLayout(sorted, out, i, 2 * k);
+        out[k - 1] = sorted[i++];
+        i = eytzingerLayout(sorted, out, i, 2 * k + 1);
+    }
+    return i;
+}
+
+RefDb::RefDb()
+    : map(nullptr)
+    , mapLen(0)
+    , header(nullptr)
+    , cusips(nullptr)
+    , symbols(nullptr)
+    , pool(nullptr)
+{
+}
+
+RefDb::~RefDb()
+{
+    close();
+}
+
+bool RefDb::open(const char *fileName, std::string &errMsg)
+{
+    struct stat st;
+
+    close();
+
+    int fd = ::open(fileName, O_RDONLY);
+    if (fd < 0)
+    {
+        errMsg = std::string("Error opening reference database ") + fileName;
+        return false;
+    }
+    if  (   (fstat(fd, &st) != 0)
+         || ((size_t)st.st_size < sizeof(refDbHeader_t))
+        )
+    {
+        ::close(fd);
+        errMsg = std::string("Not a reference database: ") + fileName;
+        return false;
+    }
+
+    void *p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (MAP_FAILED == p)
+    {
+        errMsg = std::string("Error mapping reference database ") + fileName;
+        return false;
+    }
+    map = p;
+    mapLen = st.st_size;
+
+    // Check everything once here so lookups need no checks
+    const refDbHeader_t *h = (const refDbHeader_t *)map;
+    size_t need =   sizeof(refDbHeader_t)
+                  + (size_t)h->numCusips * sizeof(refDbCusip_t)
+                  + (size_t)h->numSymbols * sizeof(refDbSymbol_t)
+                  + (size_t)h->poolSize;
+
+    if  (   (memcmp(h->magic, REFDB_MAGIC, sizeof(h->magic)) != 0)
+         || (REFDB_VERSION != h->version)
+         || (need != mapLen)
+        )
+    {
+        close();
+        errMsg = std::string("Not a reference database (or wrong version): ") + fileName;
+        return false;
+    }
+
+    cusips = (const refDbCusip_t *)(h + 1);
+    symbols = (const refDbSymbol_t *)(cusips + h->numCusips);
+    pool = (const char *)(symbols + h->numSymbols);
+
+    bool ok = (0 == h->poolSize) || ('\0' == pool[h->poolSize - 1]);
+    for (uint32_t i = 0; ok && (i < h->numCusips); i++)
+    {
+        ok = (cusips[i].nameOffset < h->poolSize);
+    }
+    for (uint32_t i = 0; ok && (i < h->numSymbols); i++)
+    {
+        ok = ('\0' == symbols[i].key[REFDB_SYMBOL_WIDTH - 1]);
+    }
+    if (false == ok)
+    {
+        close();
+        errMsg = std::string("Corrupt reference database ") + fileName;
+        return false;
+    }
+
+    header = h;
+    return true;
+}
+
+void RefDb::close()
+{
+    if (map)
+    {
+        munmap(map, mapLen);
+    }
+    map = nullptr;
+    mapLen = 0;
+    header = nullptr;
+    cusips = nullptr;
+    symbols = nullptr;
+    pool = nullptr;
+}
+
+const char *RefDb::lookupCusip(std::string_view cusip) const
+{
+    char key[REFDB_CUSIP_WIDTH] = {};
+
+    if ((nullptr == header) || (cusip.size() > sizeof(key))) return nullptr;
+    memcpy(key, cusip.data(), cusip.size());
+
+    long i = eytzingerFind((const char *)cusips, sizeof(refDbCusip_t), sizeof(key), header->numCusips, key);
+    return (i < 0) ? nullptr : pool + cusips[i].nameOffset;
+}
+
+const char *RefDb::lookupSymbol(std::string_view symbol) const
+{
+    char key[REFDB_SYMBOL_WIDTH] = {};
+
+    if ((nullptr == header) || (symbol.size() >= sizeof(key))) return nullptr;
+    memcpy(key, symbol.data(), symbol.size());
+
+    long i = eytzingerFind((const char *)symbols, sizeof(refDbSymbol_t), sizeof(key), header->numSymbols, key);
+    return (i < 0) ? nullptr : symbols[i].key;
+}
+
+// Remove blanks and then quotes around a field
+static void trimField(csvField_t *f)
+{
+    while (f->len && (f->ptr[0] == ' ' || f->ptr[0] == '\t'))
+    {
+        f->ptr++;
+        f->len--;
+    }
+    while (f->len && (f->ptr[f->len - 1] == ' ' || f->ptr[f->len - 1] == '\t'))
+    {
+        f->len--;
+    }
+    strip_quotes(f);
+}
+
+template <typename rec_t>
+static bool sortAndCheck(std::vector<rec_t> &recs, const char *what, std::string &errMsg)
+{
+    std::sort(recs.begin(), recs.end(), [](const rec_t &a, const rec_t &b)
+    {
+        return memcmp(a.key, b.key, sizeof(a.key)) < 0;
+    });
+    for (size_t i = 1; i < recs.size(); i++)
+    {
+        if (memcmp(recs[i - 1].key, recs[i].key, sizeof(recs[i].key)) == 0)
+        {
+            errMsg = std::string("Duplicate ") + what + " "
+                     + std::string(recs[i].key, strnlen(recs[i].key, sizeof(recs[i].key)));
+            return false;
+        }
+    }
+
+    std::vector<rec_t> sorted(recs);
+    eytzingerLayout(sorted, recs, 0, 1);
+    return true;
+}
+
+bool refDbCompile(const char *csvFileName
+                  , const char *dbFileName
+                  , uint32_t *numCusips
+                  , uint32_t *numSymbols
+                  , std::string &errMsg
+                 )
+{
+    CsvInput                    csvIn;
+    std::vector<refDbCusip_t>   cusips;
+    std::vector<refDbSymbol_t>  symbols;
+    std::string                 pool;
+    char                        *line;
+    size_t                      lineLen;
+    int                         lineNum = 0;
+    char                        msg[256];
+
+    if (false == csvIn.open(csvFileName))
+    {
+        errMsg = std::string("Error opening ") + csvFileName;
+        return false;
+    }
+
+    while (csvIn.nextLine(&line, &lineLen))
+    {
+        csvField_t  fields[4];
+
+        ++lineNum;
+        csvField_t whole = {line, lineLen};
+        trimField(&whole);
+        if ((0 == whole.len) || ('#' == whole.ptr[0])) continue;
+
+        int n = parse_csv_line(line, lineLen, fields, 4);
+        for (int i = 0; i < 4; i++) trimField(&fields[i]);
+
+        if ((n >= 3) && (2 == fields[0].len) && (strncasecmp(fields[0].ptr, "CD", 2) == 0))
+        {
+            refDbCusip_t rec = {};
+            if  (   (0 == fields[1].len)
+                 || (fields[1].len > sizeof(rec.key))
+                 || (0 == fields[2].len)
+                )
+            {
+                snprintf(msg, sizeof(msg), "%s line %d: expected CD,CUSIP,Bank Name", csvFileName, lineNum);
+                errMsg = msg;
+                return false;
+            }
+            memcpy(rec.key, fields[1].ptr, fields[1].len);
+            rec.nameOffset = (uint32_t)pool.size();
+            pool.append(fields[2].ptr, fields[2].len);
+            pool += '\0';
+            cusips.push_back(rec);
+        }
+        else if ((n >= 2) && (2 == fields[0].len) && (strncasecmp(fields[0].ptr, "MM", 2) == 0))
+        {
+            refDbSymbol_t rec = {};
+            if ((0 == fields[1].len) || (fields[1].len >= sizeof(rec.key)))
+            {
+                snprintf(msg, sizeof(msg), "%s line %d: expected MM,Symbol (up to %d characters)"
+                         , csvFileName, lineNum, REFDB_SYMBOL_WIDTH - 1);
+                errMsg = msg;
+                return false;
+            }
+            memcpy(rec.key, fields[1].ptr, fields[1].len);
+            symbols.push_back(rec);
+        }
+        else
+        {
+            snprintf(msg, sizeof(msg), "%s line %d: expected CD or MM entry", csvFileName, lineNum);
+            errMsg = msg;
+            return false;
+        }
+    }
+    csvIn.close();
+
+    if  (   (false == sortAndCheck(cusips, "CUSIP", errMsg))
+         || (false == sortAndCheck(symbols, "symbol", errMsg))
+        )
+    {
+        return false;
+    }
+
+    refDbHeader_t header = {};
+    memcpy(header.magic, REFDB_MAGIC, sizeof(header.magic));
+    header.version = REFDB_VERSION;
+    header.numCusips = (uint32_t)cusips.size();
+    header.numSymbols = (uint32_t)symbols.size();
+    header.poolSize = (uint32_t)pool.size();
+
+    // Write a new file and rename it over the old one, so a converter
+    // that has the old one mapped never sees a half written file
+    std::string tmpName = std::string(dbFileName) + ".tmp";
+    FILE *fp = fopen(tmpName.c_str(), "wb");
+    if ((FILE *)(NULL) == fp)
+    {
+        errMsg = std::string("Error opening output file ") + tmpName;
+        return false;
+    }
+    fwrite(&header, sizeof(header), 1, fp);
+    fwrite(cusips.data(), sizeof(refDbCusip_t), cusips.size(), fp);
+    fwrite(symbols.data(), sizeof(refDbSymbol_t), symbols.size(), fp);
+    fwrite(pool.data(), 1, pool.size(), fp);
+    bool ok = (0 == ferror(fp));
+    ok = (0 == fclose(fp)) && ok;
+    if  (   (false == ok)
+         || (rename(tmpName.c_str(), dbFileName) != 0)
+        )
+    {
+        unlink(tmpName.c_str());
+        errMsg = std::string("Error writing ") + dbFileName;
+        return false;
+    }
+
+    *numCusips = header.numCusips;
+    *numSymbols = header.numSymbols;
+    return true;
+}
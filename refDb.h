@@ -0,0 +1,91 @@
+#ifndef __REFDB_H__
+#define __REFDB_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+
+// A reference database of CD CUSIPs (with the issuing bank) and money
+// market symbols, compiled from a CSV by csv2qifRefDb and memory mapped
+// by the converter.  It replaces the tables built into CUSIPBankMap and
+// MoneyMarketSymbols, so the list can change without a rebuild.
+//
+// CSV input, one entry per line, quoted as usual:
+//      CD,06051XBM3,BANK OF AMERICA
+//      MM,SPAXX
+// Blank lines and lines starting with # are skipped.
+//
+// File layout, all little endian:
+//      refDbHeader_t
+//      numCusips   refDbCusip_t    keys in Eytzinger order
+//      numSymbols  refDbSymbol_t   keys in Eytzinger order
+//      poolSize    bytes of null terminated bank names
+// Keys are padded with nulls to their fixed width.  Symbols are at most
+// REFDB_SYMBOL_WIDTH - 1 characters, so a stored symbol is a C string.
+// Eytzinger order is the sorted keys laid out as a binary search tree
+// in breadth first order, so a search walks the array front to back.
+
+#define REFDB_MAGIC         "C2QREFDB"
+#define REFDB_VERSION       1
+#define REFDB_CUSIP_WIDTH   12
+#define REFDB_SYMBOL_WIDTH  8
+
+typedef struct
+{
+    char        magic[8];
+    uint32_t    version;
+    uint32_t    numCusips;
+    uint32_t    numSymbols;
+    uint32_t    poolSize;
+}   refDbHeader_t;
+
+typedef struct
+{
+    char        key[REFDB_CUSIP_WIDTH];
+    uint32_t    nameOffset;     // Into the string pool
+}   refDbCusip_t;
+
+typedef struct
+{
+    char        key[REFDB_SYMBOL_WIDTH];
+}   refDbSymbol_t;
+
+class RefDb {
+private:
+    void                    *map;
+    size_t                  mapLen;
+    const refDbHeader_t     *header;
+    const refDbCusip_t      *cusips;
+    const refDbSymbol_t     *symbols;
+    const char              *pool;
+
+public:
+    RefDb();
+    ~RefDb();
+
+    // Map and check a compiled file.  On failure errMsg says why.
+    bool open(const char *fileName, std::string &errMsg);
+    void close();
+
+    bool isOpen() const         { return (map != nullptr); }
+    uint32_t numCusips() const  { return header ? header->numCusips : 0; }
+    uint32_t numSymbols() const { return header ? header->numSymbols : 0; }
+
+    // Bank name for a CUSIP, or nullptr
+    const char *lookupCusip(std::string_view cusip) const;
+
+    // The symbol as stored (null terminated), or nullptr
+    const char *lookupSymbol(std::string_view symbol) const;
+};
+
+// Compile a reference CSV into a database file.  Returns false, with
+// errMsg set, on a bad line, a duplicate key or an I/O error.
+bool refDbCompile(const char *csvFileName
+                  , const char *dbFileName
+                  , uint32_t *numCusips
+                  , uint32_t *numSymbols
+                  , std::string &errMsg
+                 );
+
+#endif
@@ -0,0 +1,238 @@
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include "rowFilter.h"
+
+// s without the spaces around it
+static void trimSpaces(const char **s, size_t *n)
+{
+    while (*n && (' ' == (*s)[0]))
+    {
+        ++*s;
+        --*n;
+    }
+    while (*n && (' ' == (*s)[*n - 1])) --*n;
+}
+
+bool RowFilter::addSymbols(const char *list)
+{
+    const char *p = list;
+
+    while (true)
+    {
+        const char  *comma = strchr(p, ',');
+        size_t      n = comma ? (size_t)(comma - p) : strlen(p);
+
+        trimSpaces(&p, &n);
+        if (0 == n) return false;
+        symbols.push_back(std::string(p, n));
+        if ((const char *)(NULL) == comma) return true;
+        p = comma + 1;
+    }
+}
+
+bool RowFilter::symbolOk(const char *s, size_t n) const
+{
+    if (symbols.empty()) return true;
+
+    trimSpaces(&s, &n);
+    for (const std::string &sym : symbols)
+    {
+        if ((sym.size() == n) && (strncasecmp(sym.data(), s, n) == 0)) return true;
+    }
+    return false;
+}
+
+bool RowFilter::descOk(const char *s, size_t n) const
+{
+    if (descs.empty()) return true;
+
+    for (const std::string &text : descs)
+    {
+        size_t  len = text.size();
+        int     first = tolower((unsigned char)text[0]);
+
+        if (0 == len) return true;
+        for (size_t i = 0; i + len <= n; i++)
+        {
+            if  (   (tolower((unsigned char)s[i]) == first)
+                 && (strncasecmp(s + i, text.data(), len) == 0)
+                )
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool DateOrder::pastRange(const dateRange_t &range, int32_t date)
+{
+    if (0 == date) return false;
+
+    bool past = newestFirst ? (range.from && (date < range.from)) : (range.to && (date > range.to));
+    bool inOrder = (0 == last) || (date == last) || (newestFirst == (date < last));
+
+    last = date;
+    run = (past && inOrder) ? run + 1 : 0;
+    return (run >= DATE_ORDER_RUN);
+}
+
+#ifdef ROWFILTER_TEST
+
+// Known answers for the row tests, and for where DateOrder stops: never
+// before an in-range row, whatever is out of place before it.
+// Build with:
+//   g++ -O2 -DROWFILTER_TEST rowFilter.cpp transaction.cpp -o rowFilterTest
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static csvField_t field(const char *s)
+{
+    csvField_t f;
+
+    f.ptr = (char *)s;
+    f.len = strlen(s);
+    return f;
+}
+
+int main()
+{
+    // DateOrder sees head, then tailRows rows dated from tailDate on,
+    // tailStep apart.  Dates are only compared, so need not be real days.
+    const struct {
+        const char              *name;
+        bool                    newestFirst;
+        dateRange_t             range;
+        std::vector<int32_t>    head;
+        int                     tailRows;
+        int32_t                 tailDate;
+        int32_t                 tailStep;
+        int                     stopAt;     // Row pastRange() is true for, -1 for none
+    } orders[] = {
+        { "newest first, in order",         true,  {20250105, 0}, {20250110, 20250108, 20250106, 20250105}
+                                                , DATE_ORDER_RUN, 20250104, 0, 3 + DATE_ORDER_RUN },
+        { "newest first, backdated row",    true,  {20250105, 0}, {20250110, 20250103, 20250108, 20250107}
+                                                , DATE_ORDER_RUN, 20250101, 0, 3 + DATE_ORDER_RUN },
+        { "newest first, pending row",      true,  {20250105, 0}, {20241201, 20250110, 20250109}
+                                                , DATE_ORDER_RUN, 20250102, 0, 2 + DATE_ORDER_RUN },
+        { "newest first, run too short",    true,  {20250105, 0}, {20250110}
+                                                , DATE_ORDER_RUN - 1, 20250101, 0, -1 },
+        { "newest first, run broken",       true,  {20250105, 0}, {20250110, 20250101, 20250102, 20250101}
+                                                , DATE_ORDER_RUN - 2, 20250101, 0, -1 },
+        { "newest first, rows undated",     true,  {20250105, 0}, {20250106, 20250101, 0, 0}
+                                                , DATE_ORDER_RUN - 1, 20250101, 0, 3 + DATE_ORDER_RUN - 1 },
+        { "newest first, really oldest",    true,  {20250105, 0}, {}
+                                                , 2 * DATE_ORDER_RUN, 20240101, 1, -1 },
+        { "newest first, only an end",      true,  {0, 20250110}, {20250120}
+                                                , 2 * DATE_ORDER_RUN, 20250101, 0, -1 },
+        { "oldest first, in order",         false, {0, 20250110}, {20250101, 20250110}
+                                                , DATE_ORDER_RUN, 20250111, 1, 1 + DATE_ORDER_RUN },
+        { "oldest first, late posting",     false, {0, 20250110}, {20250108, 20250111, 20250110}
+                                                , DATE_ORDER_RUN, 20250115, 0, 2 + DATE_ORDER_RUN },
+    };
+    int failures = 0;
+
+    for (const auto &c : orders) {
+        std::vector<int32_t>    dates = c.head;
+        DateOrder               order(c.newestFirst);
+        int                     stopAt = -1;
+
+        for (int i = 0; i < c.tailRows; i++) {
+            dates.push_back(c.tailDate + i * c.tailStep);
+        }
+        for (size_t i = 0; i < dates.size(); i++) {
+            if (order.pastRange(c.range, dates[i])) {
+                stopAt = (int)i;
+                break;
+            }
+        }
+        if (stopAt != c.stopAt) {
+            printf("%s: stopped at row %d, expected %d\n", c.name, stopAt, c.stopAt);
+            ++failures;
+        }
+        for (size_t i = stopAt + 1; (stopAt >= 0) && (i < dates.size()); i++) {
+            if (inDateRange(c.range, dates[i])) {
+                printf("%s: row %zu, in range, not read\n", c.name, i);
+                ++failures;
+            }
+        }
+    }
+
+    // The row tests
+    {
+        RowFilter           filter;
+        TransactionBatch    batch;
+        const struct {
+            const char  *text;
+            bool        symbolOk;
+            bool        descOk;
+        } rows[] = {
+            { "SPAXX",                  true,   false },
+            { " fdrxx ",                true,   false },
+            { "FDRX",                   false,  false },
+            { "ACME",                   false,  false },
+            { "Blue Bottle COFFEE",     false,  true  },
+            { "coffeeshop",             false,  true  },
+            { "COFFE",                  false,  false },
+            { "Teahouse",               false,  true  },
+        };
+
+        if (filter.active() || (false == filter.symbolOk("ACME", 4)) || (false == filter.descOk("X", 1))) {
+            printf("An empty filter is not empty\n");
+            ++failures;
+        }
+        if (filter.addSymbols("ACME,,FOO") || filter.addSymbols(" ")) {
+            printf("An empty symbol was taken\n");
+            ++failures;
+        }
+
+        filter = RowFilter();
+        filter.setDateRange(dateRange_t{20250105, 20250110});
+        if  (   (false == filter.addSymbols("SPAXX, FDRXX"))
+             || (false == filter.active())
+            ) {
+            printf("Symbols not taken\n");
+            ++failures;
+        }
+        filter.addDesc("Coffee");
+        filter.addDesc("TEA");
+
+        for (const auto &r : rows) {
+            size_t n = strlen(r.text);
+
+            if  (   (filter.symbolOk(r.text, n) != r.symbolOk)
+                 || (filter.descOk(r.text, n) != r.descOk)
+                ) {
+                printf("\"%s\": symbol %d, description %d, expected %d, %d\n"
+                       , r.text, filter.symbolOk(r.text, n), filter.descOk(r.text, n), r.symbolOk, r.descOk);
+                ++failures;
+            }
+        }
+
+        if  (   filter.dateOk(20250104) || (false == filter.dateOk(20250105))
+             || (false == filter.dateOk(20250110)) || filter.dateOk(20250111) || filter.dateOk(0)
+            ) {
+            printf("Date range ends wrong\n");
+            ++failures;
+        }
+
+        // A converted transaction: its date and symbol, not its description
+        batch.add(field("01/06/2025"), 20250106, field("ACME"), field("SPAXX"), 100);
+        batch.add(field("01/06/2025"), 20250106, field("COFFEE"), field("ACME"), 100);
+        batch.add(field("01/12/2025"), 20250112, field("ACME"), field("FDRXX"), 100);
+        if  (   (false == filter.transactionOk(batch, batch[0]))
+             || filter.transactionOk(batch, batch[1])
+             || filter.transactionOk(batch, batch[2])
+            ) {
+            printf("transactionOk wrong\n");
+            ++failures;
+        }
+    }
+
+    printf("%d failures\n", failures);
+    return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif /* ROWFILTER_TEST */
@@ -0,0 +1,81 @@
+#ifndef __ROWFILTER_H__
+#define __ROWFILTER_H__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "csvParse.h"
+#include "transaction.h"
+
+// Which rows of an export to convert (--from, --to, --symbol, --desc).
+//
+// The converter tests a row against the filter as soon as it has split
+// the row into fields, on the date and symbol (and description) as the
+// export has them, so a row that is left out is never copied, rewritten
+// or written.  A row must pass every test that is set.
+
+class RowFilter {
+private:
+    dateRange_t                 range;
+    std::vector<std::string>    symbols;    // Any one of them, any case
+    std::vector<std::string>    descs;      // Contains any one, any case
+
+public:
+    RowFilter() : range{0, 0} {}
+
+    void setDateRange(const dateRange_t &r)     { range = r; }
+
+    // Add a comma separated list of symbols.  Returns false if one is
+    // empty.
+    bool addSymbols(const char *list);
+
+    // Add text that a description may contain
+    void addDesc(const char *text)              { descs.push_back(text); }
+
+    // True if any test is set
+    bool active() const     { return dateRangeLimited(range) || symbols.size() || descs.size(); }
+
+    const dateRange_t &dateRange() const        { return range; }
+    bool hasDescs() const                       { return descs.size() > 0; }
+
+    // The tests.  date is packed by parseDate(), 0 if it is not a date.
+    bool dateOk(int32_t date) const             { return inDateRange(range, date); }
+    bool symbolOk(const char *s, size_t n) const;
+    bool descOk(const char *s, size_t n) const;
+
+    // The date and symbol tests of a transaction already converted.
+    // Its description may have been rewritten, so that is not tested.
+    bool transactionOk(const TransactionBatch &batch, const transaction_t &t) const
+    {
+        std::string_view symbol = batch.symbol(t);
+        return dateOk(t.date) && symbolOk(symbol.data(), symbol.size());
+    }
+};
+
+// Watches the dates of a file's rows as they are read, to stop reading
+// once the rest of the file can only be outside a date range.  Exports
+// list transactions in date order, newest first (Fidelity, Schwab) or
+// oldest first (BoA, Citi), as formatDescriptor_t newestFirst says, but
+// not strictly: a pending row, or a posting backdated after later ones,
+// can be out of place.  So one row past the end of the range proves
+// nothing.  Reading stops only after DATE_ORDER_RUN rows in a row that
+// are all past the end of the range and each in order after the one
+// before.  A row in the range, or out of order, starts the count again.
+// Rows without a date are not counted either way.
+#define DATE_ORDER_RUN  64
+
+class DateOrder {
+private:
+    int32_t     last;
+    bool        newestFirst;
+    int         run;        // Rows past the range, in order, so far
+
+public:
+    explicit DateOrder(bool newest) : last(0), newestFirst(newest), run(0) {}
+
+    // Record the date of the next row (0 for a row without one).
+    // Returns true if the rows after it can only be outside range.
+    bool pastRange(const dateRange_t &range, int32_t date);
+};
+
+#endif
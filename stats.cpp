@@ -0,0 +1,113 @@
+#include <string.h>
+#include <inttypes.h>
+#include <sys/resource.h>
+#include <deque>
+#include <mutex>
+#include "stats.h"
+
+bool statsEnabled = false;
+
+// Every thread's stats.  They stay after the thread ends so they are
+// still there to add up.
+static std::deque<stats_t>  allStats;
+static std::mutex           allStatsMutex;
+
+static const char *stageNames[NUM_STAT_STAGES] =
+{
+    "read", "header", "parse", "map", "rewrite", "format", "write"
+};
+
+stats_t &threadStats()
+{
+    thread_local stats_t *mine = (stats_t *)(NULL);
+
+    if ((stats_t *)(NULL) == mine)
+    {
+        std::lock_guard<std::mutex> lock(allStatsMutex);
+        allStats.emplace_back();
+        mine = &allStats.back();
+        memset(mine, 0, sizeof(*mine));
+    }
+    return *mine;
+}
+
+void statsTotal(stats_t *total)
+{
+    std::lock_guard<std::mutex> lock(allStatsMutex);
+
+    memset(total, 0, sizeof(*total));
+    for (const stats_t &s : allStats)
+    {
+        for (int i = 0; i < NUM_STAT_STAGES; i++) total->ns[i] += s.ns[i];
+        for (int i = 0; i < NUM_STAT_COUNTERS; i++) total->count[i] += s.count[i];
+    }
+}
+
+long peakRssKb()
+{
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    return usage.ru_maxrss;     // KB on Linux
+}
+
+// Per second rate of n over ns, 0 if no time was taken
+static double rate(double n, uint64_t ns)
+{
+    return ns ? (n * 1e9 / ns) : 0.0;
+}
+
+void statsPrint(FILE *fp, const stats_t &total, double seconds, bool json)
+{
+    const uint64_t  *c = total.count;
+    double          mb = c[STAT_BYTES_IN] / (1024.0 * 1024.0);
+    double          rows = (double)c[STAT_ROWS];
+    bool            counted = true;
+
+#ifdef NO_STATS
+    counted = false;
+#endif
+
+    if (json)
+    {
+        fprintf(fp, "{\"seconds\": %.6f, \"peakRssKb\": %ld", seconds, peakRssKb());
+        if (counted)
+        {
+            fprintf(fp, ", \"bytesIn\": %" PRIu64 ", \"rows\": %" PRIu64 ", \"transactions\": %" PRIu64
+                    , c[STAT_BYTES_IN], c[STAT_ROWS], c[STAT_TRANSACTIONS]);
+            fprintf(fp, ", \"stages\": {");
+            for (int i = 0; i < NUM_STAT_STAGES; i++)
+            {
+                fprintf(fp, "%s\"%s\": {\"ms\": %.3f, \"rowsPerSec\": %.0f, \"mbPerSec\": %.1f}"
+                        , i ? ", " : "", stageNames[i], total.ns[i] / 1e6
+                        , rate(rows, total.ns[i]), rate(mb, total.ns[i]));
+            }
+            fprintf(fp, "}, \"skipped\": {\"processing\": %" PRIu64 ", \"date\": %" PRIu64 ", \"amount\": %" PRIu64 ", \"filter\": %" PRIu64 "}"
+                    , c[STAT_SKIP_PROCESSING], c[STAT_SKIP_DATE], c[STAT_SKIP_AMOUNT], c[STAT_SKIP_FILTER]);
+            fprintf(fp, ", \"lookups\": {\"mmHits\": %" PRIu64 ", \"mmMisses\": %" PRIu64
+                    ", \"cusipHits\": %" PRIu64 ", \"cusipMisses\": %" PRIu64 "}"
+                    , c[STAT_MM_HIT], c[STAT_MM_MISS], c[STAT_CUSIP_HIT], c[STAT_CUSIP_MISS]);
+        }
+        fprintf(fp, "}\n");
+        return;
+    }
+
+    fprintf(fp, "Stats: %.3f s, peak RSS %.1f MB\n", seconds, peakRssKb() / 1024.0);
+    if (false == counted)
+    {
+        fprintf(fp, "  (built with NO_STATS: no stage times or counts)\n");
+        return;
+    }
+    fprintf(fp, "  %" PRIu64 " rows, %" PRIu64 " transactions, %.1f MB\n"
+            , c[STAT_ROWS], c[STAT_TRANSACTIONS], mb);
+    fprintf(fp, "  %-10s %10s %14s %10s\n", "stage", "ms", "rows/s", "MB/s");
+    for (int i = 0; i < NUM_STAT_STAGES; i++)
+    {
+        fprintf(fp, "  %-10s %10.2f %14.0f %10.1f\n"
+                , stageNames[i], total.ns[i] / 1e6, rate(rows, total.ns[i]), rate(mb, total.ns[i]));
+    }
+    fprintf(fp, "  Skipped rows: %" PRIu64 " processing, %" PRIu64 " date, %" PRIu64 " amount, %" PRIu64 " filter\n"
+            , c[STAT_SKIP_PROCESSING], c[STAT_SKIP_DATE], c[STAT_SKIP_AMOUNT], c[STAT_SKIP_FILTER]);
+    fprintf(fp, "  Lookups: money market %" PRIu64 " hit %" PRIu64 " miss, CUSIP %" PRIu64 " hit %" PRIu64 " miss\n"
+            , c[STAT_MM_HIT], c[STAT_MM_MISS], c[STAT_CUSIP_HIT], c[STAT_CUSIP_MISS]);
+}
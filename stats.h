@@ -0,0 +1,102 @@
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <chrono>
+
+// Where conversion time goes, for --stats.
+//
+// Each thread adds to its own stats_t, so counting does not contend;
+// statsTotal() adds them up.  Nothing is timed or counted unless
+// statsEnabled is set, and with NO_STATS defined (make NO_STATS=1)
+// STATS_SCOPE(), STATS_COUNT() and STATS_ADD() are compiled out.
+typedef enum
+{
+    STAT_READ = 0,          // CsvInput::nextLine(), waiting for input included
+    STAT_HEADER,            // Finding the column header line (its reading included)
+    STAT_PARSE,             // parse_csv_line()
+    STAT_MAP,               // QifConverter::mapFields()
+    STAT_REWRITE,           // QifConverter::rewriteDescription()
+    STAT_FORMAT,            // QifConverter::writeRow()
+    STAT_WRITE,             // QifWriter writing the .qif
+    NUM_STAT_STAGES
+}   statStage_t;
+
+typedef enum
+{
+    STAT_BYTES_IN = 0,      // CSV read (decompressed)
+    STAT_ROWS,              // Lines after the column header line
+    STAT_TRANSACTIONS,      // QIF records written (before removing duplicates)
+    STAT_SKIP_PROCESSING,   // Skipped for the format's skip prefix (e.g. "Processing")
+    STAT_SKIP_DATE,         // Skipped for a date that is not a digit
+    STAT_SKIP_AMOUNT,       // Skipped for an empty amount
+    STAT_SKIP_FILTER,       // Left out by --from, --to, --symbol or --desc
+    STAT_MM_HIT,            // Money market symbol lookups
+    STAT_MM_MISS,
+    STAT_CUSIP_HIT,         // CD CUSIP lookups
+    STAT_CUSIP_MISS,
+    NUM_STAT_COUNTERS
+}   statCounter_t;
+
+typedef struct
+{
+    uint64_t    ns[NUM_STAT_STAGES];
+    uint64_t    count[NUM_STAT_COUNTERS];
+}   stats_t;
+
+extern bool statsEnabled;
+
+// This thread's stats
+stats_t &threadStats();
+
+// The stats of every thread so far, added up
+void statsTotal(stats_t *total);
+
+// Peak resident set size of the process, in KB
+long peakRssKb();
+
+// Print the report of total over seconds of wall time: a table, or
+// a JSON object if json.  Stage times are added up over threads, so
+// with -j they can exceed seconds.
+void statsPrint(FILE *fp, const stats_t &total, double seconds, bool json);
+
+// Adds the time from construction to destruction to a stage
+class StatsTimer {
+private:
+    int                                                 stage;      // -1 if not timing
+    std::chrono::steady_clock::time_point               start;
+
+public:
+    explicit StatsTimer(statStage_t s)
+        : stage(statsEnabled ? (int)s : -1)
+    {
+        if (stage >= 0) start = std::chrono::steady_clock::now();
+    }
+
+    ~StatsTimer()
+    {
+        if (stage < 0) return;
+        threadStats().ns[stage] += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    StatsTimer(const StatsTimer &) = delete;
+    StatsTimer &operator=(const StatsTimer &) = delete;
+};
+
+#define STATS_CONCAT2(a, b)     a##b
+#define STATS_CONCAT(a, b)      STATS_CONCAT2(a, b)
+
+#ifdef NO_STATS
+// Still one statement each, so "if (x) STATS_COUNT(c);" builds the same
+#define STATS_SCOPE(stage)      (void)0
+#define STATS_COUNT(counter)    do {} while (0)
+#define STATS_ADD(counter, n)   do {} while (0)
+#else
+// Time the rest of the enclosing block
+#define STATS_SCOPE(stage)      StatsTimer STATS_CONCAT(statsTimer, __LINE__)(stage)
+#define STATS_COUNT(counter)    do { if (statsEnabled) ++threadStats().count[counter]; } while (0)
+#define STATS_ADD(counter, n)   do { if (statsEnabled) threadStats().count[counter] += (n); } while (0)
+#endif
+
+#endif
@@ -0,0 +1,46 @@
+#include <signal.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "stopSignal.h"
+
+// Written to by the handler, read end polled
+static int stopPipe[2] = {-1, -1};
+
+static struct sigaction oldInt, oldTerm, oldPipe;
+
+static void onStopSignal(int)
+{
+    char    c = 0;
+    ssize_t n = ::write(stopPipe[1], &c, 1);
+
+    (void)n;
+}
+
+int stopSignalCatch()
+{
+    struct sigaction sa;
+
+    if (pipe2(stopPipe, O_CLOEXEC | O_NONBLOCK) != 0) return -1;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_flags = SA_RESTART;
+    sa.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &sa, &oldPipe);
+    sa.sa_handler = onStopSignal;
+    sigaction(SIGINT, &sa, &oldInt);
+    sigaction(SIGTERM, &sa, &oldTerm);
+    return stopPipe[0];
+}
+
+void stopSignalRelease()
+{
+    if (stopPipe[0] < 0) return;
+
+    sigaction(SIGINT, &oldInt, (struct sigaction *)(NULL));
+    sigaction(SIGTERM, &oldTerm, (struct sigaction *)(NULL));
+    sigaction(SIGPIPE, &oldPipe, (struct sigaction *)(NULL));
+    ::close(stopPipe[0]);
+    ::close(stopPipe[1]);
+    stopPipe[0] = stopPipe[1] = -1;
+}
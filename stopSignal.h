@@ -0,0 +1,17 @@
+#ifndef __STOPSIGNAL_H__
+#define __STOPSIGNAL_H__
+
+// Stopping the modes that run until told to (--serve, --watch).
+//
+// stopSignalCatch() catches SIGINT and SIGTERM, and returns a
+// descriptor that becomes readable once either arrives, to poll()
+// along with whatever the mode waits on.  Any thread may take the
+// signal.  SIGPIPE is ignored until stopSignalRelease(), so a peer
+// that goes away is a write error rather than the end of the process.
+// Returns -1 if the descriptor can not be made.
+int stopSignalCatch();
+
+// Put the signal handlers back and close the descriptor
+void stopSignalRelease();
+
+#endif
@@ -0,0 +1,328 @@
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <utility>
+#include "transaction.h"
+
+Arena::~Arena()
+{
+    for (char *b : blocks)
+    {
+        free(b);
+    }
+}
+
+char *Arena::alloc(size_t n)
+{
+    // Move on to the next block (reusing one from before reset() if it
+    // is big enough) when this one is full
+    while (current < blocks.size())
+    {
+        if (used + n <= blockSizes[current])
+        {
+            char *p = blocks[current] + used;
+            used += n;
+            return p;
+        }
+        ++current;
+        used = 0;
+    }
+
+    size_t size = (n > ARENA_BLOCK_SIZE) ? n : ARENA_BLOCK_SIZE;
+    char *b = (char *)malloc(size);
+    if ((char *)(NULL) == b) throw std::bad_alloc();
+
+    blocks.push_back(b);
+    blockSizes.push_back(size);
+    current = blocks.size() - 1;
+    used = n;
+    return b;
+}
+
+void Arena::reset()
+{
+    current = 0;
+    used = 0;
+}
+
+// FNV-1a
+static inline uint32_t stringHash(const char *s, size_t n)
+{
+    uint32_t h = 2166136261u;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        h ^= (uint8_t)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+StringPool::StringPool(Arena &arena)
+    : arena(arena)
+{
+    clear();
+}
+
+void StringPool::clear()
+{
+    strings.assign(1, std::string_view());
+    hashes.assign(1, 0);
+    table.assign(1024, 0);
+}
+
+void StringPool::grow()
+{
+    std::vector<uint32_t>   bigger(table.size() * 2, 0);
+    size_t                  mask = bigger.size() - 1;
+
+    for (uint32_t id = 1; id < strings.size(); id++)
+    {
+        size_t at = hashes[id] & mask;
+        while (bigger[at]) at = (at + 1) & mask;
+        bigger[at] = id;
+    }
+    table.swap(bigger);
+}
+
+uint32_t StringPool::intern(const char *s, size_t n)
+{
+    if (0 == n) return 0;
+
+    uint32_t    h = stringHash(s, n);
+    size_t      mask = table.size() - 1;
+    size_t      at = h & mask;
+
+    // Linear probing
+    while (table[at])
+    {
+        uint32_t id = table[at];
+        if ((hashes[id] == h) && (strings[id].size() == n) && (memcmp(strings[id].data(), s, n) == 0))
+        {
+            return id;
+        }
+        at = (at + 1) & mask;
+    }
+
+    char *copy = arena.alloc(n);
+    memcpy(copy, s, n);
+
+    uint32_t id = (uint32_t)strings.size();
+    strings.push_back(std::string_view(copy, n));
+    hashes.push_back(h);
+    table[at] = id;
+
+    // At most half full
+    if (strings.size() * 2 > table.size()) grow();
+    return id;
+}
+
+void StringPool::adopt(std::vector<std::string_view> &&byId)
+{
+    strings.swap(byId);
+    if (strings.empty()) strings.assign(1, std::string_view());
+    hashes.clear();
+    table.clear();
+}
+
+void TransactionBatch::add(const csvField_t &date
+                           , int32_t dateKey
+                           , const csvField_t &desc
+                           , const csvField_t &symbol
+                           , int64_t cents
+                          )
+{
+    transaction_t t;
+
+    t.date = dateKey;
+    t.dateText = pool.intern(date.ptr, date.len);
+    t.desc = pool.intern(desc.ptr, desc.len);
+    t.symbol = pool.intern(symbol.ptr, symbol.len);
+    t.cents = cents;
+    rows.push_back(t);
+}
+
+void TransactionBatch::adopt(std::vector<transaction_t> &&transactions
+                             , std::vector<std::string_view> &&strings
+                             , std::vector<uint64_t> &&fingerprints
+                            )
+{
+    rows.swap(transactions);
+    prints.swap(fingerprints);
+    pool.adopt(std::move(strings));
+}
+
+void TransactionBatch::clear()
+{
+    rows.clear();
+    prints.clear();
+    pool.clear();
+    arena.reset();
+}
+
+#ifdef TRANSACTION_TEST
+
+// Known answers for the arena, string interning and batches.
+// Build with:
+//   g++ -O2 -DTRANSACTION_TEST transaction.cpp -o transactionTest
+
+#include <stdio.h>
+#include <string>
+
+static csvField_t field(const char *s)
+{
+    csvField_t f;
+
+    f.ptr = (char *)s;
+    f.len = strlen(s);
+    return f;
+}
+
+int main()
+{
+    const struct {
+        const char  *text;
+        uint32_t    id;         // The id intern() gives, in this order
+    } interned[] = {
+        { "",               0 },
+        { "PAYROLL",        1 },
+        { "GROCERY",        2 },
+        { "PAYROLL",        1 },
+        { "payroll",        3 },
+        { "PAYROLL ",       4 },
+        { "GROCERY",        2 },
+        { "",               0 },
+    };
+    int failures = 0;
+
+    // Arena: small allocations share a block, big ones get their own,
+    // and reset() hands the same memory out again
+    {
+        Arena   arena;
+        char    *a = arena.alloc(10);
+        char    *b = arena.alloc(10);
+        char    *big = arena.alloc(ARENA_BLOCK_SIZE * 2);
+
+        memset(big, 'x', ARENA_BLOCK_SIZE * 2);
+        if (b != a + 10) {
+            printf("Arena: second allocation not after the first\n");
+            ++failures;
+        }
+        arena.reset();
+        if (arena.alloc(10) != a) {
+            printf("Arena: reset() did not reuse the first block\n");
+            ++failures;
+        }
+    }
+
+    // StringPool: the same bytes always give the same id, past growing
+    // the table
+    {
+        Arena       arena;
+        StringPool  pool(arena);
+
+        for (const auto &s : interned) {
+            uint32_t id = pool.intern(s.text, strlen(s.text));
+            if ((id != s.id) || (pool.get(id) != s.text)) {
+                printf("StringPool: \"%s\" is %u \"%.*s\", expected %u\n", s.text, id
+                       , (int)pool.get(id).size(), pool.get(id).data(), s.id);
+                ++failures;
+            }
+        }
+        if (pool.size() != 5) {
+            printf("StringPool: %zu strings, expected 5\n", pool.size());
+            ++failures;
+        }
+
+        std::vector<uint32_t> ids;
+        for (int i = 0; i < 5000; i++) {
+            std::string s = "desc " + std::to_string(i);
+            ids.push_back(pool.intern(s.data(), s.size()));
+        }
+        for (int i = 0; i < 5000; i++) {
+            std::string s = "desc " + std::to_string(i);
+            if ((pool.intern(s.data(), s.size()) != ids[i]) || (pool.get(ids[i]) != s)) {
+                printf("StringPool: \"%s\" changed id after growing\n", s.c_str());
+                ++failures;
+                break;
+            }
+        }
+        if (pool.intern("PAYROLL", 7) != 1) {
+            printf("StringPool: PAYROLL changed id after growing\n");
+            ++failures;
+        }
+
+        pool.clear();
+        if ((pool.size() != 1) || (pool.intern("GROCERY", 7) != 1)) {
+            printf("StringPool: clear() did not start again\n");
+            ++failures;
+        }
+    }
+
+    // TransactionBatch: what is added is what is read back, strings
+    // shared, and fingerprints kept alongside
+    {
+        TransactionBatch batch;
+
+        batch.add(field("01/02/2025"), 20250102, field("PAYROLL"), field(""), 250000);
+        batch.addFingerprint(11);
+        batch.add(field("01/03/2025"), 20250103, field("GROCERY"), field("SPAXX"), -12345);
+        batch.addFingerprint(22);
+        batch.add(field("01/03/2025"), 20250103, field("PAYROLL"), field("SPAXX"), 100);
+        batch.addFingerprint(33);
+        batch.add(field("Pending"), 0, field(""), field(""), 0);
+        batch.addFingerprint(44);
+
+        const transaction_t &t = batch[1];
+        if  (   (batch.size() != 4)
+             || (sizeof(transaction_t) != 24)
+             || (t.date != 20250103)
+             || (t.cents != -12345)
+             || (batch.dateText(t) != "01/03/2025")
+             || (batch.desc(t) != "GROCERY")
+             || (batch.symbol(t) != "SPAXX")
+             || (batch.symbol(batch[0]) != "")
+             || (batch[0].desc != batch[2].desc)
+             || (batch[1].dateText != batch[2].dateText)
+             || (batch[3].date != 0)
+             || (batch.dateText(batch[3]) != "Pending")
+            )
+        {
+            printf("TransactionBatch: rows not as added\n");
+            ++failures;
+        }
+        if ((false == batch.hasFingerprints()) || (batch.fingerprint(2) != 33)) {
+            printf("TransactionBatch: fingerprints not as added\n");
+            ++failures;
+        }
+
+        // Adopted rows use the strings given, by id
+        std::vector<transaction_t>      rows(1, t);
+        std::vector<std::string_view>   strings = { "", "A", "B", "C", "D" };
+        std::vector<uint64_t>           prints;
+        rows[0].desc = 4;
+        rows[0].symbol = 2;
+        batch.adopt(std::move(rows), std::move(strings), std::move(prints));
+        if  (   (batch.size() != 1)
+             || (batch.desc(batch[0]) != "D")
+             || (batch.symbol(batch[0]) != "B")
+             || batch.hasFingerprints()
+            )
+        {
+            printf("TransactionBatch: adopt() rows not as given\n");
+            ++failures;
+        }
+
+        batch.clear();
+        batch.add(field("01/04/2025"), 20250104, field("ATM"), field(""), -6000);
+        if ((batch.size() != 1) || (batch.desc(batch[0]) != "ATM") || (batch[0].desc != 2)) {
+            printf("TransactionBatch: clear() did not start again\n");
+            ++failures;
+        }
+    }
+
+    printf("%d failures\n", failures);
+    return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif /* TRANSACTION_TEST */
@@ -0,0 +1,157 @@
+#ifndef __TRANSACTION_H__
+#define __TRANSACTION_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string_view>
+#include <vector>
+#include "csvParse.h"
+
+// Converted transactions as data, for the stages that need more than
+// one line at a time (sorting, merging, totals, other output formats).
+//
+// A TransactionBatch holds the transactions of one file.  Each is a
+// small fixed size transaction_t; its strings are interned in the
+// batch's StringPool, so a description that repeats is stored once, and
+// the strings live in the batch's Arena, so adding a transaction does
+// not allocate once the batch has reached its working size.
+
+// Strings are allocated from blocks of this size (or larger, for a
+// string that does not fit)
+#define ARENA_BLOCK_SIZE    (64 * 1024)
+
+// A bump allocator.  Memory is given back all at once by reset(),
+// which keeps the blocks for reuse, or when the arena goes.
+class Arena {
+private:
+    std::vector<char *>     blocks;
+    std::vector<size_t>     blockSizes;
+    size_t                  current;    // Block being allocated from
+    size_t                  used;       // Bytes used of it
+
+public:
+    Arena() : current(0), used(0) {}
+    ~Arena();
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    // n bytes, not aligned (only strings are kept here)
+    char *alloc(size_t n);
+    void reset();
+};
+
+// Interns strings: the same bytes always give the same id, and the
+// bytes are stored once.  Id 0 is the empty string.
+class StringPool {
+private:
+    Arena                           &arena;
+    std::vector<std::string_view>   strings;    // By id
+    std::vector<uint32_t>           table;      // Open addressing: id, 0 if empty
+    std::vector<uint32_t>           hashes;     // Hash of each id's string
+
+    void grow();
+
+public:
+    explicit StringPool(Arena &arena);
+
+    uint32_t intern(const char *s, size_t n);
+    std::string_view get(uint32_t id) const  { return strings[id]; }
+    size_t size() const                     { return strings.size(); }
+    void clear();
+
+    // Use strings kept elsewhere (by id, id 0 the empty string) in place
+    // of interned ones, e.g. those of a mapped TransactionCache.  They
+    // must stay as long as the pool uses them.  Nothing may be interned
+    // afterwards, until clear().
+    void adopt(std::vector<std::string_view> &&byId);
+};
+
+// One transaction.  24 bytes.
+typedef struct
+{
+    int32_t     date;       // yyyymmdd, 0 if the date could not be read
+    uint32_t    dateText;   // The date as in the export (StringPool id)
+    uint32_t    desc;       // Description as written to QIF (StringPool id)
+    uint32_t    symbol;     // StringPool id, 0 if none
+    int64_t     cents;      // Withdrawals negative
+}   transaction_t;
+
+// Dates to keep, yyyymmdd, both ends included; 0 for no limit.  A
+// range with either limit leaves out rows without a date.
+typedef struct
+{
+    int32_t     from;
+    int32_t     to;
+}   dateRange_t;
+
+static inline bool dateRangeLimited(const dateRange_t &range)
+{
+    return (range.from || range.to);
+}
+
+static inline bool inDateRange(const dateRange_t &range, int32_t date)
+{
+    if (false == dateRangeLimited(range)) return true;
+    return date && (date >= range.from) && ((0 == range.to) || (date <= range.to));
+}
+
+class TransactionBatch {
+private:
+    Arena                       arena;
+    StringPool                  pool;
+    std::vector<transaction_t>  rows;
+    std::vector<uint64_t>       prints;     // Dedup fingerprints by row, if kept
+
+public:
+    TransactionBatch() : pool(arena) {}
+
+    TransactionBatch(const TransactionBatch &) = delete;
+    TransactionBatch &operator=(const TransactionBatch &) = delete;
+
+    // dateKey is date packed by parseDate()
+    void add(const csvField_t &date
+             , int32_t dateKey
+             , const csvField_t &desc
+             , const csvField_t &symbol
+             , int64_t cents
+            );
+
+    size_t size() const                                 { return rows.size(); }
+    const transaction_t &operator[](size_t i) const     { return rows[i]; }
+    std::vector<transaction_t>::const_iterator begin() const    { return rows.begin(); }
+    std::vector<transaction_t>::const_iterator end() const      { return rows.end(); }
+
+    // The rows themselves, for stages that reorder them
+    std::vector<transaction_t> &transactions()          { return rows; }
+
+    // The DedupIndex::fingerprint() of the row just add()ed, taken from
+    // the row as the export has it.  A batch has one for every row or
+    // none; stages that reorder rows do not keep them.
+    void addFingerprint(uint64_t fp)                    { prints.push_back(fp); }
+    bool hasFingerprints() const                        { return prints.size() == rows.size(); }
+    uint64_t fingerprint(size_t i) const                { return prints[i]; }
+    const std::vector<uint64_t> &fingerprints() const   { return prints; }
+
+    // Take rows whose string ids are indexes into strings, kept
+    // elsewhere (see StringPool::adopt()), with their fingerprints (or
+    // none).  Nothing may be add()ed afterwards, until clear().
+    void adopt(std::vector<transaction_t> &&rows
+               , std::vector<std::string_view> &&strings
+               , std::vector<uint64_t> &&fingerprints
+              );
+
+    const StringPool &strings() const                   { return pool; }
+    std::string_view dateText(const transaction_t &t) const { return pool.get(t.dateText); }
+    std::string_view desc(const transaction_t &t) const     { return pool.get(t.desc); }
+    std::string_view symbol(const transaction_t &t) const   { return pool.get(t.symbol); }
+
+    // Forget the transactions, keeping the memory
+    void clear();
+};
+
+// Transactions as parsed, a batch per block of the file
+typedef std::vector<std::unique_ptr<TransactionBatch>> batchList_t;
+
+#endif
@@ -0,0 +1,673 @@
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <utility>
+#include <vector>
+#include "transactionCache.h"
+
+// 64 bit hash of n bytes, 32 at a time in four independent lanes so it
+// runs at memory speed
+static uint64_t hashBytes(const char *p, size_t n, uint64_t seed)
+{
+    const uint64_t  k = 0x9e3779b97f4a7c15ull;
+    uint64_t        lane[4] = {seed ^ n, seed + k, seed - k, ~seed};
+    uint64_t        w;
+
+    auto mix = [](uint64_t h, uint64_t v)
+    {
+        h = (h ^ v) * 0xff51afd7ed558ccdull;
+        return h ^ (h >> 29);
+    };
+
+    while (n >= 32)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            memcpy(&w, p + 8 * i, 8);
+            lane[i] = mix(lane[i], w);
+        }
+        p += 32;
+        n -= 32;
+    }
+    while (n >= 8)
+    {
+        memcpy(&w, p, 8);
+        lane[0] = mix(lane[0], w);
+        p += 8;
+        n -= 8;
+    }
+    w = 0;
+    memcpy(&w, p, n);
+    lane[1] = mix(lane[1], w);
+
+    return mix(mix(mix(lane[0], lane[1]), lane[2]), lane[3]);
+}
+
+// Hash of a whole file, and its stat
+static bool hashFile(const char *fileName, uint64_t seed, struct stat *st, uint64_t *hash)
+{
+    int fd = open(fileName, O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) return false;
+    if ((fstat(fd, st) != 0) || (false == S_ISREG(st->st_mode)))
+    {
+        close(fd);
+        return false;
+    }
+    if (0 == st->st_size)
+    {
+        close(fd);
+        *hash = hashBytes("", 0, seed);
+        return true;
+    }
+
+    void *p = mmap(NULL, st->st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (MAP_FAILED == p) return false;
+    madvise(p, st->st_size, MADV_SEQUENTIAL);
+    *hash = hashBytes((const char *)p, st->st_size, seed);
+    munmap(p, st->st_size);
+    return true;
+}
+
+bool txnCacheConfigHash(const char *refDbFileName, const char *rulesFileName, uint64_t *configHash)
+{
+    struct stat st;
+    uint64_t    h = TXN_CACHE_VERSION;
+
+    if (refDbFileName && (false == hashFile(refDbFileName, h, &st, &h))) return false;
+    h = hashBytes("rules", 5, h);
+    if (rulesFileName && (false == hashFile(rulesFileName, h, &st, &h))) return false;
+    *configHash = h;
+    return true;
+}
+
+bool txnCacheKey(const char *csvFileName, bankFormat_t bankFormat, uint64_t configHash, txnCacheKey_t *key)
+{
+    struct stat st;
+
+    memset(key, 0, sizeof(*key));
+    if (false == hashFile(csvFileName, 0, &st, &key->sourceHash)) return false;
+    key->bankFormat = (uint32_t)bankFormat;
+    key->sourceSize = st.st_size;
+    key->sourceMtimeNs = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+    key->configHash = configHash;
+    return true;
+}
+
+static bool sameKey(const txnCacheKey_t &a, const txnCacheKey_t &b)
+{
+    return  (a.bankFormat == b.bankFormat)
+         && (a.sourceSize == b.sourceSize)
+         && (a.sourceMtimeNs == b.sourceMtimeNs)
+         && (a.sourceHash == b.sourceHash)
+         && (a.configHash == b.configHash);
+}
+
+std::string txnCacheFileName(const char *csvFileName)
+{
+    return std::string(csvFileName) + TXN_CACHE_EXTENSION;
+}
+
+static inline size_t numZones(uint64_t numRows)
+{
+    return (numRows + TXN_CACHE_ZONE_ROWS - 1) / TXN_CACHE_ZONE_ROWS;
+}
+
+bool txnCacheWrite(const char *fileName, const txnCacheKey_t &key, const batchList_t &batches, std::string &errMsg)
+{
+    std::vector<int64_t>            cents;
+    std::vector<uint64_t>           prints;
+    std::vector<txnCacheZone_t>     zones;
+    std::vector<int32_t>            dates;
+    std::vector<uint32_t>           descs;
+    std::vector<uint32_t>           symbols;
+    std::vector<uint32_t>           dateTexts;
+    std::vector<uint32_t>           offsets(2, 0);     // Id 0 is empty
+    std::vector<uint32_t>           remap;
+    Arena                           arena;
+    StringPool                      strings(arena);
+    txnCacheHeader_t                header;
+
+    memset(&header, 0, sizeof(header));
+
+    // The batches' strings, interned again in one pool
+    for (const auto &batch : batches)
+    {
+        const StringPool &pool = batch->strings();
+
+        if (false == batch->hasFingerprints())
+        {
+            errMsg = std::string("Transactions without fingerprints can not be cached in ") + fileName;
+            return false;
+        }
+        remap.resize(pool.size());
+        for (uint32_t id = 0; id < pool.size(); id++)
+        {
+            std::string_view s = pool.get(id);
+            remap[id] = strings.intern(s.data(), s.size());
+        }
+        for (size_t i = 0; i < batch->size(); i++)
+        {
+            const transaction_t &t = (*batch)[i];
+
+            if (0 == (dates.size() % TXN_CACHE_ZONE_ROWS)) zones.push_back(txnCacheZone_t{0, 0});
+
+            txnCacheZone_t &z = zones.back();
+            if (t.date)
+            {
+                if ((0 == z.minDate) || (t.date < z.minDate)) z.minDate = t.date;
+                if (t.date > z.maxDate) z.maxDate = t.date;
+                if ((0 == header.firstDate) || (t.date < header.firstDate)) header.firstDate = t.date;
+                if (t.date > header.lastDate) header.lastDate = t.date;
+            }
+            cents.push_back(t.cents);
+            prints.push_back(batch->fingerprint(i));
+            dates.push_back(t.date);
+            descs.push_back(remap[t.desc]);
+            symbols.push_back(remap[t.symbol]);
+            dateTexts.push_back(remap[t.dateText]);
+        }
+    }
+
+    std::string poolBytes;
+    for (uint32_t id = 1; id < strings.size(); id++)
+    {
+        std::string_view s = strings.get(id);
+
+        if (poolBytes.size() + s.size() > UINT32_MAX)
+        {
+            errMsg = std::string("Too many strings to cache in ") + fileName;
+            return false;
+        }
+        poolBytes.append(s.data(), s.size());
+        offsets.push_back((uint32_t)poolBytes.size());
+    }
+
+    memcpy(header.magic, TXN_CACHE_MAGIC, sizeof(header.magic));
+    header.version = TXN_CACHE_VERSION;
+    header.numStrings = (uint32_t)strings.size();
+    header.key = key;
+    header.numRows = dates.size();
+    header.poolSize = (uint32_t)poolBytes.size();
+
+    std::string tmpName = std::string(fileName) + ".tmp";
+    FILE        *fp = fopen(tmpName.c_str(), "wb");
+
+    if ((FILE *)(NULL) == fp)
+    {
+        errMsg = std::string("Error creating ") + tmpName;
+        return false;
+    }
+
+    size_t n = header.numRows;
+    bool ok =   (fwrite(&header, sizeof(header), 1, fp) == 1)
+             && (fwrite(cents.data(), sizeof(int64_t), n, fp) == n)
+             && (fwrite(prints.data(), sizeof(uint64_t), n, fp) == n)
+             && (fwrite(zones.data(), sizeof(txnCacheZone_t), zones.size(), fp) == zones.size())
+             && (fwrite(dates.data(), sizeof(int32_t), n, fp) == n)
+             && (fwrite(descs.data(), sizeof(uint32_t), n, fp) == n)
+             && (fwrite(symbols.data(), sizeof(uint32_t), n, fp) == n)
+             && (fwrite(dateTexts.data(), sizeof(uint32_t), n, fp) == n)
+             && (fwrite(offsets.data(), sizeof(uint32_t), offsets.size(), fp) == offsets.size())
+             && (fwrite(poolBytes.data(), 1, poolBytes.size(), fp) == poolBytes.size());
+
+    if ((fclose(fp) != 0) || (false == ok) || (rename(tmpName.c_str(), fileName) != 0))
+    {
+        unlink(tmpName.c_str());
+        errMsg = std::string("Error writing ") + fileName;
+        return false;
+    }
+    return true;
+}
+
+TransactionCache::TransactionCache()
+    : map(nullptr)
+    , mapLen(0)
+    , header(nullptr)
+    , cents(nullptr)
+    , prints(nullptr)
+    , zones(nullptr)
+    , dates(nullptr)
+    , descs(nullptr)
+    , symbols(nullptr)
+    , dateTexts(nullptr)
+    , offsets(nullptr)
+    , pool(nullptr)
+{
+}
+
+TransactionCache::~TransactionCache()
+{
+    close();
+}
+
+void TransactionCache::close()
+{
+    if (map) munmap(map, mapLen);
+    map = nullptr;
+    mapLen = 0;
+    header = nullptr;
+}
+
+bool TransactionCache::open(const char *fileName, const txnCacheKey_t &key)
+{
+    struct stat st;
+
+    close();
+
+    int fd = ::open(fileName, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    if ((fstat(fd, &st) != 0) || ((size_t)st.st_size < sizeof(txnCacheHeader_t)))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void *p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (MAP_FAILED == p) return false;
+    map = p;
+    mapLen = st.st_size;
+
+    // Check the sizes once here so load() only checks string ids
+    const txnCacheHeader_t *h = (const txnCacheHeader_t *)map;
+    size_t need =   sizeof(txnCacheHeader_t)
+                  + h->numRows * (sizeof(int64_t) + sizeof(uint64_t) + sizeof(int32_t) + 3 * sizeof(uint32_t))
+                  + numZones(h->numRows) * sizeof(txnCacheZone_t)
+                  + ((size_t)h->numStrings + 1) * sizeof(uint32_t)
+                  + h->poolSize;
+
+    if  (   (memcmp(h->magic, TXN_CACHE_MAGIC, sizeof(h->magic)) != 0)
+         || (TXN_CACHE_VERSION != h->version)
+         || (h->numRows > mapLen)
+         || (h->numStrings < 1)
+         || (need != mapLen)
+         || (false == sameKey(h->key, key))
+        )
+    {
+        close();
+        return false;
+    }
+
+    header = h;
+    cents = (const int64_t *)(h + 1);
+    prints = (const uint64_t *)(cents + h->numRows);
+    zones = (const txnCacheZone_t *)(prints + h->numRows);
+    dates = (const int32_t *)(zones + numZones(h->numRows));
+    descs = (const uint32_t *)(dates + h->numRows);
+    symbols = descs + h->numRows;
+    dateTexts = symbols + h->numRows;
+    offsets = dateTexts + h->numRows;
+    pool = (const char *)(offsets + h->numStrings + 1);
+
+    bool ok = (0 == offsets[0]) && (h->poolSize == offsets[h->numStrings]);
+    for (uint32_t i = 0; ok && (i < h->numStrings); i++)
+    {
+        ok = (offsets[i] <= offsets[i + 1]);
+    }
+    if (false == ok)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool TransactionCache::load(const dateRange_t &range, TransactionBatch &batch, size_t *numZonesRead) const
+{
+    std::vector<transaction_t>      rows;
+    std::vector<uint64_t>           fingerprints;
+    std::vector<std::string_view>   strings;
+    bool                            limited = dateRangeLimited(range);
+    size_t                          read = 0;
+
+    batch.clear();
+    if ((const txnCacheHeader_t *)(NULL) == header) return false;
+
+    for (size_t z = 0; z < numZones(header->numRows); z++)
+    {
+        size_t first = z * TXN_CACHE_ZONE_ROWS;
+        size_t last = first + TXN_CACHE_ZONE_ROWS;
+
+        if  (   limited
+             && (   (0 == zones[z].maxDate)
+                 || (zones[z].maxDate < range.from)
+                 || (range.to && (zones[z].minDate > range.to))
+                )
+            )
+        {
+            continue;
+        }
+        ++read;
+        if (last > header->numRows) last = header->numRows;
+        for (size_t i = first; i < last; i++)
+        {
+            transaction_t t;
+
+            if (limited && (false == inDateRange(range, dates[i]))) continue;
+            t.date = dates[i];
+            t.desc = descs[i];
+            t.symbol = symbols[i];
+            t.dateText = dateTexts[i];
+            t.cents = cents[i];
+            if  (   (t.desc >= header->numStrings)
+                 || (t.symbol >= header->numStrings)
+                 || (t.dateText >= header->numStrings)
+                )
+            {
+                return false;
+            }
+            rows.push_back(t);
+            fingerprints.push_back(prints[i]);
+        }
+    }
+
+    strings.reserve(header->numStrings);
+    for (uint32_t i = 0; i < header->numStrings; i++)
+    {
+        strings.push_back(std::string_view(pool + offsets[i], offsets[i + 1] - offsets[i]));
+    }
+    batch.adopt(std::move(rows), std::move(strings), std::move(fingerprints));
+    if (numZonesRead) *numZonesRead = read;
+    return true;
+}
+
+#ifdef TRANSACTIONCACHE_TEST
+
+// Known answers for the cache: a cache made with one key is not opened
+// with any other, or once the CSV it was made from or the rules change,
+// or when the file is damaged; and a date range reads only the zones it
+// needs, giving the rows as they were written.
+// Build with:
+//   g++ -O2 -DTRANSACTIONCACHE_TEST transactionCache.cpp transaction.cpp descRules.cpp csvParse.cpp -o transactionCacheTest
+
+#include <stdlib.h>
+#include <memory>
+#include <sys/time.h>
+#include "descRules.h"
+
+// The rows written: zone 0 in January, zone 1 in February, zone 2 (not
+// full) in March with one row without a date
+#define TEST_ROWS   (2 * TXN_CACHE_ZONE_ROWS + 100)
+
+static int32_t testDate(size_t i)
+{
+    if (i == TEST_ROWS - 1) return 0;
+    return 20240101 + (int32_t)(i / TXN_CACHE_ZONE_ROWS) * 100 + (int32_t)(i % TXN_CACHE_ZONE_ROWS) % 28;
+}
+
+static csvField_t field(const char *s)
+{
+    csvField_t f;
+
+    f.ptr = (char *)s;
+    f.len = strlen(s);
+    return f;
+}
+
+static bool writeText(const std::string &fileName, const char *text)
+{
+    FILE *fp = fopen(fileName.c_str(), "w");
+
+    if ((FILE *)(NULL) == fp) return false;
+    fputs(text, fp);
+    return (0 == fclose(fp));
+}
+
+// The batches written: two, so their strings are interned again in one
+// pool
+static void makeBatches(batchList_t &batches)
+{
+    static const char *descs[] = {"PAYROLL", "GROCERY", "ATM", "UTILITY CO"};
+    static const char *symbols[] = {"", "SPAXX"};
+
+    for (int b = 0; b < 2; b++) {
+        batches.emplace_back(new TransactionBatch);
+    }
+    for (size_t i = 0; i < TEST_ROWS; i++) {
+        TransactionBatch &batch = *batches[(i < TEST_ROWS / 3) ? 0 : 1];
+        char dateText[16];
+
+        snprintf(dateText, sizeof(dateText), "%d", (int)testDate(i));
+        batch.add(field(testDate(i) ? dateText : "Total"), testDate(i)
+                  , field(descs[i % 4]), field(symbols[i % 2]), (int64_t)i * 7 - 500);
+        batch.addFingerprint(0x9e3779b97f4a7c15ull * (i + 1));
+    }
+}
+
+int main()
+{
+    const struct {
+        const char  *name;
+        dateRange_t range;
+        size_t      numRows;
+        size_t      numZones;       // Zones read
+    } ranges[] = {
+        { "everything",         {0, 0},                     TEST_ROWS,                  3 },
+        { "February",           {20240201, 20240229},       TXN_CACHE_ZONE_ROWS,        1 },
+        { "February 15 on",     {20240215, 0},              0,                          2 },
+        { "mid Jan to mid Feb", {20240115, 20240214},       0,                          2 },
+        { "March 28 on",        {20240328, 0},              0,                          1 },
+        { "before",             {0, 20231231},              0,                          0 },
+        { "after",              {20250101, 0},              0,                          0 },
+    };
+    const struct {
+        const char  *name;
+        int         field;          // Of the key, to change
+    } keys[] = {
+        { "bank format",        0 },
+        { "size",               1 },
+        { "mtime",              2 },
+        { "hash",               3 },
+        { "config",             4 },
+    };
+    char            dirTemplate[] = "/tmp/transactionCacheTestXXXXXX";
+    char            *dir = mkdtemp(dirTemplate);
+    batchList_t     batches;
+    txnCacheKey_t   key;
+    uint64_t        configHash;
+    std::string     errMsg;
+    int             failures = 0;
+
+    if ((char *)(NULL) == dir) {
+        printf("Can not make a directory in /tmp\n");
+        return EXIT_FAILURE;
+    }
+
+    std::string csvName = std::string(dir) + "/in.csv";
+    std::string rulesName = std::string(dir) + "/rules";
+    std::string cacheName = txnCacheFileName(csvName.c_str());
+
+    makeBatches(batches);
+    if  (   (false == writeText(csvName, "Date,Description,Amount,Running Bal.\n01/02/2025,PAYROLL,1.00,1.00\n"))
+         || (false == writeText(rulesName, "mm,PAYROLL,SALARY\n"))
+         || (false == txnCacheConfigHash((const char *)(NULL), rulesName.c_str(), &configHash))
+         || (false == txnCacheKey(csvName.c_str(), BOA_FORMAT, configHash, &key))
+         || (false == txnCacheWrite(cacheName.c_str(), key, batches, errMsg))
+        ) {
+        printf("Can not write the cache: %s\n", errMsg.c_str());
+        return EXIT_FAILURE;
+    }
+
+    // The rules fixture is a real rules file
+    {
+        DescriptionRules rules;
+
+        if (false == rules.load(rulesName.c_str(), errMsg)) {
+            printf("Rules file: %s\n", errMsg.c_str());
+            ++failures;
+        }
+    }
+
+    // Rows and zones read by date range
+    for (const auto &r : ranges) {
+        TransactionCache    cache;
+        TransactionBatch    batch;
+        size_t              numZones = 99;
+        size_t              expected = r.numRows;
+
+        // Ranges whose row count is easier counted than written down
+        if (0 == expected) {
+            for (size_t i = 0; i < TEST_ROWS; i++) {
+                if (inDateRange(r.range, testDate(i))) ++expected;
+            }
+        }
+        if (false == cache.open(cacheName.c_str(), key)) {
+            printf("%s: can not open the cache\n", r.name);
+            ++failures;
+            continue;
+        }
+        if (false == cache.load(r.range, batch, &numZones)) {
+            printf("%s: can not load the cache\n", r.name);
+            ++failures;
+            continue;
+        }
+        if ((batch.size() != expected) || (numZones != r.numZones)) {
+            printf("%s: %zu rows, %zu zones read, expected %zu, %zu\n"
+                   , r.name, batch.size(), numZones, expected, r.numZones);
+            ++failures;
+        }
+        if (false == batch.hasFingerprints()) {
+            printf("%s: no fingerprints\n", r.name);
+            ++failures;
+        }
+    }
+
+    // Everything comes back as written
+    {
+        TransactionCache    cache;
+        TransactionBatch    batch;
+        size_t              i = 0;
+
+        if (cache.open(cacheName.c_str(), key) && cache.load(dateRange_t{0, 0}, batch, (size_t *)(NULL))) {
+            for (const auto &b : batches) {
+                for (size_t j = 0; (j < b->size()) && (i < batch.size()); j++, i++) {
+                    const transaction_t &t = (*b)[j];
+                    const transaction_t &c = batch[i];
+
+                    if  (   (t.date != c.date)
+                         || (t.cents != c.cents)
+                         || (b->desc(t) != batch.desc(c))
+                         || (b->symbol(t) != batch.symbol(c))
+                         || (b->dateText(t) != batch.dateText(c))
+                         || (b->fingerprint(j) != batch.fingerprint(i))
+                        ) {
+                        printf("Row %zu differs\n", i);
+                        ++failures;
+                        break;
+                    }
+                }
+            }
+        }
+        if (i != TEST_ROWS) {
+            printf("%zu rows read back, expected %d\n", i, TEST_ROWS);
+            ++failures;
+        }
+    }
+
+    // Any part of the key changed
+    for (const auto &k : keys) {
+        TransactionCache    cache;
+        txnCacheKey_t       other = key;
+
+        switch (k.field) {
+            case 0: other.bankFormat = FIDELITY_FORMAT;     break;
+            case 1: other.sourceSize += 1;                  break;
+            case 2: other.sourceMtimeNs += 1;               break;
+            case 3: other.sourceHash ^= 1;                  break;
+            case 4: other.configHash ^= 1;                  break;
+        }
+        if (cache.open(cacheName.c_str(), other)) {
+            printf("Opened with another %s\n", k.name);
+            ++failures;
+        }
+    }
+
+    // The key of a CSV touched, of one changed in place (same size and
+    // modification time), and with the rules changed
+    {
+        struct timeval  times[2] = {{1700000000, 0}, {1700000000, 0}};
+        txnCacheKey_t   touched;
+        txnCacheKey_t   changed;
+        txnCacheKey_t   ruled;
+        uint64_t        otherConfig;
+
+        utimes(csvName.c_str(), times);
+        txnCacheKey(csvName.c_str(), BOA_FORMAT, configHash, &touched);
+        writeText(csvName, "Date,Description,Amount,Running Bal.\n01/02/2025,PAYROLL,2.00,1.00\n");
+        utimes(csvName.c_str(), times);
+        txnCacheKey(csvName.c_str(), BOA_FORMAT, configHash, &changed);
+        writeText(rulesName, "mm,PAYROLL,WAGES\n");
+        txnCacheConfigHash((const char *)(NULL), rulesName.c_str(), &otherConfig);
+        txnCacheKey(csvName.c_str(), BOA_FORMAT, otherConfig, &ruled);
+
+        if (sameKey(touched, key) || (touched.sourceHash != key.sourceHash)) {
+            printf("Touching the CSV: the key is the same, or its hash is not\n");
+            ++failures;
+        }
+        if (sameKey(changed, touched) || (changed.sourceMtimeNs != touched.sourceMtimeNs)) {
+            printf("Changing the CSV in place: the key is the same\n");
+            ++failures;
+        }
+        if (sameKey(ruled, changed) || (ruled.configHash == changed.configHash)) {
+            printf("Changing the rules: the key is the same\n");
+            ++failures;
+        }
+    }
+
+    // Damaged: cut short, wrong magic, a string id past the pool
+    {
+        std::string damagedName = std::string(dir) + "/damaged" TXN_CACHE_EXTENSION;
+        std::string bytes;
+        char        buf[4096];
+        size_t      n;
+        size_t      numRows = TEST_ROWS;
+        size_t      descAt =  sizeof(txnCacheHeader_t) + numRows * (sizeof(int64_t) + sizeof(uint64_t))
+                            + ((numRows + TXN_CACHE_ZONE_ROWS - 1) / TXN_CACHE_ZONE_ROWS) * sizeof(txnCacheZone_t)
+                            + numRows * sizeof(int32_t);
+        FILE        *fp = fopen(cacheName.c_str(), "rb");
+
+        while (fp && ((n = fread(buf, 1, sizeof(buf), fp)) > 0)) bytes.append(buf, n);
+        if (fp) fclose(fp);
+
+        for (int d = 0; d < 3; d++) {
+            TransactionCache    cache;
+            TransactionBatch    batch;
+            std::string         damaged = bytes;
+            uint32_t            badId = 0xffffffffu;
+            bool                opened;
+            bool                loaded = false;
+
+            if (0 == d) damaged.resize(damaged.size() - 1);
+            if (1 == d) damaged[0] ^= 1;
+            if (2 == d) memcpy(&damaged[descAt], &badId, sizeof(badId));
+
+            fp = fopen(damagedName.c_str(), "wb");
+            if (fp) {
+                fwrite(damaged.data(), 1, damaged.size(), fp);
+                fclose(fp);
+            }
+            opened = cache.open(damagedName.c_str(), key);
+            if (opened) loaded = cache.load(dateRange_t{0, 0}, batch, (size_t *)(NULL));
+            if (loaded) {
+                printf("Damaged cache %d: loaded\n", d);
+                ++failures;
+            }
+        }
+        unlink(damagedName.c_str());
+    }
+
+    unlink(cacheName.c_str());
+    unlink(csvName.c_str());
+    unlink(rulesName.c_str());
+    rmdir(dir);
+
+    printf("%d failures\n", failures);
+    return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif /* TRANSACTIONCACHE_TEST */
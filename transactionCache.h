@@ -0,0 +1,136 @@
+#ifndef __TRANSACTIONCACHE_H__
+#define __TRANSACTIONCACHE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include "bankFormat.h"
+#include "transaction.h"
+
+// A columnar cache of a CSV file's converted transactions (csv2qifBLS
+// --cache), written next to it as name.csv.c2qc.  A later run reads the
+// transactions from the cache instead of parsing the CSV again, for as
+// long as the CSV is unchanged.
+//
+// A cache is good for the CSV of the same size, modification time and
+// hash of its bytes, converted as the same bank format with the same
+// reference database and rules (descriptions are cached rewritten).
+// Anything else and the CSV is parsed and the cache written again.
+// TXN_CACHE_VERSION changes whenever the conversion does.
+//
+// File layout, native byte order:
+//      txnCacheHeader_t
+//      numRows     int64_t         amount in cents
+//      numRows     uint64_t        dedup fingerprint (see DedupIndex)
+//      numZones    txnCacheZone_t  dates of each TXN_CACHE_ZONE_ROWS rows
+//      numRows     int32_t         date, yyyymmdd (0 if none)
+//      numRows     uint32_t        description (string id)
+//      numRows     uint32_t        symbol (string id)
+//      numRows     uint32_t        date as in the export (string id)
+//      numStrings + 1 uint32_t     string offsets: string i is pool
+//                                  bytes [offset[i], offset[i + 1])
+//      poolSize    bytes
+// Rows are in the order of the CSV.  String 0 is the empty string.
+// Every column starts 4 byte aligned, and the cents and fingerprints
+// 8 byte aligned.
+//
+// The cache is mapped, and a date range is read zone by zone: a zone
+// whose dates are all outside the range is passed over without looking
+// at its rows.
+
+#define TXN_CACHE_EXTENSION     ".c2qc"
+#define TXN_CACHE_MAGIC         "C2QCACHE"
+#define TXN_CACHE_VERSION       2
+#define TXN_CACHE_ZONE_ROWS     4096
+
+// What a cache was made from
+typedef struct
+{
+    uint32_t    bankFormat;
+    uint64_t    sourceSize;
+    int64_t     sourceMtimeNs;
+    uint64_t    sourceHash;     // Of the file's bytes, as stored (compressed)
+    uint64_t    configHash;     // See txnCacheConfigHash()
+}   txnCacheKey_t;
+
+typedef struct
+{
+    char            magic[8];
+    uint32_t        version;
+    uint32_t        numStrings;
+    txnCacheKey_t   key;
+    uint64_t        numRows;
+    uint32_t        poolSize;
+    int32_t         firstDate;  // Oldest and newest dates, 0 if none
+    int32_t         lastDate;
+    uint32_t        reserved;
+}   txnCacheHeader_t;
+
+// Oldest and newest dates of a zone's rows, not counting rows without
+// a date.  Both 0 if no row has one.
+typedef struct
+{
+    int32_t     minDate;
+    int32_t     maxDate;
+}   txnCacheZone_t;
+
+// Hash of the reference database and rules files the descriptions were
+// rewritten with (either may be NULL).  Returns false if one can not be
+// read.
+bool txnCacheConfigHash(const char *refDbFileName, const char *rulesFileName, uint64_t *configHash);
+
+// The key of csvFileName (which is read whole, to hash it).  Returns
+// false if it can not be read.
+bool txnCacheKey(const char *csvFileName, bankFormat_t bankFormat, uint64_t configHash, txnCacheKey_t *key);
+
+// The cache file name of a CSV file
+std::string txnCacheFileName(const char *csvFileName);
+
+// Write batches, as parsed from the CSV with key, to fileName.  The
+// batches must have their fingerprints (QifConverter::keepFingerprints()).
+// It is written to fileName.tmp and renamed, so a reader sees the old
+// cache or the new one.  Returns false, with errMsg set, on an I/O error
+// or a batch without fingerprints.
+bool txnCacheWrite(const char *fileName, const txnCacheKey_t &key, const batchList_t &batches, std::string &errMsg);
+
+class TransactionCache {
+private:
+    void                        *map;
+    size_t                      mapLen;
+    const txnCacheHeader_t      *header;
+    const int64_t               *cents;
+    const uint64_t              *prints;
+    const txnCacheZone_t        *zones;
+    const int32_t               *dates;
+    const uint32_t              *descs;
+    const uint32_t              *symbols;
+    const uint32_t              *dateTexts;
+    const uint32_t              *offsets;
+    const char                  *pool;
+
+public:
+    TransactionCache();
+    ~TransactionCache();
+
+    TransactionCache(const TransactionCache &) = delete;
+    TransactionCache &operator=(const TransactionCache &) = delete;
+
+    // Map fileName if it is a good cache made with key.  Returns false
+    // if there is none, it is damaged or it is out of date.
+    bool open(const char *fileName, const txnCacheKey_t &key);
+    void close();
+
+    bool isOpen() const         { return (map != nullptr); }
+    uint64_t numRows() const    { return header ? header->numRows : 0; }
+    size_t fileSize() const     { return mapLen; }
+
+    // Replace batch's transactions, and their fingerprints, with the
+    // cached ones dated in range.
+    // The batch's strings are those of the mapping, so it must not
+    // outlive close().  *numZonesRead (if not NULL) is set to the number
+    // of zones whose rows were looked at.  Returns false if the cache
+    // is damaged.
+    bool load(const dateRange_t &range, TransactionBatch &batch, size_t *numZonesRead) const;
+};
+
+#endif
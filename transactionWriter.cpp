@@ -0,0 +1,519 @@
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <inttypes.h>
+#include <unordered_map>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include "transactionWriter.h"
+#include "stats.h"
+
+// OFX NAME is at most this long; the whole description goes in MEMO
+#define OFX_NAME_MAX    32
+
+outputFormat_t outputFormatForFile(const char *fileName)
+{
+    const char *ext = strrchr(fileName, '.');
+
+    if ((const char *)(NULL) == ext)         return OUTPUT_QIF;
+    if (strcasecmp(ext, ".ofx") == 0)       return OUTPUT_OFX;
+    if (strcasecmp(ext, ".tsv") == 0)       return OUTPUT_TSV;
+    if (strcasecmp(ext, ".csv") == 0)       return OUTPUT_CSV;
+    return OUTPUT_QIF;
+}
+
+static inline void append(QifBuffer &b, const char *s)
+{
+    b.append(s, strlen(s));
+}
+
+static inline void append(QifBuffer &b, std::string_view s)
+{
+    b.append(s.data(), s.size());
+}
+
+// The amount as [-]dollars.cc
+static inline void appendCents(QifBuffer &b, int64_t cents)
+{
+    b.commit(formatCents(b.reserve(QIF_CENTS_MAX), cents));
+}
+
+// A date as YYYY-MM-DD, or as in the export if it could not be read
+static inline void appendIsoDate(QifBuffer &b, const TransactionBatch &batch, const transaction_t &t)
+{
+    if (t.date) b.commit(formatDate(b.reserve(DATE_TEXT_MAX), t.date, DATE_ISO));
+    else append(b, batch.dateText(t));
+}
+
+// A date as OFX has it, YYYYMMDD
+static inline void appendOfxDate(QifBuffer &b, int32_t date)
+{
+    char    *p = b.reserve(8);
+
+    for (int i = 7; i >= 0; i--)
+    {
+        p[i] = (char)('0' + date % 10);
+        date /= 10;
+    }
+    b.commit(8);
+}
+
+// Text in OFX (XML) element content.  XML 1.0 allows no control
+// characters but tab, CR and LF, which have no place in a NAME or MEMO
+// either, so each of them is written as a space.
+static void appendOfxText(QifBuffer &b, const char *s, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        switch (s[i])
+        {
+            case '&':   append(b, "&amp;");         break;
+            case '<':   append(b, "&lt;");          break;
+            case '>':   append(b, "&gt;");          break;
+            default:
+                if ((unsigned char)s[i] < ' ')  append(b, " ");
+                else                            b.append(s + i, 1);
+                break;
+        }
+    }
+}
+
+// Up to OFX_NAME_MAX bytes of s, not cutting a UTF-8 character in two
+static size_t ofxNameLength(const char *s, size_t n)
+{
+    if (n <= OFX_NAME_MAX) return n;
+    n = OFX_NAME_MAX;
+    while (n && (((unsigned char)s[n] & 0xC0) == 0x80)) --n;
+    return n;
+}
+
+// The QIF convertStream() writes
+class QifTransactionWriter : public TransactionWriter {
+private:
+    const QifConverter  &converter;
+
+public:
+    explicit QifTransactionWriter(const QifConverter &c) : converter(c) {}
+
+    void begin(int32_t, int32_t, QifOutput &out) override
+    {
+        append(out.qif, "!Type:Bank\n");
+    }
+
+    void write(const TransactionBatch &batch, const transaction_t &t, QifOutput &out) override
+    {
+        converter.writeTransaction(batch, t, out);
+    }
+};
+
+// Today, yyyymmdd
+static int32_t today()
+{
+    time_t      now = time((time_t *)(NULL));
+    struct tm   tm;
+
+    localtime_r(&now, &tm);
+    return (tm.tm_year + 1900) * 10000 + (tm.tm_mon + 1) * 100 + tm.tm_mday;
+}
+
+// An OFX 2 statement: an investment statement for a brokerage account
+// (formatDescriptor_t investment), the transactions as cash (INVBANKTRAN),
+// otherwise a bank statement, always ACCTTYPE CHECKING.  The exports do
+// not say which bank or account they are from, so BANKID (BROKERID) is
+// the format's name and ACCTID is account.  They have no balance, so a
+// bank statement's ledger balance is 0 and an investment statement has
+// none.  The dates are those of the transactions, or today if none has
+// one.  OFX transactions must have a date, so rows whose date could not
+// be read (Schwab's "Transactions Total") are left out.
+//
+// FITID is the date, a hash of the date, amount and description as
+// written (DedupIndex::fingerprint()) and the number of identical
+// transactions before it in the file, so a transaction keeps its FITID
+// when rows are added to or dropped from the export, and importing the
+// same transactions twice finds them already there.
+class OfxTransactionWriter : public TransactionWriter {
+private:
+    std::string                             bankId;
+    std::string                             account;
+    bool                                    investment;
+    int32_t                                 asOf;
+    std::unordered_map<uint64_t, uint32_t>  seen;   // FITID hash: count so far
+
+public:
+    OfxTransactionWriter(const char *bank, const std::string &acct, bool invest)
+        : bankId(bank)
+        , account(acct)
+        , investment(invest)
+        , asOf(0)
+    {
+    }
+
+    void begin(int32_t firstDate, int32_t lastDate, QifOutput &out) override
+    {
+        QifBuffer &b = out.qif;
+
+        // With no dates, an empty range as of today
+        if (0 == lastDate) firstDate = lastDate = today();
+        asOf = lastDate;
+        seen.clear();
+
+        append(b, "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n"
+                  "<?OFX OFXHEADER=\"200\" VERSION=\"220\" SECURITY=\"NONE\" OLDFILEUID=\"NONE\" NEWFILEUID=\"NONE\"?>\n"
+                  "<OFX>\n<SIGNONMSGSRSV1><SONRS>"
+                  "<STATUS><CODE>0</CODE><SEVERITY>INFO</SEVERITY></STATUS><DTSERVER>");
+        appendOfxDate(b, asOf);
+        append(b, "</DTSERVER><LANGUAGE>ENG</LANGUAGE></SONRS></SIGNONMSGSRSV1>\n");
+        if (investment)
+        {
+            append(b, "<INVSTMTMSGSRSV1><INVSTMTTRNRS><TRNUID>0</TRNUID>"
+                      "<STATUS><CODE>0</CODE><SEVERITY>INFO</SEVERITY></STATUS>\n"
+                      "<INVSTMTRS><DTASOF>");
+            appendOfxDate(b, asOf);
+            append(b, "</DTASOF><CURDEF>USD</CURDEF>\n<INVACCTFROM><BROKERID>");
+            appendOfxText(b, bankId.data(), bankId.size());
+            append(b, "</BROKERID><ACCTID>");
+            appendOfxText(b, account.data(), account.size());
+            append(b, "</ACCTID></INVACCTFROM>\n<INVTRANLIST><DTSTART>");
+        }
+        else
+        {
+            append(b, "<BANKMSGSRSV1><STMTTRNRS><TRNUID>0</TRNUID>"
+                      "<STATUS><CODE>0</CODE><SEVERITY>INFO</SEVERITY></STATUS>\n"
+                      "<STMTRS><CURDEF>USD</CURDEF>\n<BANKACCTFROM><BANKID>");
+            appendOfxText(b, bankId.data(), bankId.size());
+            append(b, "</BANKID><ACCTID>");
+            appendOfxText(b, account.data(), account.size());
+            append(b, "</ACCTID><ACCTTYPE>CHECKING</ACCTTYPE></BANKACCTFROM>\n<BANKTRANLIST><DTSTART>");
+        }
+        appendOfxDate(b, firstDate);
+        append(b, "</DTSTART><DTEND>");
+        appendOfxDate(b, lastDate);
+        append(b, "</DTEND>\n");
+    }
+
+    void write(const TransactionBatch &batch, const transaction_t &t, QifOutput &out) override
+    {
+        QifBuffer           &b = out.qif;
+        std::string_view    desc = batch.desc(t);
+
+        if (0 == t.date) return;
+
+        ++out.numTransactions;
+        if (investment) append(b, "<INVBANKTRAN>");
+        append(b, (t.cents < 0) ? "<STMTTRN><TRNTYPE>DEBIT</TRNTYPE><DTPOSTED>"
+                                : "<STMTTRN><TRNTYPE>CREDIT</TRNTYPE><DTPOSTED>");
+        appendOfxDate(b, t.date);
+        append(b, "</DTPOSTED><TRNAMT>");
+        appendCents(b, t.cents);
+
+        uint64_t h = DedupIndex::fingerprint(t.date, (const char *)(NULL), 0, desc.data(), desc.size(), t.cents);
+        append(b, "</TRNAMT><FITID>");
+        appendOfxDate(b, t.date);
+        b.commit(snprintf(b.reserve(40), 40, "-%016" PRIx64 "-%u", h, ++seen[h]));
+
+        append(b, "</FITID><NAME>");
+        appendOfxText(b, desc.data(), ofxNameLength(desc.data(), desc.size()));
+        append(b, "</NAME>");
+        if (desc.size() > OFX_NAME_MAX)
+        {
+            append(b, "<MEMO>");
+            appendOfxText(b, desc.data(), desc.size());
+            append(b, "</MEMO>");
+        }
+        append(b, investment ? "</STMTTRN><SUBACCTFUND>CASH</SUBACCTFUND></INVBANKTRAN>\n" : "</STMTTRN>\n");
+    }
+
+    void end(QifOutput &out) override
+    {
+        QifBuffer &b = out.qif;
+
+        if (investment)
+        {
+            append(b, "</INVTRANLIST>\n</INVSTMTRS></INVSTMTTRNRS></INVSTMTMSGSRSV1>\n</OFX>\n");
+            return;
+        }
+        append(b, "</BANKTRANLIST>\n<LEDGERBAL><BALAMT>0.00</BALAMT><DTASOF>");
+        appendOfxDate(b, asOf);
+        append(b, "</DTASOF></LEDGERBAL>\n</STMTRS></STMTTRNRS></BANKMSGSRSV1>\n</OFX>\n");
+    }
+};
+
+// One row per transaction, with a header row: date (YYYY-MM-DD),
+// description, amount and symbol, tab or comma separated.  Tab
+// separated fields have tabs and line breaks made spaces; comma
+// separated fields are quoted as CSV needs.
+class TableTransactionWriter : public TransactionWriter {
+private:
+    char    separator;
+
+    void appendField(QifBuffer &b, std::string_view s)
+    {
+        if ('\t' == separator)
+        {
+            char *p = b.reserve(s.size());
+
+            for (size_t i = 0; i < s.size(); i++)
+            {
+                char c = s[i];
+                p[i] = (('\t' == c) || ('\n' == c) || ('\r' == c)) ? ' ' : c;
+            }
+            b.commit(s.size());
+        }
+        else if (s.find_first_of(",\"\r\n") != std::string_view::npos)
+        {
+            b.append("\"", 1);
+            for (char c : s)
+            {
+                if ('"' == c) b.append("\"", 1);
+                b.append(&c, 1);
+            }
+            b.append("\"", 1);
+        }
+        else
+        {
+            append(b, s);
+        }
+    }
+
+public:
+    explicit TableTransactionWriter(char sep) : separator(sep) {}
+
+    void begin(int32_t, int32_t, QifOutput &out) override
+    {
+        append(out.qif, ('\t' == separator) ? "Date\tDescription\tAmount\tSymbol\n"
+                                            : "Date,Description,Amount,Symbol\n");
+    }
+
+    void write(const TransactionBatch &batch, const transaction_t &t, QifOutput &out) override
+    {
+        QifBuffer &b = out.qif;
+
+        ++out.numTransactions;
+        appendIsoDate(b, batch, t);
+        b.append(&separator, 1);
+        appendField(b, batch.desc(t));
+        b.append(&separator, 1);
+        appendCents(b, t.cents);
+        b.append(&separator, 1);
+        appendField(b, batch.symbol(t));
+        b.append("\n", 1);
+    }
+};
+
+std::unique_ptr<TransactionWriter> newTransactionWriter(outputFormat_t format
+                                                        , const QifConverter &converter
+                                                        , const std::string &account
+                                                       )
+{
+    const formatDescriptor_t *fd = converter.getFormat();
+
+    switch (format)
+    {
+        case OUTPUT_OFX:
+            return std::unique_ptr<TransactionWriter>(new OfxTransactionWriter(fd ? fd->name : "", account, fd && fd->investment));
+        case OUTPUT_TSV:
+            return std::unique_ptr<TransactionWriter>(new TableTransactionWriter('\t'));
+        case OUTPUT_CSV:
+            return std::unique_ptr<TransactionWriter>(new TableTransactionWriter(','));
+        default:
+            return std::unique_ptr<TransactionWriter>(new QifTransactionWriter(converter));
+    }
+}
+
+// The rows of each batch to write, 1 to keep; empty to keep them all
+typedef std::vector<std::vector<char>> keepList_t;
+
+// Write the transactions kept to one writer, out to its file every
+// QIF_WRITE_SIZE
+static void runWriter(TransactionWriter &writer
+                      , const batchList_t &batches
+                      , const keepList_t &keep
+                      , int32_t firstDate
+                      , int32_t lastDate
+                      , FILE *fpLog
+                     )
+{
+    QifOutput   out;
+
+    auto drain = [&]()
+    {
+        writer.output().write(out.qif);
+        out.qif.clear();
+        if (fpLog && out.log.size()) fputs(out.log.c_str(), fpLog);
+        out.log.clear();
+    };
+
+    writer.begin(firstDate, lastDate, out);
+    for (size_t b = 0; b < batches.size(); b++)
+    {
+        const TransactionBatch &batch = *batches[b];
+
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            if (keep.size() && (0 == keep[b][i])) continue;
+            {
+                STATS_SCOPE(STAT_FORMAT);
+                writer.write(batch, batch[i], out);
+            }
+            if (out.qif.size() >= QIF_WRITE_SIZE) drain();
+        }
+    }
+    writer.end(out);
+    drain();
+    writer.output().flush();
+}
+
+void parseTransactions(QifConverter &converter, CsvInput &csvIn, int numJobs, batchList_t &batches)
+{
+    char    *data;
+    size_t  dataLen;
+
+    findColumnHeader(converter, csvIn);
+
+    if ((numJobs > 1) && csvIn.remaining(&data, &dataLen))
+    {
+        std::vector<lineBlock_t>    blocks;
+        std::vector<std::thread>    threads;
+        std::atomic<size_t>         next(0);
+        size_t                      first = batches.size();
+
+        splitLines(data, dataLen, numJobs, blocks);
+        for (size_t n = 0; n < blocks.size(); n++)
+        {
+            batches.emplace_back(new TransactionBatch());
+        }
+
+        auto parse = [&]()
+        {
+            size_t n;
+            while ((n = next++) < blocks.size())
+            {
+                converter.parseBlock(blocks[n].data, blocks[n].len, *batches[first + n]);
+            }
+        };
+
+        int numThreads = ((size_t)numJobs > blocks.size()) ? (int)blocks.size() : numJobs;
+        for (int i = 0; i < numThreads; i++)
+        {
+            threads.emplace_back(parse);
+        }
+        for (auto &t : threads)
+        {
+            t.join();
+        }
+    }
+    else
+    {
+        char            *line;
+        size_t          lineLen;
+        const RowFilter *filter = converter.getFilter();
+        bool            stopEarly = filter && dateRangeLimited(filter->dateRange()) && converter.getFormat();
+        DateOrder       order(stopEarly && converter.getFormat()->newestFirst);
+        int32_t         dateKey;
+
+        batches.emplace_back(new TransactionBatch());
+        TransactionBatch &batch = *batches.back();
+        while (csvIn.nextLine(&line, &lineLen))
+        {
+            converter.parseLine(line, lineLen, batch, &dateKey);
+            if (stopEarly && order.pastRange(filter->dateRange(), dateKey)) break;
+        }
+    }
+}
+
+int writeTransactions(const batchList_t &batches
+                      , const std::vector<TransactionWriter *> &writers
+                      , const RowFilter *filter
+                      , DedupIndex *dedup
+                      , FILE *fpLog
+                      , size_t *numTransactions
+                     )
+{
+    std::vector<std::thread>    threads;
+    keepList_t                  keep;
+    int32_t                     firstDate = 0;
+    int32_t                     lastDate = 0;
+    size_t                      n = 0;
+
+    // The rows to write, in file order for dedup, and the dates the
+    // OFX statement covers
+    if (filter || dedup) keep.resize(batches.size());
+    for (size_t b = 0; b < batches.size(); b++)
+    {
+        const TransactionBatch &batch = *batches[b];
+
+        if (keep.size()) keep[b].assign(batch.size(), 1);
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            const transaction_t &t = batch[i];
+
+            if  (   (filter && (false == filter->transactionOk(batch, t)))
+                 || (dedup && batch.hasFingerprints() && dedup->isDuplicate(batch.fingerprint(i)))
+                )
+            {
+                keep[b][i] = 0;
+                continue;
+            }
+            if (t.date && ((0 == firstDate) || (t.date < firstDate))) firstDate = t.date;
+            if (t.date > lastDate) lastDate = t.date;
+            ++n;
+        }
+    }
+    STATS_ADD(STAT_TRANSACTIONS, n);
+
+    // Then write each format
+    if ((writers.size() > 1) && (n >= MULTI_THREAD_MIN))
+    {
+        for (size_t w = 0; w < writers.size(); w++)
+        {
+            threads.emplace_back(runWriter, std::ref(*writers[w]), std::cref(batches), std::cref(keep)
+                                 , firstDate, lastDate, (0 == w) ? fpLog : (FILE *)(NULL));
+        }
+        for (auto &t : threads)
+        {
+            t.join();
+        }
+    }
+    else
+    {
+        for (size_t w = 0; w < writers.size(); w++)
+        {
+            runWriter(*writers[w], batches, keep, firstDate, lastDate, (0 == w) ? fpLog : (FILE *)(NULL));
+        }
+    }
+
+    *numTransactions = n;
+    for (TransactionWriter *w : writers)
+    {
+        if (w->output().failed()) return -7;
+    }
+    return 0;
+}
+
+int convertMulti(QifConverter &converter
+                 , CsvInput &csvIn
+                 , const std::vector<TransactionWriter *> &writers
+                 , const RowFilter *filter
+                 , int numJobs
+                 , FILE *fpLog
+                 , convertResult_t *result
+                 , batchList_t *parsed
+                )
+{
+    batchList_t     batches;
+    auto            start = std::chrono::steady_clock::now();
+    size_t          numTransactions;
+    int             ret;
+
+    parseTransactions(converter, csvIn, numJobs, batches);
+    ret = writeTransactions(batches, writers, filter, converter.getDedup(), fpLog, &numTransactions);
+
+    result->numTransactions = (int)numTransactions;
+    result->bytesIn = csvIn.bytesRead();
+    result->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (parsed) parsed->swap(batches);
+
+    if (csvIn.failed()) return -10;
+    return ret;
+}
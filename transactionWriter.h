@@ -0,0 +1,117 @@
+#ifndef __TRANSACTIONWRITER_H__
+#define __TRANSACTIONWRITER_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "qifConverter.h"
+#include "qifWriter.h"
+#include "transaction.h"
+#include "rowFilter.h"
+
+// Output formats other than one QIF file.
+//
+// A TransactionWriter writes parsed transactions (TransactionBatch) in
+// one format to its own buffered file.  convertMulti() parses a file
+// once and hands the transactions to any number of writers, so the
+// same run can write QIF, OFX and a flat table without parsing the CSV
+// again for each.  The transactions may also come from a
+// TransactionCache, without parsing the CSV at all.
+
+typedef enum
+{
+    OUTPUT_QIF = 0,
+    OUTPUT_OFX,         // OFX 2 bank or investment statement
+    OUTPUT_TSV,         // date, description, amount, symbol; tab separated
+    OUTPUT_CSV          // The same, comma separated
+}   outputFormat_t;
+
+// The format of an output file from its extension (.qif, .ofx, .tsv,
+// .csv).  Anything else is QIF.
+outputFormat_t outputFormatForFile(const char *fileName);
+
+class TransactionWriter {
+protected:
+    QifWriter   sink;
+
+public:
+    virtual ~TransactionWriter() {}
+
+    bool open(const char *fileName)         { return sink.open(fileName); }
+    void attach(int fd)                     { sink.attach(fd); }
+    QifWriter &output()                     { return sink; }
+
+    // Flush and close.  Returns false if anything could not be written.
+    bool close()                            { return sink.close(); }
+
+    // The file's header, before the first transaction.  The dates are
+    // those of the oldest and newest transaction (yyyymmdd), 0 if none
+    // could be read.
+    virtual void begin(int32_t firstDate, int32_t lastDate, QifOutput &out)
+    {
+        (void)firstDate;
+        (void)lastDate;
+        (void)out;
+    }
+
+    // Append one transaction of batch to out.qif, counting it in
+    // out.numTransactions
+    virtual void write(const TransactionBatch &batch, const transaction_t &t, QifOutput &out) = 0;
+
+    // The file's trailer, after the last transaction
+    virtual void end(QifOutput &out)        { (void)out; }
+};
+
+// A writer of format.  QIF is written by converter, as convertStream()
+// would, dates and all; the others write dates as YYYY-MM-DD (OFX as
+// YYYYMMDD).  account names the account in OFX.
+std::unique_ptr<TransactionWriter> newTransactionWriter(outputFormat_t format
+                                                        , const QifConverter &converter
+                                                        , const std::string &account
+                                                       );
+
+// With this many transactions or more, convertMulti() runs each writer
+// on a thread of its own
+#define MULTI_THREAD_MIN    (64 * 1024)
+
+// Parse everything after the column header line of csvIn, appending a
+// batch to batches: a batch per block of lines parsed by numJobs
+// threads when numJobs > 1 and the input is mapped (see
+// convertStream()), otherwise one batch parsed a line at a time, which
+// stops early once past the date range of the converter's filter.
+void parseTransactions(QifConverter &converter, CsvInput &csvIn, int numJobs, batchList_t &batches);
+
+// Write the transactions of batches that filter passes (all of them if
+// it is NULL; see RowFilter::transactionOk()) and that are not in dedup
+// (if not NULL; by the batches' fingerprints, taken in order before any
+// is written) to every writer, all already open, on threads of their
+// own if there are several writers and MULTI_THREAD_MIN transactions.
+// Writers are flushed but not closed.  The verbose listing of the first
+// writer goes to fpLog if not NULL.  *numTransactions is set to the
+// number written.  Returns 0 on success or -7 if writing failed.
+int writeTransactions(const batchList_t &batches
+                      , const std::vector<TransactionWriter *> &writers
+                      , const RowFilter *filter
+                      , DedupIndex *dedup
+                      , FILE *fpLog
+                      , size_t *numTransactions
+                     );
+
+// Convert CSV from csvIn to every writer: parseTransactions() then
+// writeTransactions() with filter and the converter's dedup index.
+// The batches are handed to parsed, if not NULL, for the caller to keep
+// (e.g. to cache them).  Returns 0 on success, -7 if writing failed or
+// -10 if the input could not all be read.
+int convertMulti(QifConverter &converter
+                 , CsvInput &csvIn
+                 , const std::vector<TransactionWriter *> &writers
+                 , const RowFilter *filter
+                 , int numJobs
+                 , FILE *fpLog
+                 , convertResult_t *result
+                 , batchList_t *parsed = (batchList_t *)(NULL)
+                );
+
+#endif
@@ -0,0 +1,415 @@
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include "watchConvert.h"
+#include "batchConvert.h"
+#include "qifConverter.h"
+#include "stopSignal.h"
+
+typedef std::chrono::steady_clock   watchClock;
+
+// A file as it was when it was converted, or last looked at
+typedef struct
+{
+    uint64_t    inode;
+    int64_t     mtimeNs;
+    uint64_t    size;
+}   watchFileId_t;
+
+// A file waiting to be left alone for WATCH_SETTLE_MS
+typedef struct
+{
+    watchClock::time_point  due;
+    watchFileId_t           id;
+}   watchPending_t;
+
+// What the watch loop and the workers share
+typedef struct
+{
+    std::mutex                                      mutex;
+    std::condition_variable                         ready;
+    std::deque<std::string>                         queue;
+    std::unordered_set<std::string>                 busy;   // .qif of a file queued or being converted
+    std::unordered_map<std::string, watchFileId_t>  done;   // The state file
+    bool                                            stopping;
+
+    std::string                 dir;                        // With a trailing /
+    std::string                 stateFileName;
+    bankFormat_t                bankFormat;
+    int                         verbosity;
+    const MoneyMarketSymbols    *mmSymbols;
+    const CUSIPBankMap          *cusip2bank;
+    const DescriptionRules      *rules;
+    dateFormat_t                dateFormat;
+}   watchState_t;
+
+static bool sameFile(const watchFileId_t &a, const watchFileId_t &b)
+{
+    return (a.inode == b.inode) && (a.mtimeNs == b.mtimeNs) && (a.size == b.size);
+}
+
+// Returns false if path is not a regular file
+static bool fileId(const std::string &path, watchFileId_t *id)
+{
+    struct stat st;
+
+    if ((stat(path.c_str(), &st) != 0) || (false == S_ISREG(st.st_mode))) return false;
+    id->inode = st.st_ino;
+    id->mtimeNs = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+    id->size = st.st_size;
+    return true;
+}
+
+// State file, one converted file per line after the first:
+//      csv2qifBLS watch 1
+//      inode mtimeNs size name
+static void loadState(watchState_t &state)
+{
+    FILE    *fp = fopen(state.stateFileName.c_str(), "r");
+    char    line[MAX_LINE];
+    int     version;
+
+    if ((FILE *)(NULL) == fp) return;
+
+    if  (   fgets(line, sizeof(line), fp)
+         && (sscanf(line, "csv2qifBLS watch %d", &version) == 1)
+         && (WATCH_STATE_VERSION == version)
+        )
+    {
+        while (fgets(line, sizeof(line), fp))
+        {
+            watchFileId_t   id;
+            int             nameAt = 0;
+
+            line[strcspn(line, "\r\n")] = '\0';
+            if  (   (sscanf(line, "%" SCNu64 " %" SCNd64 " %" SCNu64 " %n", &id.inode, &id.mtimeNs, &id.size, &nameAt) == 3)
+                 && nameAt && line[nameAt]
+                )
+            {
+                state.done[line + nameAt] = id;
+            }
+        }
+    }
+    fclose(fp);
+}
+
+// Replace the state file in one step.  Called with the mutex held.
+static void saveState(const watchState_t &state)
+{
+    std::string tmpName = state.stateFileName + ".tmp";
+    FILE        *fp = fopen(tmpName.c_str(), "w");
+
+    if ((FILE *)(NULL) == fp)
+    {
+        fprintf(stderr, "%s: Error writing watch state file\n", state.stateFileName.c_str());
+        return;
+    }
+
+    fprintf(fp, "csv2qifBLS watch %d\n", WATCH_STATE_VERSION);
+    for (const auto &d : state.done)
+    {
+        fprintf(fp, "%" PRIu64 " %" PRId64 " %" PRIu64 " %s\n", d.second.inode, d.second.mtimeNs, d.second.size, d.first.c_str());
+    }
+
+    bool ok = (0 == ferror(fp));
+    ok = (0 == fclose(fp)) && ok;
+    if  (   (false == ok)
+         || (rename(tmpName.c_str(), state.stateFileName.c_str()) != 0)
+        )
+    {
+        unlink(tmpName.c_str());
+        fprintf(stderr, "%s: Error writing watch state file\n", state.stateFileName.c_str());
+    }
+}
+
+// The .qif a file in the directory converts to.  x.csv and x.csv.gz
+// both make x.qif, so only one of them may be converted at a time.
+static std::string outputKey(const std::string &name)
+{
+    char outFileName[MAX_LINE];
+
+    if (qifFileNameFromInput(name.c_str(), outFileName, sizeof(outFileName))) return outFileName;
+    return name;
+}
+
+// Convert one file to outFileName by way of a temporary file of its own
+static int convertWatched(const watchState_t &state
+                          , const std::string &inFileName
+                          , char *outFileName
+                          , size_t outSize
+                          , convertResult_t *result
+                         )
+{
+    bankFormat_t    bankFormat = state.bankFormat;
+    int             ret;
+
+    memset(result, 0, sizeof(*result));
+    if (false == qifFileNameFromInput(inFileName.c_str(), outFileName, outSize)) return -3;
+    if (UNKNOWN_BANK_FORMAT == bankFormat) bankFormat = batchFormatForFile(inFileName);
+    if (UNKNOWN_BANK_FORMAT == bankFormat) return -6;
+
+    static std::atomic<unsigned>    tmpCount(0);
+
+    QifConverter    converter(bankFormat, 1, *state.mmSymbols, *state.cusip2bank);
+    std::string     tmpName =   std::string(outFileName) + "." + std::to_string(getpid())
+                              + "." + std::to_string(tmpCount++) + ".tmp";
+
+    converter.useRules(state.rules);
+    converter.useDateFormat(state.dateFormat);
+    ret = convertFile(converter, inFileName.c_str(), tmpName.c_str(), 1, (FILE *)(NULL), result);
+    if ((0 == ret) && (rename(tmpName.c_str(), outFileName) != 0)) ret = -7;
+    if (ret) unlink(tmpName.c_str());
+    return ret;
+}
+
+static void worker(watchState_t &state)
+{
+    char            outFileName[MAX_LINE];
+    convertResult_t result;
+
+    while (true)
+    {
+        std::string     name;
+
+        {
+            std::unique_lock<std::mutex> lock(state.mutex);
+
+            state.ready.wait(lock, [&]() { return state.stopping || state.queue.size(); });
+            if (state.stopping) break;
+            name = state.queue.front();
+            state.queue.pop_front();
+        }
+
+        // The file as converted: if it changes while being converted,
+        // it no longer matches and is converted again
+        std::string     inFileName = state.dir + name;
+        watchFileId_t   id;
+        bool            record = fileId(inFileName, &id);
+        auto            start = watchClock::now();
+        int             ret = record ? convertWatched(state, inFileName, outFileName, sizeof(outFileName), &result) : -4;
+        double          ms = std::chrono::duration<double, std::milli>(watchClock::now() - start).count();
+
+        switch (ret)
+        {
+            case 0:
+                if (state.verbosity >= 1)
+                {
+                    printf("%-40s -> %s: %d transactions, %.1f KB, %.1f ms\n"
+                           , inFileName.c_str(), outFileName, result.numTransactions, result.bytesIn / 1024.0, ms);
+                    fflush(stdout);
+                }
+                break;
+            case -3:    fprintf(stderr, "%s: Error making output file name\n", inFileName.c_str());    break;
+            case -4:    fprintf(stderr, "%s: Error opening input file\n", inFileName.c_str());         break;
+            case -5:    fprintf(stderr, "%s: Error opening output file\n", outFileName);               break;
+            case -6:    fprintf(stderr, "%s: Unknown Bank Format\n", inFileName.c_str());              break;
+            case -7:    fprintf(stderr, "%s: Error writing output file\n", outFileName);               break;
+            case -10:   fprintf(stderr, "%s: Error reading input file\n", inFileName.c_str());         break;
+            default:    fprintf(stderr, "%s: Conversion failed\n", inFileName.c_str());                break;
+        }
+
+        // Files that could not be read or written are tried again next
+        // time: that may clear up without the file changing
+        if ((0 != ret) && (-3 != ret) && (-6 != ret)) record = false;
+
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.busy.erase(outputKey(name));
+        if (record)
+        {
+            state.done[name] = id;
+            saveState(state);
+        }
+    }
+}
+
+int watchRun(const char *dir
+             , bankFormat_t bankFormat
+             , int numJobs
+             , int verbosity
+             , const MoneyMarketSymbols &mmSymbols
+             , const CUSIPBankMap &cusip2bank
+             , const DescriptionRules &rules
+             , dateFormat_t dateFormat
+            )
+{
+    watchState_t                                    state;
+    std::unordered_map<std::string, watchPending_t> pending;
+    std::vector<std::thread>                        workers;
+    auto                                            settle = std::chrono::milliseconds(WATCH_SETTLE_MS);
+    int                                             inotifyFd;
+    int                                             stopFd;
+
+    if (numJobs < 1) numJobs = 1;
+
+    state.stopping = false;
+    state.dir = dir;
+    if (state.dir.size() && (state.dir.back() != '/')) state.dir += '/';
+    state.stateFileName = state.dir + WATCH_STATE_FILE;
+    state.bankFormat = bankFormat;
+    state.verbosity = verbosity;
+    state.mmSymbols = &mmSymbols;
+    state.cusip2bank = &cusip2bank;
+    state.rules = &rules;
+    state.dateFormat = dateFormat;
+    loadState(state);
+
+    inotifyFd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if  (   (inotifyFd < 0)
+         || (inotify_add_watch(inotifyFd, dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR) < 0)
+        )
+    {
+        fprintf(stderr, "%s: Error watching directory: %s\n", dir, strerror(errno));
+        if (inotifyFd >= 0) close(inotifyFd);
+        return -13;
+    }
+    stopFd = stopSignalCatch();
+    if (stopFd < 0)
+    {
+        close(inotifyFd);
+        return -13;
+    }
+
+    // A file to convert once it settles
+    auto schedule = [&](const std::string &name)
+    {
+        watchFileId_t id;
+
+        if (fileId(state.dir + name, &id)) pending[name] = {watchClock::now() + settle, id};
+        else pending.erase(name);
+    };
+
+    // Everything in the directory: at the start, and if events were lost
+    auto scan = [&]()
+    {
+        DIR             *d = opendir(dir);
+        struct dirent   *de;
+
+        if ((DIR *)(NULL) == d) return;
+        while ((de = readdir(d)) != NULL)
+        {
+            if (hasCsvExtension(de->d_name)) schedule(de->d_name);
+        }
+        closedir(d);
+    };
+
+    for (int i = 0; i < numJobs; i++)
+    {
+        workers.emplace_back(worker, std::ref(state));
+    }
+    if (verbosity >= 1)
+    {
+        printf("Watching %s with %d worker%s\n", dir, numJobs, (1 == numJobs) ? "" : "s");
+        fflush(stdout);
+    }
+    scan();
+
+    while (true)
+    {
+        struct pollfd   fds[2] = {{inotifyFd, POLLIN, 0}, {stopFd, POLLIN, 0}};
+        int             timeout = -1;
+        auto            now = watchClock::now();
+
+        for (const auto &p : pending)
+        {
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(p.second.due - now).count() + 1;
+            if (ms < 0) ms = 0;
+            if ((timeout < 0) || (ms < timeout)) timeout = (int)ms;
+        }
+
+        if (poll(fds, 2, timeout) < 0)
+        {
+            if (EINTR == errno) continue;
+            break;
+        }
+        if (fds[1].revents) break;
+
+        if (fds[0].revents & POLLIN)
+        {
+            alignas(struct inotify_event) char  buf[64 * 1024];
+            ssize_t                             n;
+
+            while ((n = read(inotifyFd, buf, sizeof(buf))) > 0)
+            {
+                for (char *p = buf; p < buf + n; )
+                {
+                    const struct inotify_event *ev = (const struct inotify_event *)p;
+
+                    if (ev->mask & IN_Q_OVERFLOW) scan();
+                    else if (ev->len && hasCsvExtension(ev->name)) schedule(ev->name);
+                    p += sizeof(struct inotify_event) + ev->len;
+                }
+            }
+        }
+
+        // Hand the files that have settled to the workers
+        now = watchClock::now();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        for (auto p = pending.begin(); p != pending.end(); )
+        {
+            watchFileId_t id;
+
+            if (p->second.due > now)
+            {
+                ++p;
+                continue;
+            }
+            if (false == fileId(state.dir + p->first, &id))
+            {
+                // Gone
+                p = pending.erase(p);
+                continue;
+            }
+            std::string out = outputKey(p->first);
+            if ((false == sameFile(id, p->second.id)) || state.busy.count(out))
+            {
+                // Still changing, or its .qif is still being written,
+                // from this file or another: look again later
+                p->second = {now + settle, id};
+                ++p;
+                continue;
+            }
+
+            auto d = state.done.find(p->first);
+            if ((d == state.done.end()) || (false == sameFile(d->second, id)))
+            {
+                state.busy.insert(out);
+                state.queue.push_back(p->first);
+                state.ready.notify_one();
+            }
+            p = pending.erase(p);
+        }
+    }
+
+    // Finish the files being converted.  Those still queued are left
+    // for the next run.
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+
+        state.stopping = true;
+        state.queue.clear();
+        state.ready.notify_all();
+    }
+    for (auto &w : workers)
+    {
+        w.join();
+    }
+    close(inotifyFd);
+    stopSignalRelease();
+    return 0;
+}
@@ -0,0 +1,48 @@
+#ifndef __WATCHCONVERT_H__
+#define __WATCHCONVERT_H__
+
+#include "bankFormat.h"
+#include "mmSymbols.h"
+#include "cusipBankMap.h"
+#include "descRules.h"
+#include "dateParse.h"
+
+// Watch-folder mode (csv2qifBLS --watch dir).
+//
+// Every .csv file (or .csv.gz / .csv.zst) that is written to dir, or
+// moved into it, is converted to a .qif next to it, as -b would.  The
+// files already there are converted when the watch starts.
+//
+// A file is converted once it has been left alone for WATCH_SETTLE_MS:
+// each inotify close-write or moved-to event puts it off again, so a
+// file written in several goes is converted once, when it is complete.
+// Files are converted numJobs at a time, but never two that make the
+// same .qif (name.csv and name.csv.gz) at once.  The .qif is written to
+// a name.qif.pid.n.tmp of its own and renamed to name.qif, so a reader
+// sees the old .qif or the whole new one, never part of one.
+//
+// Converted files are recorded by inode, modification time and size in
+// WATCH_STATE_FILE in dir, so a restart does not convert them again; a
+// file that changed does not match its record and is converted.  Files
+// whose format can not be found are recorded too, and not tried again
+// until they change.
+//
+// Runs until SIGINT or SIGTERM, then finishes the files being
+// converted and returns 0.  Returns -13 if dir can not be watched.
+// bankFormat is the format of every file, or UNKNOWN_BANK_FORMAT to
+// find each one's as -b does.  Prints each file when verbosity >= 1.
+#define WATCH_SETTLE_MS     500
+#define WATCH_STATE_FILE    ".csv2qifBLS.watch"
+#define WATCH_STATE_VERSION 1
+
+int watchRun(const char *dir
+             , bankFormat_t bankFormat
+             , int numJobs
+             , int verbosity
+             , const MoneyMarketSymbols &mmSymbols
+             , const CUSIPBankMap &cusip2bank
+             , const DescriptionRules &rules
+             , dateFormat_t dateFormat
+            );
+
+#endif